@@ -0,0 +1,1838 @@
+#include "Benchmarks.h"
+#include "CookedMesh.h"
+#include "GameEntity.h"
+#include "GltfLoader.h"
+#include "MappedFile.h"
+#include "Mesh.h"
+#include "MeshBvh.h"
+#include "MeshCodec.h"
+#include "MeshOptimizer.h"
+#include "MeshTangents.h"
+#include "ObjLoader.h"
+#include "PathHelpers.h"
+#include "ScenePicker.h"
+#include "Transform.h"
+#include "TransformSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <thread>
+#include <psapi.h>
+
+namespace
+{
+	// Every model that ships in Assets/Models
+	const wchar_t* modelFiles[] = {
+		L"cube.obj",
+		L"cylinder.obj",
+		L"helix.obj",
+		L"quad.obj",
+		L"quad_double_sided.obj",
+		L"sphere.obj",
+		L"torus.obj" };
+
+	// The models Game::CreateGeometry loads, in the same order
+	const wchar_t* sceneFiles[] = {
+		L"cube.obj",
+		L"cylinder.obj",
+		L"helix.obj",
+		L"sphere.obj",
+		L"torus.obj",
+		L"cube.obj",
+		L"cube.obj" };
+
+	double SecondsSince(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	std::wstring ModelPath(const wchar_t* file)
+	{
+		return FixPath(std::wstring(L"../../Assets/Models/") + file);
+	}
+
+	// Thread counts for the multithreaded benchmarks: powers of
+	// two below the hardware thread count, then every hardware
+	// thread (so 6 threads gives 1, 2, 4, 6)
+	std::vector<unsigned int> ThreadCounts()
+	{
+		unsigned int maxThreads = std::thread::hardware_concurrency();
+		if (maxThreads == 0)
+			maxThreads = 1;
+
+		std::vector<unsigned int> counts;
+		for (unsigned int threads = 1; threads < maxThreads; threads *= 2)
+			counts.push_back(threads);
+		counts.push_back(maxThreads);
+		return counts;
+	}
+
+	// --------------------------------------------------------
+	// Builds the text of a large OBJ in memory: a tessellated
+	// sine-wave grid with positions, uvs, normals and quads,
+	// which is far bigger than anything in Assets/Models
+	// --------------------------------------------------------
+	std::string MakeLargeObj(int gridSize)
+	{
+		std::string text;
+		text.reserve((size_t)gridSize * gridSize * 150);
+
+		char line[128];
+		for (int y = 0; y < gridSize; y++)
+		{
+			for (int x = 0; x < gridSize; x++)
+			{
+				float u = (float)x / (gridSize - 1);
+				float v = (float)y / (gridSize - 1);
+				float height = 0.1f * sinf(u * 20.0f) * cosf(v * 20.0f);
+				int length = sprintf_s(line, "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn %.6f %.6f %.6f\n",
+					u * 100.0f, height, v * 100.0f,
+					u, v,
+					-height, 1.0f, height);
+				text.append(line, length);
+			}
+		}
+
+		for (int y = 0; y < gridSize - 1; y++)
+		{
+			for (int x = 0; x < gridSize - 1; x++)
+			{
+				int a = y * gridSize + x + 1;
+				int b = a + 1;
+				int c = a + gridSize + 1;
+				int d = a + gridSize;
+				int length = sprintf_s(line, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n",
+					a, a, a, b, b, b, c, c, c, d, d, d);
+				text.append(line, length);
+			}
+		}
+		return text;
+	}
+
+	// --------------------------------------------------------
+	// Builds a wavy grid of (gridSize - 1)^2 quads directly as
+	// vertices and indices.  The first row's uvs are collapsed
+	// to a point, so the triangles along that edge have
+	// degenerate uvs like real-world models often do.
+	// --------------------------------------------------------
+	void MakeLargeGrid(int gridSize, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+	{
+		vertices.resize((size_t)gridSize * gridSize);
+		for (int y = 0; y < gridSize; y++)
+		{
+			for (int x = 0; x < gridSize; x++)
+			{
+				float u = (float)x / (gridSize - 1);
+				float v = (float)y / (gridSize - 1);
+				float height = 0.1f * sinf(u * 20.0f) * cosf(v * 20.0f);
+
+				Vertex& vertex = vertices[(size_t)y * gridSize + x];
+				vertex.position = DirectX::XMFLOAT3(u * 100.0f, height, v * 100.0f);
+				vertex.normal = DirectX::XMFLOAT3(0, 1, 0);
+				vertex.tangent = DirectX::XMFLOAT3(0, 0, 0);
+				vertex.uv = y == 0 ? DirectX::XMFLOAT2(0, 0) : DirectX::XMFLOAT2(u, v);
+			}
+		}
+
+		indices.clear();
+		indices.reserve((size_t)(gridSize - 1) * (gridSize - 1) * 6);
+		for (int y = 0; y < gridSize - 1; y++)
+		{
+			for (int x = 0; x < gridSize - 1; x++)
+			{
+				unsigned int a = y * gridSize + x;
+				unsigned int b = a + 1;
+				unsigned int c = a + gridSize + 1;
+				unsigned int d = a + gridSize;
+				unsigned int quad[6] = { a, c, b, a, d, c };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		}
+	}
+
+	// --------------------------------------------------------
+	// The scalar tangent loop Mesh::CalculateTangents() used
+	// before GenerateTangents(), kept as a baseline
+	// --------------------------------------------------------
+	void ScalarTangents(Vertex* verts, int numVerts, const unsigned int* indices, int numIndices)
+	{
+		using namespace DirectX;
+		for (int i = 0; i < numVerts; i++)
+			verts[i].tangent = XMFLOAT3(0, 0, 0);
+
+		for (int i = 0; i < numIndices;)
+		{
+			Vertex* v1 = &verts[indices[i++]];
+			Vertex* v2 = &verts[indices[i++]];
+			Vertex* v3 = &verts[indices[i++]];
+			float x1 = v2->position.x - v1->position.x;
+			float y1 = v2->position.y - v1->position.y;
+			float z1 = v2->position.z - v1->position.z;
+			float x2 = v3->position.x - v1->position.x;
+			float y2 = v3->position.y - v1->position.y;
+			float z2 = v3->position.z - v1->position.z;
+			float s1 = v2->uv.x - v1->uv.x;
+			float t1 = v2->uv.y - v1->uv.y;
+			float s2 = v3->uv.x - v1->uv.x;
+			float t2 = v3->uv.y - v1->uv.y;
+			float r = 1.0f / (s1 * t2 - s2 * t1);
+			float tx = (t2 * x1 - t1 * x2) * r;
+			float ty = (t2 * y1 - t1 * y2) * r;
+			float tz = (t2 * z1 - t1 * z2) * r;
+			v1->tangent.x += tx; v1->tangent.y += ty; v1->tangent.z += tz;
+			v2->tangent.x += tx; v2->tangent.y += ty; v2->tangent.z += tz;
+			v3->tangent.x += tx; v3->tangent.y += ty; v3->tangent.z += tz;
+		}
+
+		for (int i = 0; i < numVerts; i++)
+		{
+			XMVECTOR normal = XMLoadFloat3(&verts[i].normal);
+			XMVECTOR tangent = XMLoadFloat3(&verts[i].tangent);
+			tangent = XMVector3Normalize(tangent - normal * XMVector3Dot(normal, tangent));
+			XMStoreFloat3(&verts[i].tangent, tangent);
+		}
+	}
+
+	// Tangents that came out as NaN (or infinite)
+	size_t CountBadTangents(const std::vector<Vertex>& vertices)
+	{
+		size_t bad = 0;
+		for (const Vertex& v : vertices)
+		{
+			if (!std::isfinite(v.tangent.x) || !std::isfinite(v.tangent.y) || !std::isfinite(v.tangent.z))
+				bad++;
+		}
+		return bad;
+	}
+
+	bool SameMeshData(const ObjMeshData& a, const ObjMeshData& b)
+	{
+		return a.vertices.size() == b.vertices.size() &&
+			a.indices.size() == b.indices.size() &&
+			memcmp(a.vertices.data(), b.vertices.data(), a.vertices.size() * sizeof(Vertex)) == 0 &&
+			memcmp(a.indices.data(), b.indices.data(), a.indices.size() * sizeof(unsigned int)) == 0;
+	}
+
+	// --------------------------------------------------------
+	// Writes mesh data out as a .glb in memory, undoing the
+	// loaders' RH -> LH conversion, so ParseGlb() should give
+	// back exactly the same arrays
+	// - Each attribute gets its own tightly packed buffer view,
+	//   the way most exporters write them
+	// --------------------------------------------------------
+	std::string MakeGlb(const ObjMeshData& data)
+	{
+		size_t vertexCount = data.vertices.size();
+		size_t indexCount = data.indices.size();
+		std::vector<DirectX::XMFLOAT3> positions(vertexCount);
+		std::vector<DirectX::XMFLOAT3> normals(vertexCount);
+		std::vector<DirectX::XMFLOAT2> uvs(vertexCount);
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			positions[i] = data.vertices[i].position;
+			normals[i] = data.vertices[i].normal;
+			uvs[i] = data.vertices[i].uv;
+			positions[i].z *= -1.0f;
+			normals[i].z *= -1.0f;
+		}
+
+		std::vector<unsigned int> indices(data.indices);
+		for (size_t i = 0; i + 2 < indexCount; i += 3)
+			std::swap(indices[i + 1], indices[i + 2]);
+
+		size_t positionBytes = vertexCount * sizeof(DirectX::XMFLOAT3);
+		size_t uvBytes = vertexCount * sizeof(DirectX::XMFLOAT2);
+		size_t indexBytes = indexCount * sizeof(unsigned int);
+		size_t binarySize = positionBytes * 2 + uvBytes + indexBytes;
+
+		char json[2048];
+		int jsonLength = sprintf_s(json,
+			"{\"asset\":{\"version\":\"2.0\"},"
+			"\"buffers\":[{\"byteLength\":%zu}],"
+			"\"bufferViews\":["
+			"{\"buffer\":0,\"byteOffset\":0,\"byteLength\":%zu},"
+			"{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu},"
+			"{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu},"
+			"{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu}],"
+			"\"accessors\":["
+			"{\"bufferView\":0,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC3\"},"
+			"{\"bufferView\":1,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC3\"},"
+			"{\"bufferView\":2,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC2\"},"
+			"{\"bufferView\":3,\"componentType\":5125,\"count\":%zu,\"type\":\"SCALAR\"}],"
+			"\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1,\"TEXCOORD_0\":2},\"indices\":3}]}]}",
+			binarySize,
+			positionBytes,
+			positionBytes, positionBytes,
+			positionBytes * 2, uvBytes,
+			positionBytes * 2 + uvBytes, indexBytes,
+			vertexCount, vertexCount, vertexCount, indexCount);
+		while (jsonLength % 4 != 0)
+			json[jsonLength++] = ' ';
+
+		std::string glb;
+		auto append = [&](const void* bytes, size_t size) { glb.append((const char*)bytes, size); };
+		auto appendWord = [&](uint32_t word) { append(&word, sizeof(word)); };
+
+		appendWord(0x46546C67);
+		appendWord(2);
+		appendWord((uint32_t)(12 + 8 + jsonLength + 8 + binarySize));
+		appendWord((uint32_t)jsonLength);
+		appendWord(0x4E4F534A);
+		append(json, jsonLength);
+		appendWord((uint32_t)binarySize);
+		appendWord(0x004E4942);
+		append(positions.data(), positionBytes);
+		append(normals.data(), positionBytes);
+		append(uvs.data(), uvBytes);
+		append(indices.data(), indexBytes);
+		return glb;
+	}
+
+	// --------------------------------------------------------
+	// Tracks the process's largest working set and private
+	// (committed) bytes for as long as it's alive, sampling them
+	// every millisecond on another thread
+	// - The OS's own peak counters never reset, so they can't
+	//   tell two loads in the same run apart
+	// --------------------------------------------------------
+	class MemoryPeakSampler
+	{
+	public:
+		MemoryPeakSampler()
+			:
+			running(true)
+		{
+			Sample(startWorkingSet, startPrivate);
+			peakWorkingSet = startWorkingSet;
+			peakPrivate = startPrivate;
+			thread = std::thread([this]()
+			{
+				while (running)
+				{
+					Update();
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+			});
+		}
+
+		~MemoryPeakSampler()
+		{
+			Stop();
+		}
+
+		void Stop()
+		{
+			if (!thread.joinable())
+				return;
+			running = false;
+			thread.join();
+			Update();
+		}
+
+		// Peak growth over where things stood at the start
+		double GetWorkingSetMB() { return (peakWorkingSet - startWorkingSet) / (1024.0 * 1024.0); }
+		double GetPrivateMB() { return (peakPrivate - startPrivate) / (1024.0 * 1024.0); }
+
+	private:
+		static void Sample(size_t& workingSet, size_t& privateBytes)
+		{
+			PROCESS_MEMORY_COUNTERS counters = {};
+			GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+			workingSet = counters.WorkingSetSize;
+			privateBytes = counters.PagefileUsage;
+		}
+
+		void Update()
+		{
+			size_t workingSet, privateBytes;
+			Sample(workingSet, privateBytes);
+			peakWorkingSet = std::max(peakWorkingSet, workingSet);
+			peakPrivate = std::max(peakPrivate, privateBytes);
+		}
+
+		std::thread thread;
+		std::atomic<bool> running;
+		size_t startWorkingSet;
+		size_t startPrivate;
+		size_t peakWorkingSet;
+		size_t peakPrivate;
+	};
+
+	// --------------------------------------------------------
+	// Tests every triangle, as the baseline for the BVH, with
+	// the same ray/triangle math MeshBvh uses
+	// --------------------------------------------------------
+	bool BruteForceRaycast(
+		const ObjMeshData& mesh,
+		const DirectX::XMFLOAT3& origin,
+		const DirectX::XMFLOAT3& direction,
+		RayHit& hit)
+	{
+		using namespace DirectX;
+		XMVECTOR o = XMLoadFloat3(&origin);
+		XMVECTOR d = XMLoadFloat3(&direction);
+		float closest = FLT_MAX;
+		bool found = false;
+		for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+		{
+			XMVECTOR a = XMLoadFloat3(&mesh.vertices[mesh.indices[i + 0]].position);
+			XMVECTOR e1 = XMLoadFloat3(&mesh.vertices[mesh.indices[i + 1]].position) - a;
+			XMVECTOR e2 = XMLoadFloat3(&mesh.vertices[mesh.indices[i + 2]].position) - a;
+
+			XMVECTOR p = XMVector3Cross(d, e2);
+			float determinant = XMVectorGetX(XMVector3Dot(e1, p));
+			if (determinant == 0.0f)
+				continue;
+			float inverse = 1.0f / determinant;
+
+			XMVECTOR s = o - a;
+			float u = XMVectorGetX(XMVector3Dot(s, p)) * inverse;
+			if (u < 0.0f || u > 1.0f)
+				continue;
+
+			XMVECTOR q = XMVector3Cross(s, e1);
+			float v = XMVectorGetX(XMVector3Dot(d, q)) * inverse;
+			float t = XMVectorGetX(XMVector3Dot(e2, q)) * inverse;
+			if (v < 0.0f || u + v > 1.0f || t < 0.0f || t >= closest)
+				continue;
+
+			closest = t;
+			hit.distance = t;
+			hit.triangle = (unsigned int)(i / 3);
+			hit.u = u;
+			hit.v = v;
+			found = true;
+		}
+		return found;
+	}
+
+	// Appends a line to the report and echoes it to the console
+	void Report(std::string& report, const char* line)
+	{
+		printf("%s\n", line);
+		report += line;
+		report += "\n";
+	}
+
+	// --------------------------------------------------------
+	// One row of the mesh compression report: the arrays are
+	// encoded, then decoded over and over for a quarter second
+	// each to time them (and checked against the originals)
+	// --------------------------------------------------------
+	void ReportCompression(
+		std::string& report,
+		const wchar_t* name,
+		const std::vector<Vertex>& vertices,
+		const std::vector<unsigned int>& indices)
+	{
+		char line[256];
+		size_t rawVertexBytes = vertices.size() * sizeof(Vertex);
+		size_t rawIndexBytes = indices.size() * sizeof(unsigned int);
+
+		std::vector<unsigned char> vertexData;
+		std::vector<unsigned char> indexData;
+		auto start = std::chrono::high_resolution_clock::now();
+		EncodeVertexBuffer(&vertices[0], vertices.size(), sizeof(Vertex), vertexData);
+		EncodeIndexBuffer(&indices[0], indices.size(), indexData);
+		double encodeSeconds = SecondsSince(start);
+
+		std::vector<Vertex> decodedVertices(vertices.size());
+		std::vector<unsigned int> decodedIndices(indices.size());
+		bool decoded = true;
+		int iterations = 0;
+		start = std::chrono::high_resolution_clock::now();
+		do
+		{
+			decoded &= DecodeVertexBuffer(&decodedVertices[0], vertices.size(), sizeof(Vertex), &vertexData[0], vertexData.size());
+			iterations++;
+		} while (SecondsSince(start) < 0.25);
+		double vertexSeconds = SecondsSince(start) / iterations;
+
+		iterations = 0;
+		start = std::chrono::high_resolution_clock::now();
+		do
+		{
+			decoded &= DecodeIndexBuffer(&decodedIndices[0], indices.size(), vertices.size(), &indexData[0], indexData.size());
+			iterations++;
+		} while (SecondsSince(start) < 0.25);
+		double indexSeconds = SecondsSince(start) / iterations;
+
+		// Vertices come back exactly; triangles may be rotated
+		bool same = decoded && memcmp(&decodedVertices[0], &vertices[0], rawVertexBytes) == 0;
+		for (size_t t = 0; same && t < indices.size(); t += 3)
+		{
+			const unsigned int* a = &indices[t];
+			const unsigned int* b = &decodedIndices[t];
+			same =
+				(b[0] == a[0] && b[1] == a[1] && b[2] == a[2]) ||
+				(b[0] == a[1] && b[1] == a[2] && b[2] == a[0]) ||
+				(b[0] == a[2] && b[1] == a[0] && b[2] == a[1]);
+		}
+
+		// Reading the smaller file and decoding it beats reading
+		// the raw one on any drive slower than this
+		size_t rawBytes = rawVertexBytes + rawIndexBytes;
+		size_t encodedBytes = vertexData.size() + indexData.size();
+		double breakEven = encodedBytes < rawBytes ?
+			(rawBytes - encodedBytes) / (vertexSeconds + indexSeconds) :
+			0.0;
+
+		sprintf_s(line, "  %-24ls %9zu -> %9zu bytes  vertices %5.2fx  indices %5.2fx  encode %7.1f MB/s  decode %5.2f / %5.2f GB/s  wins below %7.0f MB/s  %s",
+			name,
+			rawBytes,
+			encodedBytes,
+			(double)rawVertexBytes / vertexData.size(),
+			(double)rawIndexBytes / indexData.size(),
+			rawBytes / encodeSeconds / 1e6,
+			rawVertexBytes / vertexSeconds / 1e9,
+			rawIndexBytes / indexSeconds / 1e9,
+			breakEven / 1e6,
+			same ? "lossless" : "MISMATCH");
+		Report(report, line);
+	}
+
+	// --------------------------------------------------------
+	// Times warm loads of the same mesh cooked raw and cooked
+	// encoded: opening the cooked file, then copying its vertices
+	// and indices out the way CreateBuffer() would
+	// - Both files were just written, so they're read from the
+	//   OS's file cache, which is the best case for the raw file;
+	//   reading from a drive adds each file's size over the
+	//   drive's speed (see "wins below" for where that tips)
+	// --------------------------------------------------------
+	void ReportCookedLoads(
+		std::string& report,
+		const wchar_t* name,
+		const std::vector<Vertex>& vertices,
+		const std::vector<unsigned int>& indices)
+	{
+		char line[256];
+		MeshLod all = { 0, (unsigned int)indices.size(), 0.0f };
+		std::wstring rawPath = FixPath(L"compression_benchmark_raw.mesh");
+		std::wstring encodedPath = FixPath(L"compression_benchmark_encoded.mesh");
+
+		bool written = true;
+		for (int encode = 0; encode < 2; encode++)
+		{
+			written &= CookedMesh::Write(
+				(encode ? encodedPath : rawPath).c_str(),
+				0, 0, 0,
+				&vertices[0], (unsigned int)vertices.size(),
+				&indices[0], (unsigned int)indices.size(),
+				&all, 1,
+				nullptr, 0,
+				MeshBounds(),
+				encode != 0);
+		}
+
+		std::vector<Vertex> uploadedVertices(vertices.size());
+		std::vector<unsigned int> uploadedIndices(indices.size());
+		bool same = written;
+		auto timeLoads = [&](const std::wstring& path, unsigned long long& fileBytes)
+		{
+			int iterations = 0;
+			auto start = std::chrono::high_resolution_clock::now();
+			do
+			{
+				CookedMesh cooked(path.c_str());
+				same &= cooked.IsCurrent(0, 0, 0) && cooked.GetVertexCount() == vertices.size();
+				if (same)
+				{
+					memcpy(&uploadedVertices[0], cooked.GetVertices(), vertices.size() * sizeof(Vertex));
+					memcpy(&uploadedIndices[0], cooked.GetIndices(), indices.size() * sizeof(unsigned int));
+				}
+				iterations++;
+			} while (SecondsSince(start) < 0.25);
+
+			MappedFile file(path.c_str());
+			fileBytes = file.GetSize();
+			return SecondsSince(start) / iterations;
+		};
+
+		unsigned long long rawBytes = 0;
+		unsigned long long encodedBytes = 0;
+		double rawSeconds = timeLoads(rawPath, rawBytes);
+		double encodedSeconds = timeLoads(encodedPath, encodedBytes);
+		same = same && memcmp(&uploadedVertices[0], &vertices[0], vertices.size() * sizeof(Vertex)) == 0;
+
+		sprintf_s(line, "  %-24ls warm load (cached)  raw %9llu bytes %8.3f ms  encoded %9llu bytes %8.3f ms  %5.2fx  %s",
+			name,
+			rawBytes,
+			rawSeconds * 1e3,
+			encodedBytes,
+			encodedSeconds * 1e3,
+			rawSeconds / encodedSeconds,
+			same ? "lossless" : "MISMATCH");
+		Report(report, line);
+
+		DeleteFileW(rawPath.c_str());
+		DeleteFileW(encodedPath.c_str());
+	}
+
+	// --------------------------------------------------------
+	// Transform as it was before TransformSystem: each one on its
+	// own in the heap, with its own dirty flag, rebuilding its
+	// matrices one at a time whenever they're asked for
+	// --------------------------------------------------------
+	struct LegacyTransform
+	{
+		DirectX::XMFLOAT3 position;
+		DirectX::XMFLOAT3 rotation;
+		DirectX::XMFLOAT3 scale;
+		DirectX::XMFLOAT4X4 world;
+		DirectX::XMFLOAT4X4 worldInverseTranspose;
+		bool matrixChanged;
+
+		void UpdateMatrices()
+		{
+			using namespace DirectX;
+			if (!matrixChanged)
+				return;
+
+			XMMATRIX worldXM =
+				XMMatrixScaling(scale.x, scale.y, scale.z) *
+				XMMatrixRotationRollPitchYaw(rotation.x, rotation.y, rotation.z) *
+				XMMatrixTranslation(position.x, position.y, position.z);
+			XMStoreFloat4x4(&world, worldXM);
+			XMStoreFloat4x4(&worldInverseTranspose, XMMatrixInverse(0, XMMatrixTranspose(worldXM)));
+			matrixChanged = false;
+		}
+	};
+
+	// Average time rebuild() takes after markDirty() has been
+	// called on every stride-th transform, over a quarter second
+	// (the marking itself isn't timed)
+	template <typename MarkDirty, typename Rebuild>
+	double TimeRebuilds(unsigned int count, unsigned int stride, MarkDirty markDirty, Rebuild rebuild)
+	{
+		double seconds = 0.0;
+		int iterations = 0;
+		auto start = std::chrono::high_resolution_clock::now();
+		do
+		{
+			for (unsigned int i = 0; i < count; i += stride)
+				markDirty(i);
+
+			auto rebuildStart = std::chrono::high_resolution_clock::now();
+			rebuild();
+			seconds += SecondsSince(rebuildStart);
+			iterations++;
+		} while (SecondsSince(start) < 0.25 || iterations < 3);
+		return seconds / iterations;
+	}
+
+	// --------------------------------------------------------
+	// The rotation part of TransformSystem's matrix sweep, four
+	// slots at a time, from Euler angles (as it was) and from
+	// quaternions (as it is); both add their nine rows into
+	// "sum" so the work can't be skipped
+	// --------------------------------------------------------
+	void EulerRotationRows(const float* pitch, const float* yaw, const float* roll, DirectX::XMVECTOR& sum)
+	{
+		using namespace DirectX;
+		XMVECTOR sinPitch, cosPitch, sinYaw, cosYaw, sinRoll, cosRoll;
+		XMVectorSinCos(&sinPitch, &cosPitch, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(pitch)));
+		XMVectorSinCos(&sinYaw, &cosYaw, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(yaw)));
+		XMVectorSinCos(&sinRoll, &cosRoll, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(roll)));
+
+		XMVECTOR sinRollSinPitch = sinRoll * sinPitch;
+		XMVECTOR cosRollSinPitch = cosRoll * sinPitch;
+		sum += cosRoll * cosYaw + sinRollSinPitch * sinYaw;
+		sum += sinRoll * cosPitch;
+		sum += sinRollSinPitch * cosYaw - cosRoll * sinYaw;
+		sum += cosRollSinPitch * sinYaw - sinRoll * cosYaw;
+		sum += cosRoll * cosPitch;
+		sum += sinRoll * sinYaw + cosRollSinPitch * cosYaw;
+		sum += cosPitch * sinYaw;
+		sum -= sinPitch;
+		sum += cosPitch * cosYaw;
+	}
+
+	void QuaternionRotationRows(const float* x, const float* y, const float* z, const float* w, DirectX::XMVECTOR& sum)
+	{
+		using namespace DirectX;
+		XMVECTOR qx = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(x));
+		XMVECTOR qy = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(y));
+		XMVECTOR qz = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(z));
+		XMVECTOR qw = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(w));
+		XMVECTOR x2 = qx + qx;
+		XMVECTOR y2 = qy + qy;
+		XMVECTOR z2 = qz + qz;
+		XMVECTOR xx = qx * x2;
+		XMVECTOR yy = qy * y2;
+		XMVECTOR zz = qz * z2;
+		XMVECTOR one = XMVectorSplatOne();
+		sum += one - (yy + zz);
+		sum += qx * y2 + qw * z2;
+		sum += qx * z2 - qw * y2;
+		sum += qx * y2 - qw * z2;
+		sum += one - (xx + zz);
+		sum += qy * z2 + qw * x2;
+		sum += qx * z2 + qw * y2;
+		sum += qy * z2 - qw * x2;
+		sum += one - (xx + yy);
+	}
+
+	bool MatricesMatch(const DirectX::XMFLOAT4X4& a, const DirectX::XMFLOAT4X4& b)
+	{
+		for (int r = 0; r < 4; r++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				if (fabsf(a.m[r][c] - b.m[r][c]) > 1e-4f * (1.0f + fabsf(a.m[r][c])))
+					return false;
+			}
+		}
+		return true;
+	}
+}
+
+// --------------------------------------------------------
+// Parse throughput of the OBJ loader, in MB/s of source text
+//
+// - The file is mapped once up front, so this measures the
+//   tokenizer itself rather than the disk
+// - Each file is re-parsed until at least a quarter second
+//   has passed to get a stable average
+// --------------------------------------------------------
+std::string BenchmarkObjParsing()
+{
+	std::string report;
+	char line[256];
+	Report(report, "OBJ parsing (memory mapped, single thread)");
+
+	size_t totalBytes = 0;
+	double totalSeconds = 0;
+	for (const wchar_t* file : modelFiles)
+	{
+		MappedFile mapped(ModelPath(file).c_str());
+		if (!mapped.IsOpen())
+			continue;
+
+		ObjMeshData data;
+		int iterations = 0;
+		auto start = std::chrono::high_resolution_clock::now();
+		do
+		{
+			ParseObj(mapped.GetData(), mapped.GetSize(), data);
+			iterations++;
+		} while (SecondsSince(start) < 0.25);
+		double seconds = SecondsSince(start) / iterations;
+
+		totalBytes += mapped.GetSize();
+		totalSeconds += seconds;
+
+		sprintf_s(line, "  %-24ls %8zu bytes %8zu verts %9.3f ms %9.1f MB/s",
+			file,
+			mapped.GetSize(),
+			data.vertices.size(),
+			seconds * 1000.0,
+			mapped.GetSize() / seconds / (1024.0 * 1024.0));
+		Report(report, line);
+	}
+
+	if (totalSeconds > 0)
+	{
+		sprintf_s(line, "  All models: %.1f MB/s", totalBytes / totalSeconds / (1024.0 * 1024.0));
+		Report(report, line);
+	}
+	return report;
+}
+
+// --------------------------------------------------------
+// Thread scaling of the chunked OBJ parser on a generated
+// model of roughly 50 MB, from 1 thread up to every
+// hardware thread, checking each result against ParseObj()
+// --------------------------------------------------------
+std::string BenchmarkParallelObjParsing()
+{
+	std::string report;
+	char line[256];
+
+	std::string text = MakeLargeObj(600);
+	sprintf_s(line, "Parallel OBJ parsing (%.1f MB generated)", text.size() / (1024.0 * 1024.0));
+	Report(report, line);
+
+	ObjMeshData serial;
+	auto start = std::chrono::high_resolution_clock::now();
+	ParseObj(text.data(), text.size(), serial);
+	double serialSeconds = SecondsSince(start);
+
+	sprintf_s(line, "  ParseObj          %9.1f ms %9.1f MB/s",
+		serialSeconds * 1000.0,
+		text.size() / serialSeconds / (1024.0 * 1024.0));
+	Report(report, line);
+
+	for (unsigned int threads : ThreadCounts())
+	{
+		ObjMeshData parallel;
+		start = std::chrono::high_resolution_clock::now();
+		ParseObjParallel(text.data(), text.size(), parallel, true, threads);
+		double seconds = SecondsSince(start);
+
+		sprintf_s(line, "  %2u thread(s)      %9.1f ms %9.1f MB/s  %4.2fx  %s",
+			threads,
+			seconds * 1000.0,
+			text.size() / seconds / (1024.0 * 1024.0),
+			serialSeconds / seconds,
+			SameMeshData(serial, parallel) ? "identical" : "MISMATCH");
+		Report(report, line);
+	}
+	return report;
+}
+
+// --------------------------------------------------------
+// Load time of the same meshes as OBJ text and as .glb
+//
+// - Each model (plus a generated ~50 MB one) is parsed from
+//   OBJ, written back out as a .glb in memory, and both are
+//   timed from memory so the disk doesn't count
+// - The .glb has to give back identical vertices and indices
+// --------------------------------------------------------
+std::string BenchmarkGlbLoading()
+{
+	std::string report;
+	char line[256];
+	Report(report, "OBJ vs .glb loading (from memory, single thread)");
+
+	auto compare = [&](const wchar_t* name, const char* objText, size_t objSize)
+	{
+		ObjMeshData obj;
+		int iterations = 0;
+		auto start = std::chrono::high_resolution_clock::now();
+		do
+		{
+			ParseObj(objText, objSize, obj);
+			iterations++;
+		} while (SecondsSince(start) < 0.25);
+		double objSeconds = SecondsSince(start) / iterations;
+
+		std::string glb = MakeGlb(obj);
+		ObjMeshData fromGlb;
+		iterations = 0;
+		start = std::chrono::high_resolution_clock::now();
+		do
+		{
+			ParseGlb(glb.data(), glb.size(), fromGlb);
+			iterations++;
+		} while (SecondsSince(start) < 0.25);
+		double glbSeconds = SecondsSince(start) / iterations;
+
+		sprintf_s(line, "  %-24ls %8zu verts  OBJ %9.3f ms  glb %9.3f ms  %7.1fx  %s",
+			name,
+			obj.vertices.size(),
+			objSeconds * 1000.0,
+			glbSeconds * 1000.0,
+			objSeconds / glbSeconds,
+			SameMeshData(obj, fromGlb) ? "identical" : "MISMATCH");
+		Report(report, line);
+	};
+
+	for (const wchar_t* file : modelFiles)
+	{
+		MappedFile mapped(ModelPath(file).c_str());
+		if (mapped.IsOpen())
+			compare(file, mapped.GetData(), mapped.GetSize());
+	}
+
+	std::string text = MakeLargeObj(600);
+	compare(L"generated grid", text.data(), text.size());
+	return report;
+}
+
+// --------------------------------------------------------
+// Vertex counts and post-transform cache efficiency of each
+// model before (one vertex per face corner) and after welding
+// --------------------------------------------------------
+std::string BenchmarkVertexWelding()
+{
+	std::string report;
+	char line[256];
+	Report(report, "Vertex welding (FIFO cache of 16)");
+
+	for (const wchar_t* file : modelFiles)
+	{
+		ObjMeshData unwelded;
+		ObjMeshData welded;
+		if (!LoadObj(ModelPath(file).c_str(), unwelded, false) ||
+			!LoadObj(ModelPath(file).c_str(), welded, true))
+			continue;
+
+		VertexCacheStats before = AnalyzeVertexCache(&unwelded.indices[0], unwelded.indices.size(), unwelded.vertices.size());
+		VertexCacheStats after = AnalyzeVertexCache(&welded.indices[0], welded.indices.size(), welded.vertices.size());
+
+		sprintf_s(line, "  %-24ls verts %6zu -> %6zu (%5.1f%%)  hit rate %5.1f%% -> %5.1f%%  ACMR %.2f -> %.2f",
+			file,
+			unwelded.vertices.size(),
+			welded.vertices.size(),
+			100.0f * welded.vertices.size() / unwelded.vertices.size(),
+			100.0f * before.hitRate,
+			100.0f * after.hitRate,
+			before.acmr,
+			after.acmr);
+		Report(report, line);
+	}
+	return report;
+}
+
+// --------------------------------------------------------
+// Post-transform cache efficiency of each (welded) model
+// before and after OptimizeMesh(), plus how long it took
+// --------------------------------------------------------
+std::string BenchmarkMeshOptimization()
+{
+	std::string report;
+	char line[256];
+	Report(report, "Mesh optimization (vertex cache + overdraw + fetch, FIFO cache of 16)");
+
+	for (const wchar_t* file : modelFiles)
+	{
+		ObjMeshData original;
+		if (!LoadObj(ModelPath(file).c_str(), original))
+			continue;
+
+		ObjMeshData optimized = original;
+		auto start = std::chrono::high_resolution_clock::now();
+		OptimizeMesh(optimized.vertices, optimized.indices);
+		double seconds = SecondsSince(start);
+
+		VertexCacheStats before = AnalyzeVertexCache(&original.indices[0], original.indices.size(), original.vertices.size());
+		VertexCacheStats after = AnalyzeVertexCache(&optimized.indices[0], optimized.indices.size(), optimized.vertices.size());
+
+		sprintf_s(line, "  %-24ls ACMR %.3f -> %.3f  ATVR %.3f -> %.3f  %8.3f ms",
+			file,
+			before.acmr,
+			after.acmr,
+			before.atvr,
+			after.atvr,
+			seconds * 1000.0);
+		Report(report, line);
+	}
+	return report;
+}
+
+// --------------------------------------------------------
+// Tangent generation on a generated mesh of about a million
+// triangles: the old scalar loop against GenerateTangents()
+// on 1 thread up to every hardware thread
+//
+// - Also counts tangents that came out NaN, since the old
+//   loop divides by zero on degenerate uvs
+// - "Max difference" is the largest angle between the new
+//   and old tangents, skipping the ones the old loop broke
+// --------------------------------------------------------
+std::string BenchmarkTangentGeneration()
+{
+	std::string report;
+	char line[256];
+
+	std::vector<Vertex> baseline;
+	std::vector<unsigned int> indices;
+	MakeLargeGrid(708, baseline, indices);
+	sprintf_s(line, "Tangent generation (%zu triangles, %zu vertices)", indices.size() / 3, baseline.size());
+	Report(report, line);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	ScalarTangents(&baseline[0], (int)baseline.size(), &indices[0], (int)indices.size());
+	double scalarSeconds = SecondsSince(start);
+
+	sprintf_s(line, "  Scalar loop       %9.1f ms  %6zu NaN tangents",
+		scalarSeconds * 1000.0,
+		CountBadTangents(baseline));
+	Report(report, line);
+
+	for (unsigned int threads : ThreadCounts())
+	{
+		std::vector<Vertex> vertices = baseline;
+		start = std::chrono::high_resolution_clock::now();
+		GenerateTangents(&vertices[0], vertices.size(), &indices[0], indices.size(), threads);
+		double seconds = SecondsSince(start);
+
+		float minDot = 1.0f;
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			const DirectX::XMFLOAT3& a = vertices[i].tangent;
+			const DirectX::XMFLOAT3& b = baseline[i].tangent;
+			if (std::isfinite(b.x) && std::isfinite(b.y) && std::isfinite(b.z))
+				minDot = std::min(minDot, a.x * b.x + a.y * b.y + a.z * b.z);
+		}
+
+		sprintf_s(line, "  %2u thread(s)      %9.1f ms  %6zu NaN tangents  %4.2fx  max difference %.4f degrees",
+			threads,
+			seconds * 1000.0,
+			CountBadTangents(vertices),
+			scalarSeconds / seconds,
+			acosf(std::max(-1.0f, std::min(1.0f, minDot))) * 57.29578f);
+		Report(report, line);
+	}
+	return report;
+}
+
+// --------------------------------------------------------
+// Time to create every Mesh in the scene, first "cold" (all
+// cooked .mesh files deleted, so every OBJ is parsed and
+// cooked) and then "warm" (everything mapped from the cooks)
+// --------------------------------------------------------
+std::string BenchmarkSceneLoading(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+{
+	std::string report;
+	char line[256];
+	Report(report, "Scene mesh loading (includes GPU buffer creation)");
+
+	for (const wchar_t* file : sceneFiles)
+		DeleteFileW(GetCookedPath(ModelPath(file).c_str()).c_str());
+
+	const char* passNames[] = { "Cold (parse + cook)", "Warm (cooked, mapped)" };
+	for (const char* passName : passNames)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		for (const wchar_t* file : sceneFiles)
+			Mesh mesh(ModelPath(file).c_str(), device, context);
+		double seconds = SecondsSince(start);
+
+		sprintf_s(line, "  %-24s %9.3f ms", passName, seconds * 1000.0);
+		Report(report, line);
+	}
+	return report;
+}
+
+// --------------------------------------------------------
+// Peak memory of cooking a generated ~200 MB OBJ two ways:
+// streamed with StreamObj(), and loaded whole then processed
+// with the same options (welded, no optimizing, LODs or
+// meshlets) and written with CookedMesh::Write(), unencoded
+// like the streamed one
+//
+// - "Private" is memory the loader allocated.  The working
+//   set also counts the mapped OBJ's pages, which the OS can
+//   drop whenever it likes since they're backed by the file
+// - Both cooked files have to hold the same vertices and
+//   indices (tangents may round differently when the whole
+//   mesh's are summed on several threads)
+// --------------------------------------------------------
+std::string BenchmarkStreamingImport()
+{
+	std::string report;
+	char line[256];
+
+	std::wstring objPath = FixPath(L"streaming_benchmark.obj");
+	std::wstring streamedPath = FixPath(L"streaming_benchmark_streamed.mesh");
+	std::wstring loadedPath = FixPath(L"streaming_benchmark_loaded.mesh");
+	{
+		std::string text = MakeLargeObj(1100);
+		std::ofstream out(objPath.c_str(), std::ios::binary | std::ios::trunc);
+		out.write(text.data(), text.size());
+		if (!out.good())
+		{
+			Report(report, "Streaming import: couldn't write the generated OBJ");
+			return report;
+		}
+	}
+
+	// Scoped so the OBJ is unmapped before it's deleted
+	{
+		MappedFile source(objPath.c_str());
+		sprintf_s(line, "Streaming OBJ import (%.1f MB generated)", source.GetSize() / (1024.0 * 1024.0));
+		Report(report, line);
+
+		auto reportPeaks = [&](const char* name, MemoryPeakSampler& sampler, double seconds, bool succeeded)
+		{
+			sprintf_s(line, "  %-14s %9.1f ms  peak private %8.1f MB  peak working set %8.1f MB%s",
+				name,
+				seconds * 1000.0,
+				sampler.GetPrivateMB(),
+				sampler.GetWorkingSetMB(),
+				succeeded ? "" : "  FAILED");
+			Report(report, line);
+		};
+
+		// Streamed
+		{
+			MemoryPeakSampler sampler;
+			auto start = std::chrono::high_resolution_clock::now();
+			CookedMeshWriter writer(streamedPath.c_str());
+			MeshBounds bounds;
+			bool succeeded =
+				StreamObj(source.GetData(), source.GetSize(), writer, bounds) &&
+				writer.Finish(0, source.GetSize(), 1, bounds);
+			double seconds = SecondsSince(start);
+			sampler.Stop();
+			reportPeaks("Streamed", sampler, seconds, succeeded);
+		}
+
+		// Loaded whole, the way Mesh's cold path works
+		{
+			MemoryPeakSampler sampler;
+			auto start = std::chrono::high_resolution_clock::now();
+			ObjMeshData obj;
+			bool succeeded = ParseObjParallel(source.GetData(), source.GetSize(), obj);
+			if (succeeded)
+			{
+				GenerateTangents(&obj.vertices[0], obj.vertices.size(), &obj.indices[0], obj.indices.size());
+				MeshLod all = { 0, (unsigned int)obj.indices.size(), 0.0f };
+				succeeded = CookedMesh::Write(
+					loadedPath.c_str(),
+					0,
+					source.GetSize(),
+					1,
+					&obj.vertices[0],
+					(unsigned int)obj.vertices.size(),
+					&obj.indices[0],
+					(unsigned int)obj.indices.size(),
+					&all,
+					1,
+					0,
+					0,
+					ComputeBounds(&obj.vertices[0], obj.vertices.size()),
+					false);
+			}
+			double seconds = SecondsSince(start);
+			sampler.Stop();
+			reportPeaks("Loaded whole", sampler, seconds, succeeded);
+		}
+
+		{
+			CookedMesh streamed(streamedPath.c_str());
+			CookedMesh loaded(loadedPath.c_str());
+			bool valid =
+				streamed.IsCurrent(0, source.GetSize(), 1) &&
+				loaded.IsCurrent(0, source.GetSize(), 1);
+			bool same =
+				valid &&
+				streamed.GetVertexCount() == loaded.GetVertexCount() &&
+				streamed.GetIndexCount() == loaded.GetIndexCount() &&
+				memcmp(streamed.GetIndices(), loaded.GetIndices(), streamed.GetIndexCount() * sizeof(unsigned int)) == 0;
+			for (unsigned int i = 0; same && i < streamed.GetVertexCount(); i++)
+			{
+				const Vertex& a = streamed.GetVertices()[i];
+				const Vertex& b = loaded.GetVertices()[i];
+				same =
+					memcmp(&a.position, &b.position, sizeof(a.position)) == 0 &&
+					memcmp(&a.normal, &b.normal, sizeof(a.normal)) == 0 &&
+					memcmp(&a.uv, &b.uv, sizeof(a.uv)) == 0 &&
+					fabsf(a.tangent.x - b.tangent.x) < 1e-4f &&
+					fabsf(a.tangent.y - b.tangent.y) < 1e-4f &&
+					fabsf(a.tangent.z - b.tangent.z) < 1e-4f;
+			}
+
+			sprintf_s(line, "  %u verts, %u indices  %s",
+				valid ? streamed.GetVertexCount() : 0,
+				valid ? streamed.GetIndexCount() : 0,
+				same ? "identical" : "MISMATCH");
+			Report(report, line);
+		}
+	}
+
+	DeleteFileW(objPath.c_str());
+	DeleteFileW(streamedPath.c_str());
+	DeleteFileW(loadedPath.c_str());
+	return report;
+}
+
+// --------------------------------------------------------
+// BVH build time and closest-hit rays per second on every
+// model, against testing every triangle
+//
+// - Rays start on a sphere around the model (three times
+//   its bounding radius) and aim at random points inside it,
+//   so some hit and some miss
+// - Both have to agree on what's hit and how far away (the
+//   triangle can differ when a ray lands on a shared edge)
+// --------------------------------------------------------
+std::string BenchmarkMeshRaycasts()
+{
+	using namespace DirectX;
+	std::string report;
+	char line[256];
+	Report(report, "Mesh BVH raycasts (closest hit, single thread)");
+
+	const int rayCount = 100000;
+	for (const wchar_t* file : modelFiles)
+	{
+		ObjMeshData mesh;
+		if (!LoadObj(ModelPath(file).c_str(), mesh) || mesh.indices.empty())
+			continue;
+
+		MeshBvh bvh;
+		int iterations = 0;
+		auto start = std::chrono::high_resolution_clock::now();
+		do
+		{
+			bvh.Build(&mesh.vertices[0].position, sizeof(Vertex), &mesh.indices[0], mesh.indices.size());
+			iterations++;
+		} while (SecondsSince(start) < 0.25);
+		double buildSeconds = SecondsSince(start) / iterations;
+
+		// Same rays for every model, scaled to its bounds
+		MeshBounds bounds = ComputeBounds(&mesh.vertices[0], mesh.vertices.size());
+		XMVECTOR center = XMLoadFloat3(&bounds.sphereCenter);
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		std::vector<XMFLOAT3> origins(rayCount);
+		std::vector<XMFLOAT3> directions(rayCount);
+		for (int i = 0; i < rayCount; i++)
+		{
+			XMVECTOR outside = XMVector3Normalize(XMVectorSet(unit(random), unit(random), unit(random), 0));
+			XMVECTOR inside = XMVectorSet(unit(random), unit(random), unit(random), 0);
+			XMVECTOR origin = center + outside * (bounds.sphereRadius * 3.0f);
+			XMVECTOR target = center + inside * bounds.sphereRadius;
+			XMStoreFloat3(&origins[i], origin);
+			XMStoreFloat3(&directions[i], XMVector3Normalize(target - origin));
+		}
+
+		std::vector<RayHit> hits(rayCount);
+		std::vector<char> hitAnything(rayCount);
+		int hitCount = 0;
+		start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < rayCount; i++)
+		{
+			hitAnything[i] = bvh.Raycast(origins[i], directions[i], FLT_MAX, hits[i]);
+			hitCount += hitAnything[i];
+		}
+		double bvhSeconds = SecondsSince(start);
+
+		// Brute force only gets as many rays as it can do in a
+		// quarter second, since it's so much slower
+		int bruteRays = 0;
+		bool agree = true;
+		start = std::chrono::high_resolution_clock::now();
+		for (; bruteRays < rayCount && SecondsSince(start) < 0.25; bruteRays++)
+		{
+			RayHit hit;
+			bool found = BruteForceRaycast(mesh, origins[bruteRays], directions[bruteRays], hit);
+			if (found != (hitAnything[bruteRays] != 0) ||
+				(found && fabsf(hit.distance - hits[bruteRays].distance) > 1e-5f * hit.distance))
+				agree = false;
+		}
+		double bruteSeconds = SecondsSince(start);
+
+		double bvhRate = rayCount / bvhSeconds;
+		double bruteRate = bruteRays / bruteSeconds;
+		sprintf_s(line, "  %-24ls %6zu tris  build %8.3f ms  %5u nodes  depth %2u  %7.2f Mrays/s  brute %7.3f Mrays/s  %6.1fx  %3d%% hit  %s",
+			file,
+			mesh.indices.size() / 3,
+			buildSeconds * 1000.0,
+			bvh.GetNodeCount(),
+			bvh.GetDepth(),
+			bvhRate / 1e6,
+			bruteRate / 1e6,
+			bvhRate / bruteRate,
+			hitCount * 100 / rayCount,
+			agree ? "agree" : "MISMATCH");
+		Report(report, line);
+	}
+	return report;
+}
+
+// --------------------------------------------------------
+// Picks in a scene of 100,000 entities: a grid of copies of
+// the templates, each nudged, turned and scaled at random
+//
+// - Rays come down from above the scene to random points in
+//   it, so each passes over many entities' boxes
+// - Brute force transforms the ray into every entity's local
+//   space and casts against its mesh, which is what picking
+//   costs without the top-level BVH
+// --------------------------------------------------------
+std::string BenchmarkScenePicking(const std::vector<std::shared_ptr<GameEntity>>& templates)
+{
+	using namespace DirectX;
+	std::string report;
+	char line[256];
+
+	const int gridWidth = 100;
+	const int gridLayers = 10;
+	const float spacing = 6.0f;
+	const int rayCount = 10000;
+
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<std::shared_ptr<GameEntity>> entities;
+	entities.reserve(gridWidth * gridWidth * gridLayers);
+	for (int y = 0; y < gridLayers; y++)
+	{
+		for (int z = 0; z < gridWidth; z++)
+		{
+			for (int x = 0; x < gridWidth; x++)
+			{
+				const std::shared_ptr<GameEntity>& source = templates[entities.size() % templates.size()];
+				std::shared_ptr<GameEntity> entity = std::make_shared<GameEntity>(source->GetMesh(), source->GetMaterial());
+				std::shared_ptr<Transform> transform = entity->GetTransform();
+				transform->SetPosition(
+					x * spacing + unit(random) * 1.5f,
+					y * spacing + unit(random) * 1.5f,
+					z * spacing + unit(random) * 1.5f);
+				transform->SetRotation(unit(random) * XM_PI, unit(random) * XM_PI, unit(random) * XM_PI);
+				float scale = 1.0f + unit(random) * 0.5f;
+				transform->SetScale(scale, scale, scale);
+				entities.push_back(entity);
+			}
+		}
+	}
+
+	sprintf_s(line, "Scene picking (%zu entities, single thread)", entities.size());
+	Report(report, line);
+
+	ScenePicker picker;
+	auto start = std::chrono::high_resolution_clock::now();
+	picker.Build(entities);
+	double buildSeconds = SecondsSince(start);
+
+	// Move everything a little, then catch up
+	for (const std::shared_ptr<GameEntity>& entity : entities)
+		entity->GetTransform()->MoveAbsolute(unit(random) * 0.1f, unit(random) * 0.1f, unit(random) * 0.1f);
+	start = std::chrono::high_resolution_clock::now();
+	unsigned int moved = picker.Refit();
+	double refitSeconds = SecondsSince(start);
+
+	start = std::chrono::high_resolution_clock::now();
+	picker.Refit();
+	double idleRefitSeconds = SecondsSince(start);
+
+	sprintf_s(line, "  Build %.3f ms (%u nodes, depth %u)  refit %.3f ms (%u moved)  refit with nothing moved %.3f ms",
+		buildSeconds * 1000.0,
+		picker.GetNodeCount(),
+		picker.GetDepth(),
+		refitSeconds * 1000.0,
+		moved,
+		idleRefitSeconds * 1000.0);
+	Report(report, line);
+
+	float sceneWidth = gridWidth * spacing;
+	float sceneHeight = gridLayers * spacing;
+	std::vector<XMFLOAT3> origins(rayCount);
+	std::vector<XMFLOAT3> directions(rayCount);
+	for (int i = 0; i < rayCount; i++)
+	{
+		XMVECTOR origin = XMVectorSet(
+			(unit(random) * 0.5f + 0.5f) * sceneWidth,
+			sceneHeight * 2.0f,
+			(unit(random) * 0.5f + 0.5f) * sceneWidth, 0);
+		XMVECTOR target = XMVectorSet(
+			(unit(random) * 0.5f + 0.5f) * sceneWidth,
+			(unit(random) * 0.5f + 0.5f) * sceneHeight,
+			(unit(random) * 0.5f + 0.5f) * sceneWidth, 0);
+		XMStoreFloat3(&origins[i], origin);
+		XMStoreFloat3(&directions[i], XMVector3Normalize(target - origin));
+	}
+
+	std::vector<PickHit> hits(rayCount);
+	std::vector<char> hitAnything(rayCount);
+	int hitCount = 0;
+	double slowestSeconds = 0.0;
+	start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < rayCount; i++)
+	{
+		auto rayStart = std::chrono::high_resolution_clock::now();
+		hitAnything[i] = picker.Raycast(origins[i], directions[i], FLT_MAX, hits[i]);
+		slowestSeconds = std::max(slowestSeconds, SecondsSince(rayStart));
+		hitCount += hitAnything[i];
+	}
+	double pickSeconds = SecondsSince(start);
+
+	// Brute force only gets as many rays as it can do in a
+	// quarter second, since it's so much slower
+	int bruteRays = 0;
+	bool agree = true;
+	start = std::chrono::high_resolution_clock::now();
+	for (; bruteRays < rayCount && SecondsSince(start) < 0.25; bruteRays++)
+	{
+		int closestEntity = -1;
+		float closest = FLT_MAX;
+		XMVECTOR origin = XMLoadFloat3(&origins[bruteRays]);
+		XMVECTOR direction = XMLoadFloat3(&directions[bruteRays]);
+		for (size_t e = 0; e < entities.size(); e++)
+		{
+			XMFLOAT4X4 world = entities[e]->GetTransform()->GetWorldMatrix();
+			XMMATRIX inverse = XMMatrixInverse(nullptr, XMLoadFloat4x4(&world));
+			XMFLOAT3 localOrigin;
+			XMFLOAT3 localDirection;
+			XMStoreFloat3(&localOrigin, XMVector3TransformCoord(origin, inverse));
+			XMStoreFloat3(&localDirection, XMVector3TransformNormal(direction, inverse));
+
+			RayHit hit;
+			if (entities[e]->GetMesh()->Raycast(localOrigin, localDirection, closest, hit))
+			{
+				closest = hit.distance;
+				closestEntity = (int)e;
+			}
+		}
+
+		// Entities can tie where they overlap, so compare distances
+		bool found = closestEntity >= 0;
+		if (found != (hitAnything[bruteRays] != 0) ||
+			(found && fabsf(closest - hits[bruteRays].distance) > 1e-4f * closest))
+			agree = false;
+	}
+	double bruteSeconds = SecondsSince(start);
+
+	sprintf_s(line, "  %d picks: %.2f us each (slowest %.2f us)  brute force %.2f ms each  %.0fx  %d%% hit  %s",
+		rayCount,
+		pickSeconds / rayCount * 1e6,
+		slowestSeconds * 1e6,
+		bruteSeconds / bruteRays * 1000.0,
+		(bruteSeconds / bruteRays) / (pickSeconds / rayCount),
+		hitCount * 100 / rayCount,
+		agree ? "agree" : "MISMATCH");
+	Report(report, line);
+	return report;
+}
+
+// --------------------------------------------------------
+// MeshCodec ratios and speeds on every model, prepared the
+// way a cooked file's arrays are (tangents, then OptimizeMesh),
+// plus a generated grid big enough to time properly
+//
+// - Decode speeds are in raw (decoded) bytes per second
+// - "Wins below" is the disk speed under which reading the
+//   encoded arrays and decoding them is faster than reading
+//   the raw ones
+// - "Warm load" is measured: each mesh cooked both ways, then
+//   loaded the way Mesh does (see ReportCookedLoads()); raw
+//   files are the default since they upload without a copy
+// --------------------------------------------------------
+std::string BenchmarkMeshCompression()
+{
+	std::string report;
+	Report(report, "Mesh compression (vertices / indices, single thread)");
+
+	for (const wchar_t* file : modelFiles)
+	{
+		ObjMeshData mesh;
+		if (!LoadObj(ModelPath(file).c_str(), mesh) || mesh.indices.empty())
+			continue;
+
+		GenerateTangents(&mesh.vertices[0], mesh.vertices.size(), &mesh.indices[0], mesh.indices.size());
+		OptimizeMesh(mesh.vertices, mesh.indices);
+		ReportCompression(report, file, mesh.vertices, mesh.indices);
+		ReportCookedLoads(report, file, mesh.vertices, mesh.indices);
+	}
+
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	MakeLargeGrid(300, vertices, indices);
+	GenerateTangents(&vertices[0], vertices.size(), &indices[0], indices.size());
+	OptimizeMesh(vertices, indices);
+	ReportCompression(report, L"Generated grid", vertices, indices);
+	ReportCookedLoads(report, L"Generated grid", vertices, indices);
+	return report;
+}
+
+// --------------------------------------------------------
+// Rebuilding world and inverse-transpose matrices after
+// transforms move, with every transform moving and then only
+// every tenth one
+//
+// - "Per object" is the old Transform (see LegacyTransform),
+//   asked for its matrices one object at a time like Draw does
+// - "Per slot" asks the TransformSystem slot by slot, which is
+//   what transforms read before the frame's batch get
+// - "Batched" is a single TransformSystem::UpdateMatrices()
+// - Each size gets a TransformSystem of its own, so the game's
+//   isn't left holding a million slots
+// --------------------------------------------------------
+std::string BenchmarkTransformUpdates()
+{
+	using namespace DirectX;
+	std::string report;
+	char line[256];
+	Report(report, "Transform updates (world + inverse transpose, single thread)");
+
+	const unsigned int counts[] = { 10000, 100000, 1000000 };
+	for (unsigned int count : counts)
+	{
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+		TransformSystem system;
+		std::vector<Transform> transforms;
+		std::vector<std::shared_ptr<LegacyTransform>> legacy(count);
+		transforms.reserve(count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			XMFLOAT3 position(unit(random) * 100.0f, unit(random) * 100.0f, unit(random) * 100.0f);
+			XMFLOAT3 rotation(unit(random) * XM_PI, unit(random) * XM_PI, unit(random) * XM_PI);
+			XMFLOAT3 scale(1.0f + unit(random) * 0.5f, 1.0f + unit(random) * 0.5f, 1.0f + unit(random) * 0.5f);
+
+			transforms.emplace_back(system);
+			transforms[i].SetPosition(position);
+			transforms[i].SetRotation(rotation);
+			transforms[i].SetScale(scale);
+
+			legacy[i] = std::make_shared<LegacyTransform>();
+			legacy[i]->position = position;
+			legacy[i]->rotation = rotation;
+			legacy[i]->scale = scale;
+			legacy[i]->matrixChanged = true;
+		}
+
+		const unsigned int strides[] = { 1, 10 };
+		for (unsigned int stride : strides)
+		{
+			double legacySeconds = TimeRebuilds(count, stride,
+				[&](unsigned int i) { legacy[i]->matrixChanged = true; },
+				[&]()
+				{
+					for (unsigned int i = 0; i < count; i++)
+						legacy[i]->UpdateMatrices();
+				});
+
+			double slotSeconds = TimeRebuilds(count, stride,
+				[&](unsigned int i) { transforms[i].SetScale(transforms[i].GetScale()); },
+				[&]()
+				{
+					for (unsigned int i = 0; i < count; i++)
+						system.GetWorldMatrix(transforms[i].GetSlot());
+				});
+
+			double batchSeconds = TimeRebuilds(count, stride,
+				[&](unsigned int i) { transforms[i].SetScale(transforms[i].GetScale()); },
+				[&]() { system.UpdateMatrices(); });
+
+			bool agree = true;
+			for (unsigned int i = 0; i < count && agree; i++)
+			{
+				agree =
+					MatricesMatch(legacy[i]->world, system.GetWorldMatrix(transforms[i].GetSlot())) &&
+					MatricesMatch(legacy[i]->worldInverseTranspose, system.GetWorldInverseTransposeMatrix(transforms[i].GetSlot()));
+			}
+
+			unsigned int moved = (count + stride - 1) / stride;
+			sprintf_s(line, "  %7u transforms, %3u%% moved: per object %7.2f ns  per slot %7.2f ns  batched %6.2f ns per moved transform  %5.1fx  %s",
+				count,
+				100 / stride,
+				legacySeconds / moved * 1e9,
+				slotSeconds / moved * 1e9,
+				batchSeconds / moved * 1e9,
+				legacySeconds / batchSeconds,
+				agree ? "agree" : "MISMATCH");
+			Report(report, line);
+		}
+	}
+	return report;
+}
+
+// --------------------------------------------------------
+// TransformSystem's hierarchy sweep on two scenes of 100,000
+// transforms:
+// - Wide: 1,000 roots with 99 children each
+// - Deep: 100 chains of 1,000, each the parent of the next
+//
+// Each is timed with every root moving (so everything is
+// rebuilt), one root moving (one subtree), one leaf moving and
+// nothing moving; the sweep's time should follow how many
+// transforms it rebuilt rather than how many there are
+// --------------------------------------------------------
+std::string BenchmarkTransformHierarchy()
+{
+	using namespace DirectX;
+	std::string report;
+	char line[256];
+	Report(report, "Transform hierarchy updates (single thread)");
+
+	struct Scene
+	{
+		const char* name;
+		unsigned int roots;
+		unsigned int perRoot;
+		bool chains;
+	};
+	const Scene scenes[] =
+	{
+		{ "Wide", 1000, 100, false },
+		{ "Deep", 100, 1000, true },
+	};
+
+	for (const Scene& scene : scenes)
+	{
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+		TransformSystem system;
+		std::vector<Transform> transforms;
+		transforms.reserve(scene.roots * scene.perRoot);
+		for (unsigned int r = 0; r < scene.roots; r++)
+		{
+			unsigned int root = (unsigned int)transforms.size();
+			transforms.emplace_back(system);
+			transforms[root].SetPosition(unit(random) * 100.0f, 0.0f, unit(random) * 100.0f);
+
+			for (unsigned int c = 1; c < scene.perRoot; c++)
+			{
+				unsigned int parent = scene.chains ? root + c - 1 : root;
+				transforms.emplace_back(system);
+				Transform& child = transforms.back();
+				child.SetParent(&transforms[parent]);
+				if (scene.chains)
+				{
+					child.SetPosition(0.0f, 0.05f, 0.0f);
+					child.SetRotation(0.002f, 0.003f, 0.0f);
+				}
+				else
+				{
+					child.SetPosition(unit(random) * 5.0f, unit(random) * 5.0f, unit(random) * 5.0f);
+					child.SetRotation(unit(random) * XM_PI, unit(random) * XM_PI, 0.0f);
+				}
+			}
+		}
+		system.UpdateMatrices();
+
+		struct Case
+		{
+			const char* name;
+			unsigned int moving;
+			unsigned int stride;
+			unsigned int first;
+		};
+		const Case cases[] =
+		{
+			{ "every root moves", scene.roots, scene.perRoot, 0 },
+			{ "one root moves", 1, 1, 0 },
+			{ "one leaf moves", 1, 1, (unsigned int)transforms.size() - 1 },
+			{ "nothing moves", 0, 1, 0 },
+		};
+
+		for (const Case& test : cases)
+		{
+			unsigned int rebuilt = 0;
+			double seconds = TimeRebuilds(test.moving * test.stride, test.stride,
+				[&](unsigned int i)
+				{
+					Transform& moving = transforms[test.first + i];
+					moving.SetPosition(moving.GetPosition());
+				},
+				[&]() { rebuilt = system.UpdateMatrices(); });
+
+			sprintf_s(line, "  %s (%u x %u)  %-16s  %6u rebuilt  %9.2f us  %6.2f ns per rebuilt transform",
+				scene.name,
+				scene.roots,
+				scene.perRoot,
+				test.name,
+				rebuilt,
+				seconds * 1e6,
+				rebuilt > 0 ? seconds / rebuilt * 1e9 : 0.0);
+			Report(report, line);
+		}
+	}
+	return report;
+}
+
+// --------------------------------------------------------
+// What storing rotations as quaternions saves, per transform,
+// over 100,000 random rotations
+//
+// - "Rotation rows" is just the rotation part of the matrix
+//   sweep: three SIMD sin/cos per four Euler rotations before,
+//   multiplies and adds only now
+// - "Matrix sweep" is the whole TransformSystem::UpdateMatrices()
+//   as it runs now
+// - "MoveRelative" turned pitch/yaw/roll into a quaternion on
+//   every call before (see LegacyTransform); now it rotates by
+//   the stored one
+// --------------------------------------------------------
+std::string BenchmarkTransformRotations()
+{
+	using namespace DirectX;
+	std::string report;
+	char line[256];
+	Report(report, "Transform rotations (100,000 transforms, single thread)");
+
+	const unsigned int count = 100000;
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	std::vector<float> pitch(count), yaw(count), roll(count);
+	std::vector<float> rotationX(count), rotationY(count), rotationZ(count), rotationW(count);
+	std::vector<LegacyTransform> legacy(count);
+	TransformSystem system;
+	std::vector<Transform> transforms;
+	transforms.reserve(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		XMFLOAT3 rotation(unit(random) * XM_PI, unit(random) * XM_PI, unit(random) * XM_PI);
+		pitch[i] = rotation.x;
+		yaw[i] = rotation.y;
+		roll[i] = rotation.z;
+
+		XMFLOAT4 quaternion;
+		XMStoreFloat4(&quaternion, XMQuaternionRotationRollPitchYaw(rotation.x, rotation.y, rotation.z));
+		rotationX[i] = quaternion.x;
+		rotationY[i] = quaternion.y;
+		rotationZ[i] = quaternion.z;
+		rotationW[i] = quaternion.w;
+
+		legacy[i].position = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		legacy[i].rotation = rotation;
+		legacy[i].scale = XMFLOAT3(1.0f, 1.0f, 1.0f);
+		transforms.emplace_back(system);
+		transforms[i].SetRotation(rotation);
+	}
+
+	XMVECTOR sum = XMVectorZero();
+	double eulerSeconds = TimeRebuilds(0, 1, [](unsigned int) {},
+		[&]()
+		{
+			for (unsigned int i = 0; i < count; i += 4)
+				EulerRotationRows(&pitch[i], &yaw[i], &roll[i], sum);
+		});
+	double quaternionSeconds = TimeRebuilds(0, 1, [](unsigned int) {},
+		[&]()
+		{
+			for (unsigned int i = 0; i < count; i += 4)
+				QuaternionRotationRows(&rotationX[i], &rotationY[i], &rotationZ[i], &rotationW[i], sum);
+		});
+	sprintf_s(line, "  Rotation rows   Euler %6.2f ns  quaternion %6.2f ns  %5.1fx  (checksum %g)",
+		eulerSeconds / count * 1e9,
+		quaternionSeconds / count * 1e9,
+		eulerSeconds / quaternionSeconds,
+		XMVectorGetX(sum));
+	Report(report, line);
+
+	double sweepSeconds = TimeRebuilds(count, 1,
+		[&](unsigned int i) { transforms[i].SetPosition(transforms[i].GetPosition()); },
+		[&]() { system.UpdateMatrices(); });
+	sprintf_s(line, "  Matrix sweep    %6.2f ns", sweepSeconds / count * 1e9);
+	Report(report, line);
+
+	XMFLOAT3 offset(0.0f, 0.0f, 0.001f);
+	double legacyMoveSeconds = TimeRebuilds(0, 1, [](unsigned int) {},
+		[&]()
+		{
+			for (LegacyTransform& transform : legacy)
+			{
+				XMVECTOR rotationQuat = XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&transform.rotation));
+				XMVECTOR moved = XMLoadFloat3(&transform.position) + XMVector3Rotate(XMLoadFloat3(&offset), rotationQuat);
+				XMStoreFloat3(&transform.position, moved);
+				transform.matrixChanged = true;
+			}
+		});
+	double moveSeconds = TimeRebuilds(0, 1, [](unsigned int) {},
+		[&]()
+		{
+			for (Transform& transform : transforms)
+				transform.MoveRelative(offset);
+		});
+	sprintf_s(line, "  MoveRelative    Euler %6.2f ns  quaternion %6.2f ns  %5.1fx",
+		legacyMoveSeconds / count * 1e9,
+		moveSeconds / count * 1e9,
+		legacyMoveSeconds / moveSeconds);
+	Report(report, line);
+	return report;
+}
+
+// --------------------------------------------------------
+// What each transform class costs, over 100,000 randomly
+// placed and rotated transforms per class:
+// - Rigid: scale 1
+// - Uniform: scale 2
+// - Per axis: scale (1, 2, 3)
+// - General: scale 1, under a rotated parent scaled (1, 2, 3)
+//
+// Each reports the matrix sweep (world matrices only), then
+// the inverse transpose built lazily for every transform, then
+// the XMMatrixInverse() every transform used to pay for it
+// --------------------------------------------------------
+std::string BenchmarkTransformClasses()
+{
+	using namespace DirectX;
+	std::string report;
+	char line[256];
+	Report(report, "Transform classes (100,000 transforms each, single thread)");
+
+	struct Class
+	{
+		const char* name;
+		unsigned char expected;
+		XMFLOAT3 scale;
+		bool underSkewingParent;
+	};
+	const Class classes[] =
+	{
+		{ "Rigid", transformRigid, XMFLOAT3(1.0f, 1.0f, 1.0f), false },
+		{ "Uniform", transformUniformScale, XMFLOAT3(2.0f, 2.0f, 2.0f), false },
+		{ "Per axis", transformAxisScale, XMFLOAT3(1.0f, 2.0f, 3.0f), false },
+		{ "General", transformGeneral, XMFLOAT3(1.0f, 1.0f, 1.0f), true },
+	};
+
+	const unsigned int count = 100000;
+	for (const Class& test : classes)
+	{
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+		TransformSystem system;
+		Transform parent(system);
+		parent.SetRotation(0.3f, 0.7f, 0.1f);
+		parent.SetScale(1.0f, 2.0f, 3.0f);
+
+		std::vector<Transform> transforms;
+		transforms.reserve(count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			transforms.emplace_back(system);
+			transforms[i].SetPosition(unit(random) * 100.0f, unit(random) * 100.0f, unit(random) * 100.0f);
+			transforms[i].SetRotation(unit(random) * XM_PI, unit(random) * XM_PI, unit(random) * XM_PI);
+			transforms[i].SetScale(test.scale);
+			if (test.underSkewingParent)
+				transforms[i].SetParent(&parent);
+		}
+		system.UpdateMatrices();
+
+		auto moveAll = [&]()
+		{
+			for (Transform& transform : transforms)
+				transform.SetPosition(transform.GetPosition());
+		};
+
+		double sweepSeconds = TimeRebuilds(1, 1,
+			[&](unsigned int) { moveAll(); },
+			[&]() { system.UpdateMatrices(); });
+
+		double lazySeconds = TimeRebuilds(1, 1,
+			[&](unsigned int)
+			{
+				moveAll();
+				system.UpdateMatrices();
+			},
+			[&]()
+			{
+				for (Transform& transform : transforms)
+					system.GetWorldInverseTransposeMatrix(transform.GetSlot());
+			});
+
+		std::vector<XMFLOAT4X4> inverses(count);
+		double fullSeconds = TimeRebuilds(0, 1, [](unsigned int) {},
+			[&]()
+			{
+				for (unsigned int i = 0; i < count; i++)
+				{
+					XMMATRIX world = XMLoadFloat4x4(&system.GetWorldMatrix(transforms[i].GetSlot()));
+					XMStoreFloat4x4(&inverses[i], XMMatrixInverse(0, XMMatrixTranspose(world)));
+				}
+			});
+
+		bool agree = transforms[0].GetClass() == test.expected;
+		for (unsigned int i = 0; i < count && agree; i++)
+			agree = MatricesMatch(inverses[i], system.GetWorldInverseTransposeMatrix(transforms[i].GetSlot()));
+
+		sprintf_s(line, "  %-8s  sweep %6.2f ns  inverse transpose %6.2f ns  (XMMatrixInverse %6.2f ns)  %5.1fx  %s",
+			test.name,
+			sweepSeconds / count * 1e9,
+			lazySeconds / count * 1e9,
+			fullSeconds / count * 1e9,
+			fullSeconds / lazySeconds,
+			agree ? "agree" : "MISMATCH");
+		Report(report, line);
+	}
+	return report;
+}
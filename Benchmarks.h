@@ -0,0 +1,36 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <d3d11.h>
+#include <wrl/client.h>
+
+class GameEntity;
+
+// --------------------------------------------------------
+// Micro benchmarks that can be run from the ImGui window
+//
+// - Each one prints its report to the console (if there is
+//   one) and also returns it so it can be shown in the UI
+// - Run them in Release; Debug numbers mean very little
+// --------------------------------------------------------
+std::string BenchmarkObjParsing();
+std::string BenchmarkParallelObjParsing();
+std::string BenchmarkGlbLoading();
+std::string BenchmarkVertexWelding();
+std::string BenchmarkMeshOptimization();
+std::string BenchmarkTangentGeneration();
+std::string BenchmarkStreamingImport();
+std::string BenchmarkMeshRaycasts();
+std::string BenchmarkMeshCompression();
+std::string BenchmarkTransformUpdates();
+std::string BenchmarkTransformHierarchy();
+std::string BenchmarkTransformRotations();
+std::string BenchmarkTransformClasses();
+
+// Scatters copies of the given entities (their meshes and
+// materials) into a scene of 100,000 to pick from
+std::string BenchmarkScenePicking(const std::vector<std::shared_ptr<GameEntity>>& templates);
+std::string BenchmarkSceneLoading(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
@@ -0,0 +1,182 @@
+#include "Bounds.h"
+
+#include <cmath>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Finds the axis-aligned box around all of the vertices,
+// plus the tighter of two spheres that hold them all
+//
+// - The box is a min/max reduction over four vertices at a
+//   time, with four independent accumulators so that no
+//   iteration waits on the one before it
+// - Sphere 1 is Ritter's: start with the most distant pair
+//   of extreme points, then grow just enough to take in any
+//   vertex that's outside.  Usually much tighter than...
+// - Sphere 2, which is centered on the box.  This wins for
+//   some boxy shapes, so the smaller of the two is kept.
+// - Both radii are measured exactly in a final pass, so the
+//   spheres always hold every vertex despite rounding
+// --------------------------------------------------------
+MeshBounds ComputeBounds(const XMFLOAT3* positions, size_t vertexCount, size_t stride)
+{
+	MeshBounds bounds = {};
+	if (vertexCount == 0)
+		return bounds;
+
+	auto positionAt = [=](size_t i) -> const XMFLOAT3&
+	{
+		return *(const XMFLOAT3*)((const char*)positions + i * stride);
+	};
+
+	XMVECTOR min0 = XMLoadFloat3(&positionAt(0));
+	XMVECTOR min1 = min0, min2 = min0, min3 = min0;
+	XMVECTOR max0 = min0, max1 = min0, max2 = min0, max3 = min0;
+
+	size_t i = 1;
+	for (; i + 4 <= vertexCount; i += 4)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&positionAt(i + 0));
+		XMVECTOR p1 = XMLoadFloat3(&positionAt(i + 1));
+		XMVECTOR p2 = XMLoadFloat3(&positionAt(i + 2));
+		XMVECTOR p3 = XMLoadFloat3(&positionAt(i + 3));
+		min0 = XMVectorMin(min0, p0);
+		min1 = XMVectorMin(min1, p1);
+		min2 = XMVectorMin(min2, p2);
+		min3 = XMVectorMin(min3, p3);
+		max0 = XMVectorMax(max0, p0);
+		max1 = XMVectorMax(max1, p1);
+		max2 = XMVectorMax(max2, p2);
+		max3 = XMVectorMax(max3, p3);
+	}
+	for (; i < vertexCount; i++)
+	{
+		XMVECTOR p = XMLoadFloat3(&positionAt(i));
+		min0 = XMVectorMin(min0, p);
+		max0 = XMVectorMax(max0, p);
+	}
+
+	XMVECTOR minV = XMVectorMin(XMVectorMin(min0, min1), XMVectorMin(min2, min3));
+	XMVECTOR maxV = XMVectorMax(XMVectorMax(max0, max1), XMVectorMax(max2, max3));
+	XMStoreFloat3(&bounds.aabbMin, minV);
+	XMStoreFloat3(&bounds.aabbMax, maxV);
+
+	// The vertices that touch each face of the box
+	// - Compared against the box itself, so the first match wins
+	const float boxMin[3] = { bounds.aabbMin.x, bounds.aabbMin.y, bounds.aabbMin.z };
+	const float boxMax[3] = { bounds.aabbMax.x, bounds.aabbMax.y, bounds.aabbMax.z };
+	size_t minIndex[3] = { vertexCount, vertexCount, vertexCount };
+	size_t maxIndex[3] = { vertexCount, vertexCount, vertexCount };
+	for (i = 0; i < vertexCount; i++)
+	{
+		const XMFLOAT3& p = positionAt(i);
+		const float coords[3] = { p.x, p.y, p.z };
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (minIndex[axis] == vertexCount && coords[axis] == boxMin[axis])
+				minIndex[axis] = i;
+			if (maxIndex[axis] == vertexCount && coords[axis] == boxMax[axis])
+				maxIndex[axis] = i;
+		}
+	}
+
+	// Ritter's starting sphere spans the farthest apart pair
+	XMVECTOR a = XMLoadFloat3(&positionAt(0));
+	XMVECTOR b = a;
+	float widestSq = 0.0f;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (minIndex[axis] == vertexCount || maxIndex[axis] == vertexCount)
+			continue;	// Only possible with NaNs
+
+		XMVECTOR lowest = XMLoadFloat3(&positionAt(minIndex[axis]));
+		XMVECTOR highest = XMLoadFloat3(&positionAt(maxIndex[axis]));
+		float distanceSq = XMVectorGetX(XMVector3LengthSq(highest - lowest));
+		if (distanceSq > widestSq)
+		{
+			widestSq = distanceSq;
+			a = lowest;
+			b = highest;
+		}
+	}
+
+	XMVECTOR ritterCenter = (a + b) * 0.5f;
+	float ritterRadius = sqrtf(widestSq) * 0.5f;
+	for (i = 0; i < vertexCount; i++)
+	{
+		XMVECTOR p = XMLoadFloat3(&positionAt(i));
+		float distance = XMVectorGetX(XMVector3Length(p - ritterCenter));
+		if (distance > ritterRadius)
+		{
+			// Slide the center toward p and widen just enough to
+			// keep the far side of the old sphere inside
+			float newRadius = (ritterRadius + distance) * 0.5f;
+			ritterCenter = ritterCenter + (p - ritterCenter) * ((newRadius - ritterRadius) / distance);
+			ritterRadius = newRadius;
+		}
+	}
+
+	// Exact radii for both candidates
+	XMVECTOR boxCenter = (minV + maxV) * 0.5f;
+	XMVECTOR boxRadiusSq = XMVectorZero();
+	XMVECTOR ritterRadiusSq = XMVectorZero();
+	for (i = 0; i < vertexCount; i++)
+	{
+		XMVECTOR p = XMLoadFloat3(&positionAt(i));
+		boxRadiusSq = XMVectorMax(boxRadiusSq, XMVector3LengthSq(p - boxCenter));
+		ritterRadiusSq = XMVectorMax(ritterRadiusSq, XMVector3LengthSq(p - ritterCenter));
+	}
+
+	if (XMVectorGetX(ritterRadiusSq) < XMVectorGetX(boxRadiusSq))
+	{
+		XMStoreFloat3(&bounds.sphereCenter, ritterCenter);
+		bounds.sphereRadius = sqrtf(XMVectorGetX(ritterRadiusSq));
+	}
+	else
+	{
+		XMStoreFloat3(&bounds.sphereCenter, boxCenter);
+		bounds.sphereRadius = sqrtf(XMVectorGetX(boxRadiusSq));
+	}
+	return bounds;
+}
+
+// Vertex arrays are just positions with a wider stride
+MeshBounds ComputeBounds(const Vertex* vertices, size_t vertexCount)
+{
+	if (vertexCount == 0)
+		return MeshBounds();
+	return ComputeBounds(&vertices[0].position, vertexCount, sizeof(Vertex));
+}
+
+// --------------------------------------------------------
+// - The box's center is transformed, and its half extents
+//   become the sum of each axis's absolute contribution
+//   (Arvo's method) - exact for the transformed box's corners
+// - The sphere's radius grows by the largest scale on any of
+//   the matrix's axes, which holds for non-uniform scale too
+// --------------------------------------------------------
+MeshBounds TransformBounds(const MeshBounds& bounds, const XMFLOAT4X4& world)
+{
+	XMMATRIX m = XMLoadFloat4x4(&world);
+	XMVECTOR minV = XMLoadFloat3(&bounds.aabbMin);
+	XMVECTOR maxV = XMLoadFloat3(&bounds.aabbMax);
+	XMVECTOR center = XMVector3Transform((minV + maxV) * 0.5f, m);
+	XMVECTOR extents = (maxV - minV) * 0.5f;
+
+	XMVECTOR worldExtents =
+		XMVectorAbs(m.r[0]) * XMVectorSplatX(extents) +
+		XMVectorAbs(m.r[1]) * XMVectorSplatY(extents) +
+		XMVectorAbs(m.r[2]) * XMVectorSplatZ(extents);
+
+	MeshBounds result;
+	XMStoreFloat3(&result.aabbMin, center - worldExtents);
+	XMStoreFloat3(&result.aabbMax, center + worldExtents);
+	XMStoreFloat3(&result.sphereCenter, XMVector3Transform(XMLoadFloat3(&bounds.sphereCenter), m));
+
+	XMVECTOR maxScaleSq = XMVectorMax(
+		XMVector3LengthSq(m.r[0]),
+		XMVectorMax(XMVector3LengthSq(m.r[1]), XMVector3LengthSq(m.r[2])));
+	result.sphereRadius = bounds.sphereRadius * sqrtf(XMVectorGetX(maxScaleSq));
+	return result;
+}
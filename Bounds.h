@@ -0,0 +1,26 @@
+#pragma once
+#include <DirectXMath.h>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Extents of a mesh, either in its local space or (after
+// TransformBounds) in world space
+// --------------------------------------------------------
+struct MeshBounds
+{
+	DirectX::XMFLOAT3 aabbMin;
+	DirectX::XMFLOAT3 aabbMax;
+	DirectX::XMFLOAT3 sphereCenter;
+	float sphereRadius;
+};
+
+// Finds the box and a tight sphere around every vertex
+MeshBounds ComputeBounds(const Vertex* vertices, size_t vertexCount);
+
+// The same, for positions that are stride bytes apart
+MeshBounds ComputeBounds(const DirectX::XMFLOAT3* positions, size_t vertexCount, size_t stride = sizeof(DirectX::XMFLOAT3));
+
+// Moves local bounds into the space of a (row-vector) world
+// matrix - the results still contain everything, but the box
+// grows if the matrix rotates it
+MeshBounds TransformBounds(const MeshBounds& bounds, const DirectX::XMFLOAT4X4& world);
@@ -0,0 +1,400 @@
+#include "Bvh.h"
+
+#include <algorithm>
+#include <cfloat>
+
+using namespace DirectX;
+
+namespace
+{
+	// Centroids are sorted into this many bins along each axis
+	// when looking for the cheapest split
+	const int sahBinCount = 16;
+
+	// Past this depth every split is a median split, which halves
+	// the items each time and so bounds the total depth (and the
+	// traversal stack) no matter how the SAH splits went
+	const unsigned int sahMaxDepth = 48;
+
+	BvhBox EmptyBox()
+	{
+		BvhBox box = { XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX), XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX) };
+		return box;
+	}
+
+	void Grow(BvhBox& box, const XMFLOAT3& p)
+	{
+		box.min = XMFLOAT3(std::min(box.min.x, p.x), std::min(box.min.y, p.y), std::min(box.min.z, p.z));
+		box.max = XMFLOAT3(std::max(box.max.x, p.x), std::max(box.max.y, p.y), std::max(box.max.z, p.z));
+	}
+
+	void Grow(BvhBox& box, const BvhBox& other)
+	{
+		Grow(box, other.min);
+		Grow(box, other.max);
+	}
+
+	// Half the surface area, which is all the SAH needs since
+	// only ratios of areas matter
+	float HalfArea(const BvhBox& box)
+	{
+		float x = box.max.x - box.min.x;
+		float y = box.max.y - box.min.y;
+		float z = box.max.z - box.min.z;
+		if (x < 0 || y < 0 || z < 0)
+			return 0.0f;
+		return x * y + y * z + z * x;
+	}
+
+	inline float Axis(const XMFLOAT3& v, int axis)
+	{
+		return (&v.x)[axis];
+	}
+
+	// A node of the binary tree, before it's collapsed
+	// - Leaves have no children and own [first, first + count)
+	//   of the build order
+	struct BinaryNode
+	{
+		BvhBox box;
+		unsigned int left;
+		unsigned int right;
+		unsigned int first;
+		unsigned int count;
+	};
+
+	// --------------------------------------------------------
+	// Builds the binary tree top-down, reordering "order" so
+	// that every node's items are contiguous
+	//
+	// - Each split tries sahBinCount - 1 planes on each axis
+	//   and keeps the one with the lowest SAH cost:
+	//     area(left) * count(left) + area(right) * count(right)
+	// - A node becomes a leaf when it's small enough and no
+	//   split beats testing all of its items
+	// - Nodes whose centroids all coincide (or that are too
+	//   deep) are split at the median instead
+	// --------------------------------------------------------
+	std::vector<BinaryNode> BuildBinaryTree(
+		const std::vector<BvhBox>& boxes,
+		const std::vector<XMFLOAT3>& centroids,
+		unsigned int maxLeafSize,
+		std::vector<unsigned int>& order)
+	{
+		std::vector<BinaryNode> tree;
+		tree.reserve(order.size() * 2);
+
+		BinaryNode root = {};
+		root.count = (unsigned int)order.size();
+		tree.push_back(root);
+
+		struct Work
+		{
+			unsigned int node;
+			unsigned int depth;
+		};
+		std::vector<Work> stack;
+		stack.push_back({ 0, 0 });
+
+		while (!stack.empty())
+		{
+			Work work = stack.back();
+			stack.pop_back();
+
+			unsigned int first = tree[work.node].first;
+			unsigned int count = tree[work.node].count;
+
+			BvhBox box = EmptyBox();
+			BvhBox centroidBox = EmptyBox();
+			for (unsigned int i = first; i < first + count; i++)
+			{
+				Grow(box, boxes[order[i]]);
+				Grow(centroidBox, centroids[order[i]]);
+			}
+			tree[work.node].box = box;
+
+			if (count <= 1)
+				continue;
+
+			// Cheapest binned split
+			float bestCost = FLT_MAX;
+			int bestAxis = -1;
+			int bestBin = 0;
+			for (int axis = 0; axis < 3 && work.depth < sahMaxDepth; axis++)
+			{
+				float low = Axis(centroidBox.min, axis);
+				float extent = Axis(centroidBox.max, axis) - low;
+				if (!(extent > 0.0f))
+					continue;
+
+				float scale = sahBinCount / extent;
+				BvhBox binBoxes[sahBinCount];
+				unsigned int binCounts[sahBinCount] = {};
+				for (int b = 0; b < sahBinCount; b++)
+					binBoxes[b] = EmptyBox();
+
+				for (unsigned int i = first; i < first + count; i++)
+				{
+					int b = std::min(sahBinCount - 1, (int)((Axis(centroids[order[i]], axis) - low) * scale));
+					Grow(binBoxes[b], boxes[order[i]]);
+					binCounts[b]++;
+				}
+
+				// Sweep from the right for the right side's costs, then
+				// from the left to try every split plane
+				float rightCosts[sahBinCount];
+				BvhBox right = EmptyBox();
+				unsigned int rightCount = 0;
+				for (int b = sahBinCount - 1; b > 0; b--)
+				{
+					Grow(right, binBoxes[b]);
+					rightCount += binCounts[b];
+					rightCosts[b] = HalfArea(right) * rightCount;
+				}
+
+				BvhBox left = EmptyBox();
+				unsigned int leftCount = 0;
+				for (int b = 0; b < sahBinCount - 1; b++)
+				{
+					Grow(left, binBoxes[b]);
+					leftCount += binCounts[b];
+					if (leftCount == 0 || leftCount == count)
+						continue;
+
+					float cost = HalfArea(left) * leftCount + rightCosts[b + 1];
+					if (cost < bestCost)
+					{
+						bestCost = cost;
+						bestAxis = axis;
+						bestBin = b;
+					}
+				}
+			}
+
+			// Not worth splitting
+			float leafCost = HalfArea(box) * count;
+			if (count <= maxLeafSize && (bestAxis < 0 || leafCost <= bestCost))
+				continue;
+
+			unsigned int middle = first;
+			if (bestAxis >= 0)
+			{
+				float low = Axis(centroidBox.min, bestAxis);
+				float scale = sahBinCount / (Axis(centroidBox.max, bestAxis) - low);
+				middle = (unsigned int)(std::partition(
+					order.begin() + first,
+					order.begin() + first + count,
+					[&](unsigned int t)
+					{
+						return std::min(sahBinCount - 1, (int)((Axis(centroids[t], bestAxis) - low) * scale)) <= bestBin;
+					}) - order.begin());
+			}
+
+			// Median split along the widest axis
+			if (middle == first || middle == first + count)
+			{
+				int axis = 0;
+				XMFLOAT3 extent(
+					centroidBox.max.x - centroidBox.min.x,
+					centroidBox.max.y - centroidBox.min.y,
+					centroidBox.max.z - centroidBox.min.z);
+				if (extent.y > Axis(extent, axis)) axis = 1;
+				if (extent.z > Axis(extent, axis)) axis = 2;
+
+				middle = first + count / 2;
+				std::nth_element(
+					order.begin() + first,
+					order.begin() + middle,
+					order.begin() + first + count,
+					[&](unsigned int a, unsigned int b) { return Axis(centroids[a], axis) < Axis(centroids[b], axis); });
+			}
+
+			BinaryNode leftNode = {};
+			leftNode.first = first;
+			leftNode.count = middle - first;
+			BinaryNode rightNode = {};
+			rightNode.first = middle;
+			rightNode.count = first + count - middle;
+
+			unsigned int leftIndex = (unsigned int)tree.size();
+			tree.push_back(leftNode);
+			tree.push_back(rightNode);
+			tree[work.node].left = leftIndex;
+			tree[work.node].right = leftIndex + 1;
+
+			stack.push_back({ leftIndex, work.depth + 1 });
+			stack.push_back({ leftIndex + 1, work.depth + 1 });
+		}
+
+		return tree;
+	}
+
+	inline bool IsLeaf(const BinaryNode& node)
+	{
+		return node.left == 0;
+	}
+
+	void SetChildBox(BvhNode& node, unsigned int i, const BvhBox& box)
+	{
+		node.minX[i] = box.min.x;
+		node.minY[i] = box.min.y;
+		node.minZ[i] = box.min.z;
+		node.maxX[i] = box.max.x;
+		node.maxY[i] = box.max.y;
+		node.maxZ[i] = box.max.z;
+	}
+}
+
+// --------------------------------------------------------
+// Each 4-wide node takes a binary node's children, then keeps
+// replacing its largest inner child with that child's own two
+// children until it has four (or only leaves are left)
+// --------------------------------------------------------
+unsigned int BuildBvh(
+	const std::vector<BvhBox>& boxes,
+	unsigned int maxLeafSize,
+	std::vector<BvhNode>& nodes,
+	std::vector<unsigned int>& order)
+{
+	nodes.clear();
+	order.clear();
+	if (boxes.empty())
+		return 0;
+
+	std::vector<XMFLOAT3> centroids(boxes.size());
+	order.resize(boxes.size());
+	for (size_t i = 0; i < boxes.size(); i++)
+	{
+		centroids[i] = XMFLOAT3(
+			(boxes[i].min.x + boxes[i].max.x) * 0.5f,
+			(boxes[i].min.y + boxes[i].max.y) * 0.5f,
+			(boxes[i].min.z + boxes[i].max.z) * 0.5f);
+		order[i] = (unsigned int)i;
+	}
+
+	std::vector<BinaryNode> tree = BuildBinaryTree(boxes, centroids, maxLeafSize, order);
+
+	// Collapse, one 4-wide node per step
+	struct Work
+	{
+		unsigned int binaryNode;
+		unsigned int node;
+		unsigned int depth;
+	};
+	std::vector<Work> stack;
+	nodes.push_back(BvhNode());
+	stack.push_back({ 0, 0, 1 });
+	unsigned int depth = 0;
+
+	while (!stack.empty())
+	{
+		Work work = stack.back();
+		stack.pop_back();
+		depth = std::max(depth, work.depth);
+
+		// A leaf root is the only leaf that isn't someone's child
+		unsigned int children[4];
+		unsigned int childCount = 0;
+		const BinaryNode& binary = tree[work.binaryNode];
+		if (IsLeaf(binary))
+		{
+			children[childCount++] = work.binaryNode;
+		}
+		else
+		{
+			children[childCount++] = binary.left;
+			children[childCount++] = binary.right;
+		}
+
+		while (childCount < 4)
+		{
+			int largest = -1;
+			float largestArea = -1.0f;
+			for (unsigned int i = 0; i < childCount; i++)
+			{
+				float area = HalfArea(tree[children[i]].box);
+				if (!IsLeaf(tree[children[i]]) && area > largestArea)
+				{
+					largest = (int)i;
+					largestArea = area;
+				}
+			}
+			if (largest < 0)
+				break;
+
+			const BinaryNode& opened = tree[children[largest]];
+			children[largest] = opened.left;
+			children[childCount++] = opened.right;
+		}
+
+		BvhNode node = {};
+		for (unsigned int i = 0; i < 4; i++)
+		{
+			if (i >= childCount)
+			{
+				node.children[i] = bvhEmptyChild;
+				continue;
+			}
+
+			const BinaryNode& child = tree[children[i]];
+			SetChildBox(node, i, child.box);
+
+			if (IsLeaf(child))
+			{
+				node.children[i] = child.first;
+				node.leafCounts[i] = child.count;
+			}
+			else
+			{
+				node.children[i] = (unsigned int)nodes.size();
+				nodes.push_back(BvhNode());
+				stack.push_back({ children[i], node.children[i], work.depth + 1 });
+			}
+		}
+		nodes[work.node] = node;
+	}
+
+	return depth;
+}
+
+// --------------------------------------------------------
+// Children are always stored after their parents, so walking
+// the nodes backwards refits every child before its parent
+// needs the child's new box
+// --------------------------------------------------------
+void RefitBvh(
+	std::vector<BvhNode>& nodes,
+	const std::vector<BvhBox>& boxes,
+	const std::vector<unsigned int>& order)
+{
+	for (size_t n = nodes.size(); n > 0; n--)
+	{
+		BvhNode& node = nodes[n - 1];
+		for (unsigned int i = 0; i < 4; i++)
+		{
+			if (node.children[i] == bvhEmptyChild)
+				continue;
+
+			BvhBox box = EmptyBox();
+			if (node.leafCounts[i] > 0)
+			{
+				unsigned int first = node.children[i];
+				for (unsigned int k = first; k < first + node.leafCounts[i]; k++)
+					Grow(box, boxes[order[k]]);
+			}
+			else
+			{
+				const BvhNode& child = nodes[node.children[i]];
+				for (unsigned int c = 0; c < 4; c++)
+				{
+					if (child.children[c] == bvhEmptyChild)
+						continue;
+					Grow(box, BvhBox{
+						XMFLOAT3(child.minX[c], child.minY[c], child.minZ[c]),
+						XMFLOAT3(child.maxX[c], child.maxY[c], child.maxZ[c]) });
+				}
+			}
+			SetChildBox(node, i, box);
+		}
+	}
+}
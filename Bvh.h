@@ -0,0 +1,193 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+
+// Marks an unused child slot in a BvhNode
+const unsigned int bvhEmptyChild = 0xFFFFFFFF;
+
+// Room for every child pushed on the way down the deepest tree
+const unsigned int bvhStackSize = 256;
+
+// Components of a ray direction smaller than this are nudged
+// away from zero, so their reciprocals stay finite
+const float bvhMinDirection = 1e-30f;
+
+// Widens each slab's far distance just enough to cover the
+// slab test's rounding error (1 + 2 * gamma(3), from Ize's
+// "Robust BVH Ray Traversal"), so a ray that hits something
+// right on its box's boundary can't miss the box - which
+// matters most for flat boxes around flat geometry
+const float bvhSlabFarScale = 1.0000008f;
+
+// --------------------------------------------------------
+// One node of a 4-wide BVH, laid out so a ray can be tested
+// against all four child boxes at once
+//
+// - The boxes are SoA: minX holds all four children's
+//   smallest x, and so on
+// - 128 bytes, so a node is exactly two cache lines
+// --------------------------------------------------------
+struct BvhNode
+{
+	float minX[4];
+	float minY[4];
+	float minZ[4];
+	float maxX[4];
+	float maxY[4];
+	float maxZ[4];
+	unsigned int children[4];	// Node index, a leaf's first item, or bvhEmptyChild
+	unsigned int leafCounts[4];	// 0 for nodes, how many items a leaf holds otherwise
+};
+
+// An axis-aligned box around one item a BVH is built over
+struct BvhBox
+{
+	DirectX::XMFLOAT3 min;
+	DirectX::XMFLOAT3 max;
+};
+
+// --------------------------------------------------------
+// Builds a 4-wide BVH over the items' boxes
+//
+// - Built top-down with the surface area heuristic, binning
+//   box centroids, then collapsed from a binary tree into
+//   4-wide nodes stored in one flat array
+// - "order" receives the item indices in leaf order, and a
+//   leaf's child slot holds its first position in "order"
+// - A child node is always stored after its parent
+// - Returns the depth of the tree
+// --------------------------------------------------------
+unsigned int BuildBvh(
+	const std::vector<BvhBox>& boxes,
+	unsigned int maxLeafSize,
+	std::vector<BvhNode>& nodes,
+	std::vector<unsigned int>& order);
+
+// Recalculates every child box from the items' current boxes,
+// keeping the tree's shape - much cheaper than a rebuild, but
+// the tree gets looser the further items move from where
+// they were when it was built
+void RefitBvh(
+	std::vector<BvhNode>& nodes,
+	const std::vector<BvhBox>& boxes,
+	const std::vector<unsigned int>& order);
+
+// --------------------------------------------------------
+// Front-to-back traversal with an explicit stack
+//
+// - Each node's four boxes go through the slab test together,
+//   one SIMD lane per child
+// - Children that are hit are visited nearest first: leaves
+//   right away, and nodes pushed so the nearest pops next
+// - Anything whose box starts beyond "closest" is skipped,
+//   both when it's tested and when it's popped
+// - testLeaf(first, count, closest) tests a leaf's items,
+//   lowers "closest" for anything it hits and returns true
+//   if it hit anything; with anyHit, the first hit ends it
+// --------------------------------------------------------
+template <bool anyHit, typename LeafTest>
+bool TraverseBvh(
+	const std::vector<BvhNode>& nodes,
+	const DirectX::XMFLOAT3& origin,
+	const DirectX::XMFLOAT3& direction,
+	float& closest,
+	LeafTest& testLeaf)
+{
+	using namespace DirectX;
+
+	if (nodes.empty())
+		return false;
+
+	// Zero components would make 1/0 and then 0 * infinity in
+	// the slab test, so nudge them to something tiny instead
+	float dx = fabsf(direction.x) < bvhMinDirection ? copysignf(bvhMinDirection, direction.x) : direction.x;
+	float dy = fabsf(direction.y) < bvhMinDirection ? copysignf(bvhMinDirection, direction.y) : direction.y;
+	float dz = fabsf(direction.z) < bvhMinDirection ? copysignf(bvhMinDirection, direction.z) : direction.z;
+
+	XMVECTOR originX = XMVectorReplicate(origin.x);
+	XMVECTOR originY = XMVectorReplicate(origin.y);
+	XMVECTOR originZ = XMVectorReplicate(origin.z);
+	XMVECTOR inverseX = XMVectorReplicate(1.0f / dx);
+	XMVECTOR inverseY = XMVectorReplicate(1.0f / dy);
+	XMVECTOR inverseZ = XMVectorReplicate(1.0f / dz);
+	XMVECTOR farScale = XMVectorReplicate(bvhSlabFarScale);
+
+	bool found = false;
+
+	struct StackEntry
+	{
+		unsigned int node;
+		float distance;
+	};
+	StackEntry stack[bvhStackSize];
+	unsigned int stackSize = 0;
+	stack[stackSize++] = { 0, 0.0f };
+
+	while (stackSize > 0)
+	{
+		StackEntry entry = stack[--stackSize];
+		if (entry.distance > closest)
+			continue;
+
+		// Slab test against all four children
+		const BvhNode& node = nodes[entry.node];
+		XMVECTOR x0 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4((const XMFLOAT4*)node.minX), originX), inverseX);
+		XMVECTOR x1 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4((const XMFLOAT4*)node.maxX), originX), inverseX);
+		XMVECTOR y0 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4((const XMFLOAT4*)node.minY), originY), inverseY);
+		XMVECTOR y1 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4((const XMFLOAT4*)node.maxY), originY), inverseY);
+		XMVECTOR z0 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4((const XMFLOAT4*)node.minZ), originZ), inverseZ);
+		XMVECTOR z1 = XMVectorMultiply(XMVectorSubtract(XMLoadFloat4((const XMFLOAT4*)node.maxZ), originZ), inverseZ);
+
+		XMVECTOR nearT = XMVectorMax(
+			XMVectorMax(XMVectorMin(x0, x1), XMVectorMin(y0, y1)),
+			XMVectorMax(XMVectorMin(z0, z1), XMVectorZero()));
+		XMVECTOR farT = XMVectorMin(
+			XMVectorMultiply(XMVectorMin(XMVectorMax(x0, x1), XMVectorMax(y0, y1)), farScale),
+			XMVectorMin(XMVectorMultiply(XMVectorMax(z0, z1), farScale), XMVectorReplicate(closest)));
+
+		XMFLOAT4 nearDistances;
+		uint32_t hitMask[4];
+		XMStoreFloat4(&nearDistances, nearT);
+		XMStoreInt4(hitMask, XMVectorLessOrEqual(nearT, farT));
+
+		// Sort the children that were hit, nearest first
+		StackEntry hits[4];
+		unsigned int hitCount = 0;
+		for (unsigned int i = 0; i < 4; i++)
+		{
+			if (!hitMask[i] || node.children[i] == bvhEmptyChild)
+				continue;
+
+			StackEntry child = { i, (&nearDistances.x)[i] };
+			unsigned int j = hitCount++;
+			for (; j > 0 && hits[j - 1].distance > child.distance; j--)
+				hits[j] = hits[j - 1];
+			hits[j] = child;
+		}
+
+		// Leaves now, nodes in reverse so the nearest is on top
+		for (unsigned int h = 0; h < hitCount; h++)
+		{
+			unsigned int i = hits[h].node;
+			if (node.leafCounts[i] == 0 || hits[h].distance > closest)
+				continue;
+
+			if (testLeaf(node.children[i], node.leafCounts[i], closest))
+			{
+				found = true;
+				if (anyHit)
+					return true;
+			}
+		}
+		for (unsigned int h = hitCount; h > 0; h--)
+		{
+			unsigned int i = hits[h - 1].node;
+			if (node.leafCounts[i] == 0)
+				stack[stackSize++] = { node.children[i], hits[h - 1].distance };
+		}
+	}
+
+	return found;
+}
@@ -18,7 +18,6 @@ Camera::Camera(
 	nearP = 0.1f;
 	farP = 1000;
 	//setposition
-	transform = Transform();
 	transform.SetPosition(x, y, z);
 	//update matrices
 	UpdateViewMatrix();
@@ -100,3 +99,24 @@ float Camera::GetFov()
 {
 	return fov;
 }
+
+// Unprojects the point on the near and far planes
+void Camera::GetPickRay(
+	float screenX,
+	float screenY,
+	float screenWidth,
+	float screenHeight,
+	XMFLOAT3& origin,
+	XMFLOAT3& direction)
+{
+	float ndcX = screenX / screenWidth * 2.0f - 1.0f;
+	float ndcY = 1.0f - screenY / screenHeight * 2.0f;
+
+	XMMATRIX viewProjection = XMLoadFloat4x4(&viewMatrix) * XMLoadFloat4x4(&projectionMatrix);
+	XMMATRIX inverse = XMMatrixInverse(nullptr, viewProjection);
+	XMVECTOR nearPoint = XMVector3TransformCoord(XMVectorSet(ndcX, ndcY, 0.0f, 1.0f), inverse);
+	XMVECTOR farPoint = XMVector3TransformCoord(XMVectorSet(ndcX, ndcY, 1.0f, 1.0f), inverse);
+
+	XMStoreFloat3(&origin, nearPoint);
+	XMStoreFloat3(&direction, XMVector3Normalize(farPoint - nearPoint));
+}
@@ -21,6 +21,17 @@ public:
 	DirectX::XMFLOAT4X4 GetView();
 	DirectX::XMFLOAT4X4 GetProjection();
 	float GetFov();
+
+	// The world-space ray through a point on screen, in pixels
+	// from the top-left corner - the origin is on the near plane
+	// and the direction is normalized
+	void GetPickRay(
+		float screenX,
+		float screenY,
+		float screenWidth,
+		float screenHeight,
+		DirectX::XMFLOAT3& origin,
+		DirectX::XMFLOAT3& direction);
 private:
 	DirectX::XMFLOAT4X4 viewMatrix;
 	DirectX::XMFLOAT4X4 projectionMatrix;
@@ -0,0 +1,4 @@
+// The shadow map vertex shader, reading CompactVertex positions
+// instead of Vertex positions - see ShadowVS.hlsl and CompactVertex.hlsli
+#define COMPACT_VERTICES
+#include "ShadowVS.hlsl"
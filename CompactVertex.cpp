@@ -0,0 +1,166 @@
+#include "CompactVertex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <d3dcompiler.h>
+#include <DirectXPackedVector.h>
+
+using namespace DirectX;
+
+namespace
+{
+	// --------------------------------------------------------
+	// Folds a unit vector onto an octahedron and unfolds that
+	// into the -1 to 1 square (Cigolle et al., "A Survey of
+	// Efficient Representations for Independent Unit Vectors")
+	// --------------------------------------------------------
+	XMFLOAT2 EncodeOctahedral(const XMFLOAT3& v)
+	{
+		float length = fabsf(v.x) + fabsf(v.y) + fabsf(v.z);
+		if (length <= 0.0f)
+			return XMFLOAT2(0, 0);
+
+		float x = v.x / length;
+		float y = v.y / length;
+		if (v.z < 0.0f)
+		{
+			// Lower half: mirror across the diagonals
+			float foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+			float foldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+			x = foldedX;
+			y = foldedY;
+		}
+		return XMFLOAT2(x, y);
+	}
+
+	XMFLOAT3 DecodeOctahedral(float ex, float ey)
+	{
+		XMFLOAT3 v(ex, ey, 1.0f - fabsf(ex) - fabsf(ey));
+		float t = std::max(-v.z, 0.0f);
+		v.x += v.x >= 0.0f ? -t : t;
+		v.y += v.y >= 0.0f ? -t : t;
+
+		XMFLOAT3 result;
+		XMStoreFloat3(&result, XMVector3Normalize(XMLoadFloat3(&v)));
+		return result;
+	}
+
+	short ToSnorm16(float value)
+	{
+		return (short)lroundf(std::max(-1.0f, std::min(1.0f, value)) * 32767.0f);
+	}
+
+	unsigned short ToUnorm16(float value)
+	{
+		return (unsigned short)lroundf(std::max(0.0f, std::min(1.0f, value)) * 65535.0f);
+	}
+}
+
+// --------------------------------------------------------
+// Stretches 0-65535 across the box on each axis.  A flat
+// axis gets a scale of zero, so it decodes to the box.
+// --------------------------------------------------------
+CompactPositionDecode GetCompactPositionDecode(const MeshBounds& bounds)
+{
+	CompactPositionDecode decode;
+	decode.offset = bounds.aabbMin;
+	decode.scale = XMFLOAT3(
+		bounds.aabbMax.x - bounds.aabbMin.x,
+		bounds.aabbMax.y - bounds.aabbMin.y,
+		bounds.aabbMax.z - bounds.aabbMin.z);
+	return decode;
+}
+
+void EncodeCompactVertices(
+	const Vertex* vertices,
+	size_t vertexCount,
+	const CompactPositionDecode& decode,
+	CompactVertex* compactVertices)
+{
+	const float inverseScale[3] = {
+		decode.scale.x > 0.0f ? 1.0f / decode.scale.x : 0.0f,
+		decode.scale.y > 0.0f ? 1.0f / decode.scale.y : 0.0f,
+		decode.scale.z > 0.0f ? 1.0f / decode.scale.z : 0.0f };
+
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const Vertex& v = vertices[i];
+		CompactVertex& c = compactVertices[i];
+
+		c.position[0] = ToUnorm16((v.position.x - decode.offset.x) * inverseScale[0]);
+		c.position[1] = ToUnorm16((v.position.y - decode.offset.y) * inverseScale[1]);
+		c.position[2] = ToUnorm16((v.position.z - decode.offset.z) * inverseScale[2]);
+		c.position[3] = 0;
+
+		XMFLOAT2 normal = EncodeOctahedral(v.normal);
+		XMFLOAT2 tangent = EncodeOctahedral(v.tangent);
+		c.normalTangent[0] = ToSnorm16(normal.x);
+		c.normalTangent[1] = ToSnorm16(normal.y);
+		c.normalTangent[2] = ToSnorm16(tangent.x);
+		c.normalTangent[3] = ToSnorm16(tangent.y);
+
+		c.uv[0] = PackedVector::XMConvertFloatToHalf(v.uv.x);
+		c.uv[1] = PackedVector::XMConvertFloatToHalf(v.uv.y);
+	}
+}
+
+Vertex DecodeCompactVertex(const CompactVertex& compact, const CompactPositionDecode& decode)
+{
+	// SNORM treats -32768 the same as -32767
+	float n[4];
+	for (int k = 0; k < 4; k++)
+		n[k] = std::max(compact.normalTangent[k] / 32767.0f, -1.0f);
+
+	Vertex v;
+	v.position = XMFLOAT3(
+		decode.offset.x + compact.position[0] / 65535.0f * decode.scale.x,
+		decode.offset.y + compact.position[1] / 65535.0f * decode.scale.y,
+		decode.offset.z + compact.position[2] / 65535.0f * decode.scale.z);
+	v.normal = DecodeOctahedral(n[0], n[1]);
+	v.tangent = DecodeOctahedral(n[2], n[3]);
+	v.uv = XMFLOAT2(
+		PackedVector::XMConvertHalfToFloat(compact.uv[0]),
+		PackedVector::XMConvertHalfToFloat(compact.uv[1]));
+	return v;
+}
+
+// --------------------------------------------------------
+// SimpleVertexShader builds layouts from reflection, which
+// only knows about 32 bit types, so the compact formats are
+// spelled out here instead
+// --------------------------------------------------------
+Microsoft::WRL::ComPtr<ID3D11InputLayout> CreateCompactInputLayout(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	const wchar_t* vertexShaderFile,
+	bool positionOnly)
+{
+	Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout;
+
+	Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob;
+	if (FAILED(D3DReadFileToBlob(vertexShaderFile, shaderBlob.GetAddressOf())))
+		return inputLayout;
+
+	D3D11_INPUT_ELEMENT_DESC elements[3] = {};
+	elements[0].SemanticName = "POSITION";
+	elements[0].Format = DXGI_FORMAT_R16G16B16A16_UNORM;
+	elements[0].AlignedByteOffset = offsetof(CompactVertex, position);
+	elements[0].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+
+	elements[1].SemanticName = "NORMAL";
+	elements[1].Format = DXGI_FORMAT_R16G16B16A16_SNORM;
+	elements[1].AlignedByteOffset = offsetof(CompactVertex, normalTangent);
+	elements[1].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+
+	elements[2].SemanticName = "UV";
+	elements[2].Format = DXGI_FORMAT_R16G16_FLOAT;
+	elements[2].AlignedByteOffset = offsetof(CompactVertex, uv);
+	elements[2].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+
+	device->CreateInputLayout(
+		elements,
+		positionOnly ? 1 : 3,
+		shaderBlob->GetBufferPointer(),
+		shaderBlob->GetBufferSize(),
+		inputLayout.GetAddressOf());
+	return inputLayout;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <DirectXMath.h>
+#include "Bounds.h"
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// A 20 byte version of Vertex (which is 44 bytes)
+//
+// - Must match CompactVertexInput in CompactVertex.hlsli
+// - Positions are 16 bit fractions of the mesh's box, so
+//   their precision scales with the mesh (1/65535 of it)
+// - Normals and tangents are octahedral encoded: each unit
+//   vector folds into a point in a square, stored as two
+//   16 bit signed fractions
+// --------------------------------------------------------
+struct CompactVertex
+{
+	unsigned short position[4];		// xyz within the box (UNORM), w unused
+	short normalTangent[4];			// Octahedral normal (xy) and tangent (zw) (SNORM)
+	unsigned short uv[2];			// Half floats
+};
+
+// --------------------------------------------------------
+// Turns a compact position back into a local one:
+//   position = offset + (UNORM position) * scale
+// Sent to the compact vertex shaders as positionOffset and
+// positionScale
+// --------------------------------------------------------
+struct CompactPositionDecode
+{
+	DirectX::XMFLOAT3 offset;
+	DirectX::XMFLOAT3 scale;
+};
+
+CompactPositionDecode GetCompactPositionDecode(const MeshBounds& bounds);
+
+void EncodeCompactVertices(
+	const Vertex* vertices,
+	size_t vertexCount,
+	const CompactPositionDecode& decode,
+	CompactVertex* compactVertices);
+
+// The same math the shaders do, for measuring precision
+Vertex DecodeCompactVertex(const CompactVertex& compact, const CompactPositionDecode& decode);
+
+// The input layout for CompactVertex, validated against a
+// compiled vertex shader (.cso) that reads CompactVertexInput
+// - positionOnly makes a layout for shaders that only read the
+//   POSITION, which fits both the full compact stream and the
+//   position-only one (see Mesh::DrawDepthOnly())
+Microsoft::WRL::ComPtr<ID3D11InputLayout> CreateCompactInputLayout(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	const wchar_t* vertexShaderFile,
+	bool positionOnly = false);
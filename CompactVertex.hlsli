@@ -0,0 +1,43 @@
+#ifndef __GGP_COMPACT_VERTEX__ // Each .hlsli file needs a unique identifier!
+#define __GGP_COMPACT_VERTEX__
+
+// Struct representing a single compact vertex
+// - This must match CompactVertex in CompactVertex.h, and the input
+//   layout made by CreateCompactInputLayout()
+// - The formats in that layout do the first step of decoding for us,
+//   so everything arrives here as floats
+struct CompactVertexInput
+{
+    float4 position         : POSITION;    // UNORM: 0-1 within the mesh's box
+    float4 normalTangent    : NORMAL;      // SNORM: octahedral normal (xy) and tangent (zw)
+    float2 uv               : UV;          // Half floats
+};
+
+// Turns a point on the octahedron (unfolded into a -1 to 1 square)
+// back into a unit vector
+float3 DecodeOctahedral(float2 e)
+{
+    float3 v = float3(e.xy, 1.0f - abs(e.x) - abs(e.y));
+    float t = saturate(-v.z);
+    v.xy += (v.xy >= 0.0f) ? -t : t;
+    return normalize(v);
+}
+
+// Rebuilds the full precision attributes of a compact vertex, using
+// the mesh's position decode constants (see CompactPositionDecode)
+void DecodeCompactVertex(
+    CompactVertexInput input,
+    float3 positionOffset,
+    float3 positionScale,
+    out float3 localPosition,
+    out float3 normal,
+    out float3 tangent,
+    out float2 uv)
+{
+    localPosition = positionOffset + input.position.xyz * positionScale;
+    normal = DecodeOctahedral(input.normalTangent.xy);
+    tangent = DecodeOctahedral(input.normalTangent.zw);
+    uv = input.uv;
+}
+
+#endif
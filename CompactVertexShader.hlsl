@@ -0,0 +1,4 @@
+// The regular vertex shader, reading CompactVertex data instead
+// of Vertex data - see VertexShader.hlsl and CompactVertex.hlsli
+#define COMPACT_VERTICES
+#include "VertexShader.hlsl"
@@ -0,0 +1,411 @@
+#include "CookedMesh.h"
+#include "MeshCodec.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	// How much CookedMeshWriter reads back or copies at a time
+	const size_t writerChunkBytes = 4 * 1024 * 1024;
+}
+
+// --------------------------------------------------------
+// Checks that the file holds everything its header claims,
+// and decodes encoded arrays right away - which also checks
+// them - so every getter is cheap afterwards
+// --------------------------------------------------------
+CookedMesh::CookedMesh(const wchar_t* cookedFile)
+	:
+	file(cookedFile),
+	header(0),
+	vertices(0),
+	indices(0),
+	lods(0),
+	meshlets(0)
+{
+	if (!file.IsOpen() || file.GetSize() < sizeof(CookedMeshHeader))
+		return;
+
+	const CookedMeshHeader* candidate = (const CookedMeshHeader*)file.GetData();
+	if (memcmp(candidate->magic, "MESH", 4) != 0 ||
+		candidate->version != cookedMeshVersion ||
+		candidate->vertexSize != sizeof(Vertex))
+		return;
+
+	// Arrays stored as they are have exact sizes
+	bool verticesEncoded = (candidate->encoding & cookedVerticesEncoded) != 0;
+	bool indicesEncoded = (candidate->encoding & cookedIndicesEncoded) != 0;
+	if ((!verticesEncoded && candidate->vertexBytes != (unsigned long long)candidate->vertexCount * sizeof(Vertex)) ||
+		(!indicesEncoded && candidate->indexBytes != (unsigned long long)candidate->indexCount * sizeof(unsigned int)) ||
+		candidate->vertexBytes > file.GetSize() ||
+		candidate->indexBytes > file.GetSize())
+		return;
+
+	// Make sure the file actually holds everything the header claims
+	unsigned long long expectedSize =
+		sizeof(CookedMeshHeader) +
+		candidate->vertexBytes +
+		candidate->indexBytes +
+		(unsigned long long)candidate->lodCount * sizeof(MeshLod) +
+		(unsigned long long)candidate->meshletCount * sizeof(Meshlet);
+	if (file.GetSize() != expectedSize)
+		return;
+
+	const unsigned char* vertexData = (const unsigned char*)file.GetData() + sizeof(CookedMeshHeader);
+	const unsigned char* indexData = vertexData + candidate->vertexBytes;
+	lods = (const MeshLod*)(indexData + candidate->indexBytes);
+	meshlets = (const Meshlet*)(lods + candidate->lodCount);
+
+	// Every LOD and meshlet has to fit inside the index buffer
+	for (unsigned int i = 0; i < candidate->lodCount; i++)
+	{
+		if ((unsigned long long)lods[i].indexStart + lods[i].indexCount > candidate->indexCount)
+			return;
+	}
+	for (unsigned int i = 0; i < candidate->meshletCount; i++)
+	{
+		if ((unsigned long long)meshlets[i].indexStart + meshlets[i].indexCount > candidate->indexCount)
+			return;
+	}
+
+	if (verticesEncoded)
+	{
+		decodedVertices.resize(candidate->vertexCount);
+		if (!DecodeVertexBuffer(decodedVertices.data(), candidate->vertexCount, sizeof(Vertex), vertexData, (size_t)candidate->vertexBytes))
+			return;
+		vertices = decodedVertices.data();
+	}
+	else
+	{
+		vertices = (const Vertex*)vertexData;
+	}
+
+	if (indicesEncoded)
+	{
+		decodedIndices.resize(candidate->indexCount);
+		if (!DecodeIndexBuffer(decodedIndices.data(), candidate->indexCount, candidate->vertexCount, indexData, (size_t)candidate->indexBytes))
+			return;
+		indices = decodedIndices.data();
+	}
+	else
+	{
+		indices = (const unsigned int*)indexData;
+	}
+
+	header = candidate;
+}
+
+bool CookedMesh::IsCurrent(unsigned long long sourceHash, size_t sourceSize, unsigned int optionsKey)
+{
+	return header &&
+		header->sourceHash == sourceHash &&
+		header->sourceSize == sourceSize &&
+		header->optionsKey == optionsKey &&
+		header->vertexCount > 0 &&
+		header->indexCount > 0 &&
+		header->lodCount > 0;
+}
+
+const Vertex* CookedMesh::GetVertices()
+{
+	return vertices;
+}
+
+const unsigned int* CookedMesh::GetIndices()
+{
+	return indices;
+}
+
+unsigned int CookedMesh::GetVertexCount()
+{
+	return header->vertexCount;
+}
+
+unsigned int CookedMesh::GetIndexCount()
+{
+	return header->indexCount;
+}
+
+const MeshLod* CookedMesh::GetLods()
+{
+	return lods;
+}
+
+unsigned int CookedMesh::GetLodCount()
+{
+	return header->lodCount;
+}
+
+const Meshlet* CookedMesh::GetMeshlets()
+{
+	return meshlets;
+}
+
+unsigned int CookedMesh::GetMeshletCount()
+{
+	return header->meshletCount;
+}
+
+MeshBounds CookedMesh::GetBounds()
+{
+	return header->bounds;
+}
+
+bool CookedMesh::Write(
+	const wchar_t* cookedFile,
+	unsigned long long sourceHash,
+	size_t sourceSize,
+	unsigned int optionsKey,
+	const Vertex* vertices,
+	unsigned int vertexCount,
+	const unsigned int* indices,
+	unsigned int indexCount,
+	const MeshLod* lods,
+	unsigned int lodCount,
+	const Meshlet* meshlets,
+	unsigned int meshletCount,
+	MeshBounds bounds,
+	bool encode)
+{
+	// Encoded arrays are only kept when they come out smaller
+	// - The index codec works on whole triangles
+	std::vector<unsigned char> vertexData;
+	std::vector<unsigned char> indexData;
+	if (encode)
+	{
+		EncodeVertexBuffer(vertices, vertexCount, sizeof(Vertex), vertexData);
+		vertexData.resize((vertexData.size() + 3) & ~(size_t)3, 0);
+		if (vertexData.size() >= sizeof(Vertex) * vertexCount)
+			vertexData.clear();
+
+		if (indexCount % 3 == 0)
+		{
+			EncodeIndexBuffer(indices, indexCount, indexData);
+			indexData.resize((indexData.size() + 3) & ~(size_t)3, 0);
+			if (indexData.size() >= sizeof(unsigned int) * indexCount)
+				indexData.clear();
+		}
+	}
+
+	CookedMeshHeader header = {};
+	memcpy(header.magic, "MESH", 4);
+	header.version = cookedMeshVersion;
+	header.sourceHash = sourceHash;
+	header.sourceSize = sourceSize;
+	header.optionsKey = optionsKey;
+	header.vertexSize = sizeof(Vertex);
+	header.vertexCount = vertexCount;
+	header.indexCount = indexCount;
+	header.lodCount = lodCount;
+	header.meshletCount = meshletCount;
+	header.encoding =
+		(vertexData.empty() ? 0 : cookedVerticesEncoded) |
+		(indexData.empty() ? 0 : cookedIndicesEncoded);
+	header.vertexBytes = vertexData.empty() ? sizeof(Vertex) * vertexCount : vertexData.size();
+	header.indexBytes = indexData.empty() ? sizeof(unsigned int) * indexCount : indexData.size();
+	header.bounds = bounds;
+
+	std::wstring tempFile = std::wstring(cookedFile) + L".tmp";
+	{
+		std::ofstream out(tempFile.c_str(), std::ios::binary | std::ios::trunc);
+		if (!out.is_open())
+			return false;
+
+		out.write((const char*)&header, sizeof(header));
+		if (vertexData.empty())
+			out.write((const char*)vertices, sizeof(Vertex) * vertexCount);
+		else
+			out.write((const char*)vertexData.data(), vertexData.size());
+		if (indexData.empty())
+			out.write((const char*)indices, sizeof(unsigned int) * indexCount);
+		else
+			out.write((const char*)indexData.data(), indexData.size());
+		out.write((const char*)lods, sizeof(MeshLod) * lodCount);
+		out.write((const char*)meshlets, sizeof(Meshlet) * meshletCount);
+		if (!out.good())
+		{
+			out.close();
+			DeleteFileW(tempFile.c_str());
+			return false;
+		}
+	}
+
+	return MoveFileExW(tempFile.c_str(), cookedFile, MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+CookedMeshWriter::CookedMeshWriter(const wchar_t* cookedFile)
+	:
+	cookedFile(cookedFile),
+	tempFile(std::wstring(cookedFile) + L".tmp"),
+	indexFile(std::wstring(cookedFile) + L".indices.tmp"),
+	vertexCount(0),
+	indexCount(0)
+{
+	const std::ios::openmode mode = std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc;
+	vertexStream.open(tempFile.c_str(), mode);
+	indexStream.open(indexFile.c_str(), mode);
+
+	// Room for the header, which is filled in last
+	CookedMeshHeader header = {};
+	vertexStream.write((const char*)&header, sizeof(header));
+}
+
+CookedMeshWriter::~CookedMeshWriter()
+{
+	Discard();
+}
+
+bool CookedMeshWriter::IsOpen()
+{
+	return vertexStream.is_open() && indexStream.is_open() && vertexStream.good() && indexStream.good();
+}
+
+bool CookedMeshWriter::WriteVertices(const Vertex* vertices, size_t count)
+{
+	vertexStream.write((const char*)vertices, sizeof(Vertex) * count);
+	vertexCount += count;
+	return vertexStream.good();
+}
+
+bool CookedMeshWriter::WriteIndices(const unsigned int* indices, size_t count)
+{
+	indexStream.write((const char*)indices, sizeof(unsigned int) * count);
+	indexCount += count;
+	return indexStream.good();
+}
+
+bool CookedMeshWriter::UpdateVertices(const std::function<void(Vertex* vertices, size_t firstVertex, size_t count)>& update)
+{
+	std::vector<Vertex> chunk(writerChunkBytes / sizeof(Vertex));
+	for (unsigned long long first = 0; first < vertexCount && vertexStream.good(); first += chunk.size())
+	{
+		size_t count = (size_t)std::min<unsigned long long>(chunk.size(), vertexCount - first);
+		std::streamoff offset = sizeof(CookedMeshHeader) + first * sizeof(Vertex);
+
+		vertexStream.seekg(offset);
+		vertexStream.read((char*)&chunk[0], sizeof(Vertex) * count);
+		update(&chunk[0], (size_t)first, count);
+		vertexStream.seekp(offset);
+		vertexStream.write((const char*)&chunk[0], sizeof(Vertex) * count);
+	}
+
+	// Later vertices go on the end again
+	vertexStream.seekp(0, std::ios::end);
+	return vertexStream.good();
+}
+
+bool CookedMeshWriter::Finish(
+	unsigned long long sourceHash,
+	size_t sourceSize,
+	unsigned int optionsKey,
+	MeshBounds bounds)
+{
+	// The header only has room for 32 bit counts
+	if (!IsOpen() ||
+		vertexCount == 0 || vertexCount > 0xFFFFFFFFull ||
+		indexCount == 0 || indexCount > 0xFFFFFFFFull)
+	{
+		Discard();
+		return false;
+	}
+
+	// The indices follow the vertices
+	std::vector<char> chunk(writerChunkBytes);
+	vertexStream.seekp(0, std::ios::end);
+	indexStream.seekg(0);
+	while (indexStream.read(&chunk[0], chunk.size()) || indexStream.gcount() > 0)
+		vertexStream.write(&chunk[0], indexStream.gcount());
+
+	MeshLod all = { 0, (unsigned int)indexCount, 0.0f };
+	vertexStream.write((const char*)&all, sizeof(all));
+
+	CookedMeshHeader header = {};
+	memcpy(header.magic, "MESH", 4);
+	header.version = cookedMeshVersion;
+	header.sourceHash = sourceHash;
+	header.sourceSize = sourceSize;
+	header.optionsKey = optionsKey;
+	header.vertexSize = sizeof(Vertex);
+	header.vertexCount = (unsigned int)vertexCount;
+	header.indexCount = (unsigned int)indexCount;
+	header.lodCount = 1;
+	header.meshletCount = 0;
+	header.encoding = 0;
+	header.vertexBytes = vertexCount * sizeof(Vertex);
+	header.indexBytes = indexCount * sizeof(unsigned int);
+	header.bounds = bounds;
+	vertexStream.seekp(0);
+	vertexStream.write((const char*)&header, sizeof(header));
+
+	bool written = vertexStream.good();
+	vertexStream.close();
+	indexStream.close();
+	DeleteFileW(indexFile.c_str());
+
+	if (!written || MoveFileExW(tempFile.c_str(), cookedFile.c_str(), MOVEFILE_REPLACE_EXISTING) == 0)
+	{
+		DeleteFileW(tempFile.c_str());
+		return false;
+	}
+	return true;
+}
+
+unsigned long long CookedMeshWriter::GetVertexCount()
+{
+	return vertexCount;
+}
+
+unsigned long long CookedMeshWriter::GetIndexCount()
+{
+	return indexCount;
+}
+
+// Closes and deletes both temp files, if they're still around
+void CookedMeshWriter::Discard()
+{
+	if (vertexStream.is_open())
+	{
+		vertexStream.close();
+		DeleteFileW(tempFile.c_str());
+	}
+	if (indexStream.is_open())
+	{
+		indexStream.close();
+		DeleteFileW(indexFile.c_str());
+	}
+}
+
+// The source's extension stays, so "foo.obj" and "foo.glb"
+// next to each other don't share (and keep overwriting) a
+// cooked file
+std::wstring GetCookedPath(const wchar_t* sourceFile)
+{
+	return std::wstring(sourceFile) + L".mesh";
+}
+
+// --------------------------------------------------------
+// FNV-1a, but consuming 8 bytes per step instead of one so
+// that hashing a large source file stays far cheaper than
+// parsing it
+// --------------------------------------------------------
+unsigned long long HashBytes(const void* data, size_t size)
+{
+	const unsigned long long prime = 1099511628211ull;
+	unsigned long long hash = 14695981039346656037ull;
+
+	const unsigned char* bytes = (const unsigned char*)data;
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8)
+	{
+		unsigned long long word;
+		memcpy(&word, bytes + i, 8);
+		hash = (hash ^ word) * prime;
+		hash ^= hash >> 29;
+	}
+	for (; i < size; i++)
+		hash = (hash ^ bytes[i]) * prime;
+
+	return hash ^ size;
+}
@@ -0,0 +1,167 @@
+#pragma once
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+#include "Bounds.h"
+#include "MappedFile.h"
+#include "Meshlets.h"
+#include "MeshSimplifier.h"
+#include "Vertex.h"
+
+// Bump this whenever the layout of a .mesh file (or the Vertex
+// struct, or the way vertices are built) changes
+const unsigned int cookedMeshVersion = 5;
+
+// Bits of CookedMeshHeader::encoding, for arrays stored with
+// MeshCodec.h's codecs rather than as they are
+const unsigned int cookedVerticesEncoded = 1;
+const unsigned int cookedIndicesEncoded = 2;
+
+// --------------------------------------------------------
+// Layout of a cooked .mesh file:
+//  - This header
+//  - vertexBytes of vertices: vertexCount Vertex structs, or
+//    encoded by EncodeVertexBuffer()
+//  - indexBytes of indices: indexCount 32-bit indices, or
+//    encoded by EncodeIndexBuffer()
+//  - lodCount MeshLod index ranges
+//  - meshletCount Meshlets (clusters of LOD 0)
+//
+// Encoded arrays are zero padded to a multiple of 4 bytes, so
+// the LODs and meshlets stay aligned
+// --------------------------------------------------------
+struct CookedMeshHeader
+{
+	char magic[4];					// Always "MESH"
+	unsigned int version;			// Must match cookedMeshVersion
+	unsigned long long sourceHash;	// HashBytes() of the source file
+	unsigned long long sourceSize;	// Size of the source file in bytes
+	unsigned int optionsKey;		// Load options the mesh was cooked with
+	unsigned int vertexSize;		// sizeof(Vertex) when cooked
+	unsigned int vertexCount;
+	unsigned int indexCount;
+	unsigned int lodCount;
+	unsigned int meshletCount;
+	unsigned int encoding;			// cookedVerticesEncoded and/or cookedIndicesEncoded
+	unsigned long long vertexBytes;
+	unsigned long long indexBytes;
+	MeshBounds bounds;
+};
+
+// --------------------------------------------------------
+// A memory-mapped, read-only cooked mesh.  The vertex and
+// index pointers point directly into the mapped file (or at
+// copies decoded when it's opened, for encoded arrays) and
+// stay valid for the lifetime of this object.
+// --------------------------------------------------------
+class CookedMesh
+{
+public:
+	CookedMesh(const wchar_t* cookedFile);
+
+	// Is this file valid, and was it cooked from exactly this source?
+	bool IsCurrent(unsigned long long sourceHash, size_t sourceSize, unsigned int optionsKey);
+
+	const Vertex* GetVertices();
+	const unsigned int* GetIndices();
+	unsigned int GetVertexCount();
+	unsigned int GetIndexCount();
+	const MeshLod* GetLods();
+	unsigned int GetLodCount();
+	const Meshlet* GetMeshlets();
+	unsigned int GetMeshletCount();
+	MeshBounds GetBounds();
+
+	// Writes a cooked mesh to disk (through a temp file, so a
+	// crash can never leave a half-written .mesh behind)
+	// - With "encode", the vertices and indices are each stored
+	//   encoded whenever that makes them smaller; there's no
+	//   default, so callers pass MeshLoadOptions::encodeCooked
+	//   (off, so warm loads upload straight from the file)
+	static bool Write(
+		const wchar_t* cookedFile,
+		unsigned long long sourceHash,
+		size_t sourceSize,
+		unsigned int optionsKey,
+		const Vertex* vertices,
+		unsigned int vertexCount,
+		const unsigned int* indices,
+		unsigned int indexCount,
+		const MeshLod* lods,
+		unsigned int lodCount,
+		const Meshlet* meshlets,
+		unsigned int meshletCount,
+		MeshBounds bounds,
+		bool encode);
+
+private:
+	MappedFile file;
+	const CookedMeshHeader* header;
+	const Vertex* vertices;
+	const unsigned int* indices;
+	const MeshLod* lods;
+	const Meshlet* meshlets;
+	std::vector<Vertex> decodedVertices;
+	std::vector<unsigned int> decodedIndices;
+};
+
+// --------------------------------------------------------
+// Writes a cooked mesh whose vertices and indices arrive a
+// chunk at a time, for meshes too big to hold in memory
+//
+// - The result is a single LOD with no meshlets, and its
+//   vertices and indices aren't encoded
+// - Vertices go straight into the temp .mesh file, while
+//   indices wait in a second temp file until the vertex
+//   count is known, then get copied in after the vertices
+// - Nothing is left behind unless Finish() succeeds
+// --------------------------------------------------------
+class CookedMeshWriter
+{
+public:
+	CookedMeshWriter(const wchar_t* cookedFile);
+	~CookedMeshWriter();
+
+	// Holds open files, so it can't be copied
+	CookedMeshWriter(const CookedMeshWriter&) = delete;
+	CookedMeshWriter& operator=(const CookedMeshWriter&) = delete;
+
+	bool IsOpen();
+
+	// Appends to the vertices or indices written so far
+	bool WriteVertices(const Vertex* vertices, size_t count);
+	bool WriteIndices(const unsigned int* indices, size_t count);
+
+	// Reads the vertices back a chunk at a time, hands each
+	// chunk (and the index of its first vertex) to update,
+	// then writes it back over the original
+	bool UpdateVertices(const std::function<void(Vertex* vertices, size_t firstVertex, size_t count)>& update);
+
+	// Fills in the header and moves the file into place
+	bool Finish(
+		unsigned long long sourceHash,
+		size_t sourceSize,
+		unsigned int optionsKey,
+		MeshBounds bounds);
+
+	unsigned long long GetVertexCount();
+	unsigned long long GetIndexCount();
+
+private:
+	void Discard();
+
+	std::wstring cookedFile;
+	std::wstring tempFile;
+	std::wstring indexFile;
+	std::fstream vertexStream;
+	std::fstream indexStream;
+	unsigned long long vertexCount;
+	unsigned long long indexCount;
+};
+
+// "Models/cube.obj" -> "Models/cube.obj.mesh"
+std::wstring GetCookedPath(const wchar_t* sourceFile);
+
+// Fast 64-bit content hash used to detect stale cooked files
+unsigned long long HashBytes(const void* data, size_t size);
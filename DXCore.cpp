@@ -3,6 +3,8 @@
 
 #include <dxgi1_5.h>
 #include <WindowsX.h>
+#include <timeapi.h>
+#include <cmath>
 #include <sstream>
 #include "ImGui/imgui_impl_win32.h"
 
@@ -55,6 +57,14 @@ DXCore::DXCore(
 	deltaTime(0),
 	startTime(0),
 	totalTime(0),
+	tickRate(60.0f),
+	maxTicksPerFrame(5),
+	frameRateLimit(0.0f),
+	tickBlend(0.0f),
+	frameTicks(0),
+	droppedTicks(0),
+	tickTimeOwed(0.0),
+	simulationTime(0.0),
 	hWnd(0)
 {
 	// Save a static reference to this object.
@@ -411,6 +421,10 @@ HRESULT DXCore::Run()
 	// Give subclass a chance to initialize
 	Init();
 
+	// Sleep(1) can take up to a whole scheduler period (often
+	// 15.6 ms) otherwise, which is useless for a frame limit
+	timeBeginPeriod(1);
+
 	// Our overall game and message loop
 	MSG msg = {};
 	while (msg.message != WM_QUIT)
@@ -435,13 +449,18 @@ HRESULT DXCore::Run()
 
 			// The game loop
 			Update(deltaTime, totalTime);
+			RunTicks();
 			Draw(deltaTime, totalTime);
 
 			// Frame is over, notify the input manager
 			Input::GetInstance().EndOfFrame();
+
+			WaitForFrameLimit();
 		}
 	}
 
+	timeEndPeriod(1);
+
 	// We'll end up here once we get a WM_QUIT message,
 	// which usually comes from the user closing the window
 	return (HRESULT)msg.wParam;
@@ -482,6 +501,73 @@ void DXCore::UpdateTimer()
 }
 
 
+// --------------------------------------------------------
+// Runs as many fixed ticks as the time since the last frame
+// covers, keeping the remainder for next frame
+//
+// - A frame that takes longer than it can simulate would make
+//   the next frame owe even more ticks, and so on until the
+//   game freezes; past maxTicksPerFrame the owed time is
+//   dropped instead, so the game slows down rather than stalls
+// - What's left over is less than one tick, and becomes the
+//   blend between the last two ticks for Draw()
+// --------------------------------------------------------
+void DXCore::RunTicks()
+{
+	double tickTime = 1.0 / tickRate;
+	tickTimeOwed += deltaTime;
+
+	frameTicks = 0;
+	while (tickTimeOwed >= tickTime && frameTicks < maxTicksPerFrame)
+	{
+		simulationTime += tickTime;
+		FixedUpdate((float)tickTime, (float)simulationTime);
+		tickTimeOwed -= tickTime;
+		frameTicks++;
+	}
+
+	if (tickTimeOwed >= tickTime)
+	{
+		double dropped = floor(tickTimeOwed / tickTime);
+		droppedTicks += (unsigned int)dropped;
+		tickTimeOwed -= dropped * tickTime;
+	}
+
+	tickBlend = (float)(tickTimeOwed / tickTime);
+}
+
+
+// --------------------------------------------------------
+// Holds the frame until 1 / frameRateLimit seconds after it
+// started, so a fast machine doesn't spin drawing frames no
+// one will see
+// - Sleeps while there's more than a couple of milliseconds
+//   to go, since a sleep can run a millisecond long, then
+//   gives up the rest of its time slice until the deadline
+// --------------------------------------------------------
+void DXCore::WaitForFrameLimit()
+{
+	if (frameRateLimit <= 0.0f)
+		return;
+
+	__int64 deadline = currentTime + (__int64)(1.0 / (frameRateLimit * perfCounterSeconds));
+	__int64 sleepMargin = (__int64)(0.002 / perfCounterSeconds);
+
+	__int64 now = 0;
+	QueryPerformanceCounter((LARGE_INTEGER*)&now);
+	while (deadline - now > sleepMargin)
+	{
+		Sleep(1);
+		QueryPerformanceCounter((LARGE_INTEGER*)&now);
+	}
+	while (now < deadline)
+	{
+		SwitchToThread();
+		QueryPerformanceCounter((LARGE_INTEGER*)&now);
+	}
+}
+
+
 // --------------------------------------------------------
 // Updates the window's title bar with several stats once
 // per second, including:
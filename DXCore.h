@@ -12,6 +12,7 @@
 // instead of in Visual Studio settings if we want
 #pragma comment(lib, "d3d11.lib")
 #pragma comment(lib, "dxgi.lib")
+#pragma comment(lib, "winmm.lib")	// For timeBeginPeriod(), so Sleep(1) is close to 1 ms
 
 class DXCore
 {
@@ -45,8 +46,12 @@ public:
 	virtual void OnResize();
 
 	// Pure virtual methods for setup and game functionality
+	// - Update() and Draw() run once per frame
+	// - FixedUpdate() runs tickRate times per second of game time,
+	//   however fast frames are, with tickTime always 1 / tickRate
 	virtual void Init() = 0;
 	virtual void Update(float deltaTime, float totalTime) = 0;
+	virtual void FixedUpdate(float tickTime, float totalTime) = 0;
 	virtual void Draw(float deltaTime, float totalTime) = 0;
 
 protected:
@@ -78,6 +83,19 @@ protected:
 	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> backBufferRTV;
 	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> depthBufferDSV;
 
+	// Fixed timestep settings - see Run()
+	float tickRate;					// FixedUpdate() calls per second
+	unsigned int maxTicksPerFrame;	// Time owed past this many ticks is dropped
+	float frameRateLimit;			// Frames per second to sleep down to, or 0 for no limit
+
+	// How far the current frame is between the last tick and the
+	// next one (0 to 1), for Draw() to blend the two
+	float tickBlend;
+
+	// Ticks run during the current frame, and ticks dropped so far
+	unsigned int frameTicks;
+	unsigned int droppedTicks;
+
 	// Helper function for allocating a console window
 	void CreateConsoleWindow(int bufferLines, int bufferColumns, int windowLines, int windowColumns);
 
@@ -94,7 +112,13 @@ private:
 	int fpsFrameCount;
 	float fpsTimeElapsed;
 
+	// Fixed timestep state
+	double tickTimeOwed;		// Frame time not yet simulated
+	double simulationTime;		// Game time simulated so far
+
 	void UpdateTimer();			// Updates the timer for this frame
 	void UpdateTitleBarStats();	// Puts debug info in the title bar
+	void RunTicks();			// Catches the simulation up with the timer
+	void WaitForFrameLimit();	// Sleeps off whatever's left of the frame
 };
 
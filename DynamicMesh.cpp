@@ -0,0 +1,218 @@
+#include "DynamicMesh.h"
+
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	// Marks "hasn't wrapped yet"
+	const unsigned int noFrame = 0xFFFFFFFF;
+}
+
+unsigned int GetRingCapacity(unsigned int bytesPerFrame, unsigned int framesInFlight)
+{
+	return bytesPerFrame * (framesInFlight + 1);
+}
+
+RingAllocator::RingAllocator(unsigned int capacity, unsigned int framesInFlight)
+	:
+	capacity(capacity),
+	framesInFlight(framesInFlight),
+	head(capacity),
+	frameCount(0),
+	wrapCount(0),
+	earlyWrapCount(0),
+	lastWrapFrame(noFrame)
+{
+}
+
+bool RingAllocator::Allocate(unsigned int size, unsigned int alignment, RingAllocation& allocation)
+{
+	if (size > capacity)
+		return false;
+
+	// Round up to the alignment, then wrap if the update would
+	// run past the end
+	unsigned int offset = head;
+	if (alignment > 1)
+		offset = (offset + alignment - 1) / alignment * alignment;
+
+	allocation.wrapped = offset > capacity || capacity - offset < size;
+	if (allocation.wrapped)
+	{
+		offset = 0;
+
+		// The first wrap just sets the buffer up
+		if (lastWrapFrame != noFrame)
+		{
+			wrapCount++;
+			if (frameCount - lastWrapFrame <= framesInFlight)
+				earlyWrapCount++;
+		}
+		lastWrapFrame = frameCount;
+	}
+
+	allocation.offset = offset;
+	head = offset + size;
+	return true;
+}
+
+void RingAllocator::EndFrame()
+{
+	frameCount++;
+}
+
+unsigned int RingAllocator::GetCapacity()
+{
+	return capacity;
+}
+
+unsigned int RingAllocator::GetFrameCount()
+{
+	return frameCount;
+}
+
+unsigned int RingAllocator::GetWrapCount()
+{
+	return wrapCount;
+}
+
+unsigned int RingAllocator::GetEarlyWrapCount()
+{
+	return earlyWrapCount;
+}
+
+DynamicMesh::DynamicMesh(
+	unsigned int maxVertexCount,
+	const unsigned int* indices,
+	unsigned int indexCount,
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext,
+	unsigned int framesInFlight)
+	:
+	deviceContext(deviceContext),
+	ring(GetRingCapacity(maxVertexCount * sizeof(Vertex), framesInFlight), framesInFlight),
+	maxVertexCount(maxVertexCount),
+	indexCount(indexCount),
+	baseVertex(0),
+	mapped(false),
+	hasVertices(false)
+{
+	//Vertex Buffer
+	D3D11_BUFFER_DESC vbd = {};
+	vbd.Usage = D3D11_USAGE_DYNAMIC;
+	vbd.ByteWidth = ring.GetCapacity();
+	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vbd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	vbd.MiscFlags = 0;
+	vbd.StructureByteStride = 0;
+
+	device->CreateBuffer(&vbd, 0, vertexBuffer.GetAddressOf());
+
+	// Without indices there's nothing to draw, and a zero-sized
+	// index buffer can't be made, so none is
+	indexFormat = DXGI_FORMAT_R32_UINT;
+	if (!indices || indexCount == 0)
+	{
+		this->indexCount = 0;
+		return;
+	}
+
+	// Index data, with 16 bits whenever every index fits
+	const void* indexData = indices;
+	std::vector<unsigned short> shortIndices;
+	unsigned int indexSize = sizeof(unsigned int);
+	if (maxVertexCount <= 0x10000)
+	{
+		shortIndices.assign(indices, indices + indexCount);
+		indexData = shortIndices.data();
+		indexFormat = DXGI_FORMAT_R16_UINT;
+		indexSize = sizeof(unsigned short);
+	}
+
+	//Index Buffer
+	D3D11_BUFFER_DESC ibd = {};
+	ibd.Usage = D3D11_USAGE_IMMUTABLE;
+	ibd.ByteWidth = indexSize * indexCount;
+	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	ibd.CPUAccessFlags = 0;
+	ibd.MiscFlags = 0;
+	ibd.StructureByteStride = 0;
+
+	D3D11_SUBRESOURCE_DATA initialIndexData = {};
+	initialIndexData.pSysMem = indexData;
+
+	device->CreateBuffer(&ibd, &initialIndexData, indexBuffer.GetAddressOf());
+}
+
+Vertex* DynamicMesh::BeginUpdate(unsigned int vertexCount)
+{
+	if (mapped || vertexCount > maxVertexCount)
+		return 0;
+
+	RingAllocation allocation;
+	if (!ring.Allocate(vertexCount * sizeof(Vertex), sizeof(Vertex), allocation))
+		return 0;
+
+	D3D11_MAPPED_SUBRESOURCE map = {};
+	D3D11_MAP mapType = allocation.wrapped ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+	if (FAILED(deviceContext->Map(vertexBuffer.Get(), 0, mapType, 0, &map)))
+		return 0;
+
+	mapped = true;
+	baseVertex = allocation.offset / sizeof(Vertex);
+	return (Vertex*)map.pData + baseVertex;
+}
+
+void DynamicMesh::EndUpdate()
+{
+	if (!mapped)
+		return;
+
+	deviceContext->Unmap(vertexBuffer.Get(), 0);
+	mapped = false;
+	hasVertices = true;
+}
+
+void DynamicMesh::Update(const Vertex* vertices, unsigned int vertexCount)
+{
+	Vertex* destination = BeginUpdate(vertexCount);
+	if (!destination)
+		return;
+
+	memcpy(destination, vertices, vertexCount * sizeof(Vertex));
+	EndUpdate();
+}
+
+void DynamicMesh::Draw()
+{
+	if (!hasVertices || mapped || indexCount == 0)
+		return;
+
+	UINT stride = sizeof(Vertex);
+	UINT offset = 0;
+	deviceContext->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
+	deviceContext->IASetIndexBuffer(indexBuffer.Get(), indexFormat, 0);
+
+	deviceContext->DrawIndexed(indexCount, 0, (int)baseVertex);
+}
+
+void DynamicMesh::EndFrame()
+{
+	ring.EndFrame();
+}
+
+unsigned int DynamicMesh::GetMaxVertexCount()
+{
+	return maxVertexCount;
+}
+
+unsigned int DynamicMesh::GetIndexCount()
+{
+	return indexCount;
+}
+
+RingAllocator& DynamicMesh::GetRing()
+{
+	return ring;
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include "Vertex.h"
+
+// Frames the CPU can get ahead of the GPU, which is DXGI's
+// default maximum frame latency
+const unsigned int dynamicFramesInFlight = 3;
+
+// --------------------------------------------------------
+// Ring buffer sizing without fences
+//
+// - Present() blocks once framesInFlight frames are queued,
+//   so data written framesInFlight + 1 frames ago has been
+//   consumed by the time the ring wraps back around to it
+// - A ring that holds that many frames of updates only wraps
+//   when the GPU is done with the buffer, so the DISCARD on
+//   wrap never has to wait or rename memory that's in use
+// --------------------------------------------------------
+unsigned int GetRingCapacity(unsigned int bytesPerFrame, unsigned int framesInFlight = dynamicFramesInFlight);
+
+// --------------------------------------------------------
+// Where one update landed in the ring
+// --------------------------------------------------------
+struct RingAllocation
+{
+	unsigned int offset;	// In bytes, a multiple of the alignment
+	bool wrapped;			// Map with DISCARD instead of NO_OVERWRITE
+};
+
+// --------------------------------------------------------
+// The CPU side of a ring buffer, with no GPU resources of its
+// own so it can be tested without a device
+//
+// - Updates are placed one after another, and wrapping back
+//   to the start tells the caller to discard the buffer
+// - The very first update also wraps, since a dynamic buffer
+//   has to be discarded before its first write
+// - Alignments can be any size (a vertex stride, say), so
+//   offsets divide evenly into a baseVertex
+// --------------------------------------------------------
+class RingAllocator
+{
+public:
+	RingAllocator(unsigned int capacity = 0, unsigned int framesInFlight = dynamicFramesInFlight);
+
+	// Returns false if the update could never fit
+	bool Allocate(unsigned int size, unsigned int alignment, RingAllocation& allocation);
+
+	// Call once per frame, after the frame's updates
+	void EndFrame();
+
+	unsigned int GetCapacity();
+	unsigned int GetFrameCount();
+	unsigned int GetWrapCount();
+
+	// Wraps that came sooner than the ring's sizing allows for,
+	// where the DISCARD may rename a buffer the GPU still uses
+	unsigned int GetEarlyWrapCount();
+
+private:
+	unsigned int capacity;
+	unsigned int framesInFlight;
+	unsigned int head;
+	unsigned int frameCount;
+	unsigned int wrapCount;
+	unsigned int earlyWrapCount;
+	unsigned int lastWrapFrame;
+};
+
+// --------------------------------------------------------
+// A mesh whose vertices are rewritten by the CPU, such as
+// procedural or deforming geometry
+//
+// - Indices are fixed and uploaded once
+// - Vertices go into a ring inside one dynamic buffer, sized
+//   for dynamicFramesInFlight + 1 full updates, and draw with
+//   a baseVertex pointing at the latest update
+// - Each update is mapped with NO_OVERWRITE, so the GPU keeps
+//   reading older updates undisturbed, and with DISCARD when
+//   the ring wraps
+// --------------------------------------------------------
+class DynamicMesh
+{
+public:
+	DynamicMesh(
+		unsigned int maxVertexCount,
+		const unsigned int* indices,
+		unsigned int indexCount,
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext,
+		unsigned int framesInFlight = dynamicFramesInFlight);
+
+	// Maps room for this many vertices (at most maxVertexCount)
+	// to be written directly, or returns null if it can't
+	// - Write every vertex, then call EndUpdate()
+	Vertex* BeginUpdate(unsigned int vertexCount);
+	void EndUpdate();
+
+	// Copies a whole update in one go
+	void Update(const Vertex* vertices, unsigned int vertexCount);
+
+	// Draws the latest update
+	void Draw();
+
+	// Call once per frame, after the last Draw()
+	void EndFrame();
+
+	unsigned int GetMaxVertexCount();
+	unsigned int GetIndexCount();
+	RingAllocator& GetRing();
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext;
+	RingAllocator ring;
+	unsigned int maxVertexCount;
+	unsigned int indexCount;
+	DXGI_FORMAT indexFormat;
+	unsigned int baseVertex;
+	bool mapped;
+	bool hasVertices;
+};
@@ -3,14 +3,38 @@
 #include "Input.h"
 #include "Material.h"
 #include "WICTextureLoader.h"
+#include "Benchmarks.h"
 
 // Needed for a helper function to load pre-compiled shader files
 #pragma comment(lib, "d3dcompiler.lib")
 #include <d3dcompiler.h>
 
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
 // For the DirectX Math library
 using namespace DirectX;
 
+namespace
+{
+	// Vertices along each side of the wave grid, and its size
+	const int waveResolution = 64;
+	const float waveSize = 10.0f;
+
+	// A click moving the mouse further than this (in pixels) was
+	// a camera drag rather than a pick
+	const int pickMaxDragPixels = 3;
+
+	// How the shapes swing back and forth: how fast they move
+	// (units per second), how much they grow or shrink (scale
+	// per second) and for how long before turning around
+	const float shapeSpeed = 1.2f;
+	const float shapeGrowth = 1.062f;
+	const float shapeSwingSeconds = 10.0f / 3.0f;
+}
+
 // --------------------------------------------------------
 // Constructor
 //
@@ -41,6 +65,11 @@ Game::Game(HINSTANCE hInstance)
 	blurAmount = 0.0f;
 	XMStoreFloat4x4(&lightViewMatrix, XMMatrixIdentity());
 	XMStoreFloat4x4(&lightProjectionMatrix, XMMatrixIdentity());
+
+	// The shapes tick at a steady rate, and frames are capped well
+	// above it rather than spinning as fast as the GPU goes
+	tickRate = 60.0f;
+	frameRateLimit = 240.0f;
 }
 
 // --------------------------------------------------------
@@ -72,7 +101,15 @@ void Game::Init()
 	//  - You'll be expanding and/or replacing these later
 	LoadShaders();
 	LoadTextures();
+
+	// Time geometry creation, since it's where cooked meshes pay off
+	auto geometryStart = std::chrono::high_resolution_clock::now();
 	CreateGeometry();
+	geometryLoadTime = std::chrono::duration<float, std::milli>(
+		std::chrono::high_resolution_clock::now() - geometryStart).count();
+	printf("Geometry loaded in %.3f ms\n", geometryLoadTime);
+	printf("%s\n", meshCache->GetReport().c_str());
+	printf("%s\n", geometryArena->GetReport().c_str());
 	LoadSky();
 	PostProcessSetup();
 
@@ -161,6 +198,20 @@ void Game::LoadShaders()
 		context,
 		FixPath(L"CustomPS.cso").c_str());
 
+	//compact vertex shaders, which need an input layout made for CompactVertex
+	compactVertexShader = std::make_shared<SimpleVertexShader>(
+		device,
+		context,
+		FixPath(L"CompactVertexShader.cso").c_str(),
+		CreateCompactInputLayout(device, FixPath(L"CompactVertexShader.cso").c_str()),
+		false);
+	compactShadowVS = std::make_shared<SimpleVertexShader>(
+		device,
+		context,
+		FixPath(L"CompactShadowVS.cso").c_str(),
+		CreateCompactInputLayout(device, FixPath(L"CompactShadowVS.cso").c_str(), true),
+		false);
+
 	skyVS = std::make_shared<SimpleVertexShader>(
 		device,
 		context,
@@ -231,7 +282,7 @@ void Game::LoadTextures()
 		FixPath(L"../../Assets/Textures/PBR/bronze_metal.png").c_str(),
 		0, bronzeSRVM.GetAddressOf());
 
-	mat1 = std::make_shared<Material>(XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), vertexShader, pixelShader, 0.0);
+	mat1 = std::make_shared<Material>(XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), compactVertexShader, pixelShader, 0.0);
 	mat1->AddSampler("BasicSampler", samplerState);
 	mat1->AddTextureSRV("Albedo", bronzeSRVA);
 	mat1->AddTextureSRV("NormalMap", bronzeSRVN);
@@ -263,7 +314,7 @@ void Game::LoadTextures()
 		FixPath(L"../../Assets/Textures/PBR/cobblestone_metal.png").c_str(),
 		0, cobblestoneSRVM.GetAddressOf());
 
-	mat2 = std::make_shared<Material>(XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), vertexShader, pixelShader, 0.0);
+	mat2 = std::make_shared<Material>(XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), compactVertexShader, pixelShader, 0.0);
 	mat2->AddSampler("BasicSampler", samplerState);
 	mat2->AddTextureSRV("Albedo", cobblestoneSRVA);
 	mat2->AddTextureSRV("NormalMap", cobblestoneSRVN);
@@ -295,7 +346,7 @@ void Game::LoadTextures()
 		FixPath(L"../../Assets/Textures/PBR/floor_metal.png").c_str(),
 		0, floorSRVM.GetAddressOf());
 
-	mat3 = std::make_shared<Material>(XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), vertexShader, pixelShader, 0.0);
+	mat3 = std::make_shared<Material>(XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), compactVertexShader, pixelShader, 0.0);
 	mat3->AddSampler("BasicSampler", samplerState);
 	mat3->AddTextureSRV("Albedo", floorSRVA);
 	mat3->AddTextureSRV("NormalMap", floorSRVN);
@@ -327,7 +378,7 @@ void Game::LoadTextures()
 		FixPath(L"../../Assets/Textures/PBR/paint_metal.png").c_str(),
 		0, paintSRVM.GetAddressOf());
 
-	mat4 = std::make_shared<Material>(XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), vertexShader, pixelShader, 0.0);
+	mat4 = std::make_shared<Material>(XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), compactVertexShader, pixelShader, 0.0);
 	mat4->AddSampler("BasicSampler", samplerState);
 	mat4->AddTextureSRV("Albedo", paintSRVA);
 	mat4->AddTextureSRV("NormalMap", paintSRVN);
@@ -359,7 +410,7 @@ void Game::LoadTextures()
 		FixPath(L"../../Assets/Textures/PBR/scratched_metal.png").c_str(),
 		0, scratchSRVM.GetAddressOf());
 
-	mat5 = std::make_shared<Material>(XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), vertexShader, pixelShader, 0.0);
+	mat5 = std::make_shared<Material>(XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), compactVertexShader, pixelShader, 0.0);
 	mat5->AddSampler("BasicSampler", samplerState);
 	mat5->AddTextureSRV("Albedo", scratchSRVA);
 	mat5->AddTextureSRV("NormalMap", scratchSRVN);
@@ -391,12 +442,20 @@ void Game::LoadTextures()
 		FixPath(L"../../Assets/Textures/PBR/wood_metal.png").c_str(),
 		0, woodSRVM.GetAddressOf());
 
-	mat6 = std::make_shared<Material>(XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), vertexShader, pixelShader, 0.0);
+	mat6 = std::make_shared<Material>(XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), compactVertexShader, pixelShader, 0.0);
 	mat6->AddSampler("BasicSampler", samplerState);
 	mat6->AddTextureSRV("Albedo", woodSRVA);
 	mat6->AddTextureSRV("NormalMap", woodSRVN);
 	mat6->AddTextureSRV("RoughnessMap", woodSRVR);
 	mat6->AddTextureSRV("MetalnessMap", woodSRVM);
+
+	//The waves are rewritten every frame, so they stay full vertices
+	waveMaterial = std::make_shared<Material>(XMFLOAT4(0.6f, 0.8f, 1.0f, 1.0f), vertexShader, pixelShader, 0.0);
+	waveMaterial->AddSampler("BasicSampler", samplerState);
+	waveMaterial->AddTextureSRV("Albedo", paintSRVA);
+	waveMaterial->AddTextureSRV("NormalMap", paintSRVN);
+	waveMaterial->AddTextureSRV("RoughnessMap", paintSRVR);
+	waveMaterial->AddTextureSRV("MetalnessMap", paintSRVM);
 }
 
 void Game::LoadSky()
@@ -539,58 +598,164 @@ void Game::PostProcessSetup()
 // --------------------------------------------------------
 void Game::CreateGeometry()
 {
+	geometryArena = std::make_shared<GeometryArena>(device, context);
+	objectBuffer = std::make_shared<ObjectBuffer>(device, context);
+	meshCache = std::make_shared<MeshCache>(device, context, geometryArena);
+
+	//The shapes' materials use the compact vertex shader, so their meshes
+	//are uploaded compact.  The sky's shader reads full vertices.
+	MeshLoadOptions compact;
+	compact.compactVertices = true;
+
 	shapes[0] = std::make_shared<GameEntity>(
-		std::make_shared<Mesh>(
-			FixPath(L"../../Assets/Models/cube.obj").c_str(),
-			device,
-			context),
+		meshCache->Load(
+			FixPath(L"../../Assets/Models/cube.obj").c_str(), compact),
 		mat1);
 	shapes[0]->GetTransform()->MoveAbsolute(-12, 0, 0);
 
 	shapes[1] = std::make_shared<GameEntity>(
-		std::make_shared<Mesh>(
-			FixPath(L"../../Assets/Models/cylinder.obj").c_str(),
-			device,
-			context),
+		meshCache->Load(
+			FixPath(L"../../Assets/Models/cylinder.obj").c_str(), compact),
 		mat2);
 	shapes[1]->GetTransform()->MoveAbsolute(-5, 0, 0);
 
 	shapes[2] = std::make_shared<GameEntity>(
-		std::make_shared<Mesh>(
-			FixPath(L"../../Assets/Models/helix.obj").c_str(),
-			device,
-			context),
+		meshCache->Load(
+			FixPath(L"../../Assets/Models/helix.obj").c_str(), compact),
 		mat3);
 	shapes[2]->GetTransform()->MoveAbsolute(0, 0, 0);
 
 	shapes[3] = std::make_shared<GameEntity>(
-		std::make_shared<Mesh>(
-			FixPath(L"../../Assets/Models/sphere.obj").c_str(),
-			device,
-			context),
+		meshCache->Load(
+			FixPath(L"../../Assets/Models/sphere.obj").c_str(), compact),
 		mat4);
 	shapes[3]->GetTransform()->MoveAbsolute(5, 0, 0);
 
 	shapes[4] = std::make_shared<GameEntity>(
-		std::make_shared<Mesh>(
-			FixPath(L"../../Assets/Models/torus.obj").c_str(),
-			device,
-			context),
+		meshCache->Load(
+			FixPath(L"../../Assets/Models/torus.obj").c_str(), compact),
 		mat5);
 	shapes[4]->GetTransform()->MoveAbsolute(10, 0, 0);
 
-	shapes[5] = std::make_shared<GameEntity>(std::make_shared<Mesh>(
-		FixPath(L"../../Assets/Models/cube.obj").c_str(),
-		device,
-		context),
+	shapes[5] = std::make_shared<GameEntity>(meshCache->Load(
+		FixPath(L"../../Assets/Models/cube.obj").c_str(), compact),
 		mat6);
 	shapes[5]->GetTransform()->Scale(15.0f, 1.0f, 10.0f);
 	shapes[5]->GetTransform()->MoveAbsolute(0, -2.5f, 0);
+	for (int i = 0; i < 6; i++) {
+		shapes[i]->SetObjectIndex(objectBuffer->Add(shapes[i]->GetTransform()));
+		shapeMotion.Add(shapes[i]->GetTransform());
+	}
+	picker.Build(std::vector<std::shared_ptr<GameEntity>>(shapes, shapes + 6));
+
+	skyMesh = meshCache->Load(
+		FixPath(L"../../Assets/Models/cube.obj").c_str());
 
-	skyMesh = std::make_shared<Mesh>(
-		FixPath(L"../../Assets/Models/cube.obj").c_str(),
+	CreateWaves();
+}
+
+// --------------------------------------------------------
+// Creates the wave grid's indices and its dynamic mesh, which
+// gets its vertices from UpdateWaves()
+// --------------------------------------------------------
+void Game::CreateWaves()
+{
+	std::vector<unsigned int> indices;
+	indices.reserve((waveResolution - 1) * (waveResolution - 1) * 6);
+	for (int z = 0; z < waveResolution - 1; z++)
+	{
+		for (int x = 0; x < waveResolution - 1; x++)
+		{
+			unsigned int corner = z * waveResolution + x;
+			indices.push_back(corner);
+			indices.push_back(corner + waveResolution);
+			indices.push_back(corner + 1);
+			indices.push_back(corner + 1);
+			indices.push_back(corner + waveResolution);
+			indices.push_back(corner + waveResolution + 1);
+		}
+	}
+
+	waves = std::make_shared<DynamicMesh>(
+		waveResolution * waveResolution,
+		&indices[0],
+		(unsigned int)indices.size(),
 		device,
 		context);
+
+	waveTransform = std::make_shared<Transform>();
+	waveTransform->MoveAbsolute(0, 1.0f, 10.0f);
+	waveObjectIndex = objectBuffer->Add(waveTransform);
+}
+
+// --------------------------------------------------------
+// Writes this frame's wave heights straight into the mapped
+// ring, with normals and tangents from the height's slopes
+// --------------------------------------------------------
+void Game::UpdateWaves(float totalTime)
+{
+	Vertex* vertices = waves->BeginUpdate(waveResolution * waveResolution);
+	if (!vertices)
+		return;
+
+	const float amplitude = 0.4f;
+	const float frequency = 1.2f;
+	float spacing = waveSize / (waveResolution - 1);
+	for (int z = 0; z < waveResolution; z++)
+	{
+		for (int x = 0; x < waveResolution; x++)
+		{
+			float px = x * spacing - waveSize * 0.5f;
+			float pz = z * spacing - waveSize * 0.5f;
+			float sx = sinf(px * frequency + totalTime);
+			float cz = cosf(pz * frequency + totalTime * 0.7f);
+			float height = amplitude * sx * cz;
+			float slopeX = amplitude * frequency * cosf(px * frequency + totalTime) * cz;
+			float slopeZ = -amplitude * frequency * sx * sinf(pz * frequency + totalTime * 0.7f);
+
+			Vertex v;
+			v.position = XMFLOAT3(px, height, pz);
+			XMStoreFloat3(&v.normal, XMVector3Normalize(XMVectorSet(-slopeX, 1.0f, -slopeZ, 0.0f)));
+			XMStoreFloat3(&v.tangent, XMVector3Normalize(XMVectorSet(1.0f, slopeX, 0.0f, 0.0f)));
+			v.uv = XMFLOAT2((float)x / (waveResolution - 1), (float)z / (waveResolution - 1));
+			vertices[z * waveResolution + x] = v;
+		}
+	}
+
+	waves->EndUpdate();
+}
+
+// --------------------------------------------------------
+// Draws the waves with the full vertex shader
+// - The lights and ambient color are already set on the
+//   shared pixel shader by the shapes drawn before them
+// --------------------------------------------------------
+void Game::DrawWaves()
+{
+	Camera& activeCam = *camera[activeCamera];
+	std::shared_ptr<SimpleVertexShader> vs = waveMaterial->GetVertexShader();
+	std::shared_ptr<SimplePixelShader> ps = waveMaterial->GetPixelShader();
+
+	waveMaterial->AddTextureSRV("ShadowMap", shadowSRV);
+	waveMaterial->AddSampler("ShadowSampler", shadowSampler);
+	waveMaterial->PrepareMaterial();
+	vs->SetShader();
+	ps->SetShader();
+
+	vs->SetMatrix4x4("view", activeCam.GetView());
+	vs->SetMatrix4x4("projection", activeCam.GetProjection());
+	vs->SetInt("objectIndex", (int)waveObjectIndex);
+	vs->SetMatrix4x4("lightView", lightViewMatrix);
+	vs->SetMatrix4x4("lightProjection", lightProjectionMatrix);
+
+	ps->SetFloat4("colorTint", waveMaterial->GetTint());
+	ps->SetFloat3("cameraPos", activeCam.GetTransform()->GetPosition());
+	ps->SetFloat("roughness", waveMaterial->GetRoughness());
+
+	vs->CopyAllBufferData();
+	ps->CopyAllBufferData();
+
+	waves->Draw();
 }
 
 
@@ -633,14 +798,66 @@ void Game::Update(float deltaTime, float totalTime)
 		input.SetKeyboardCapture(io.WantCaptureKeyboard);
 		input.SetMouseCapture(io.WantCaptureMouse);
 
+		// A left click that doesn't drag the camera around picks
+		// the shape under the mouse
+		if (input.MouseLeftPress()) {
+			pickPressed = true;
+			pickPressX = input.GetMouseX();
+			pickPressY = input.GetMouseY();
+		}
+		if (input.MouseLeftRelease() && pickPressed) {
+			pickPressed = false;
+			if (abs(input.GetMouseX() - pickPressX) + abs(input.GetMouseY() - pickPressY) <= pickMaxDragPixels) {
+				auto pickStart = std::chrono::high_resolution_clock::now();
+				XMFLOAT3 origin;
+				XMFLOAT3 direction;
+				camera[activeCamera]->GetPickRay(
+					(float)input.GetMouseX(), (float)input.GetMouseY(),
+					(float)windowWidth, (float)windowHeight,
+					origin, direction);
+				picker.Refit();
+				PickHit hit;
+				int picked = picker.Raycast(origin, direction, FLT_MAX, hit) ? hit.entity : -1;
+				pickTime = std::chrono::duration<float, std::milli>(
+					std::chrono::high_resolution_clock::now() - pickStart).count();
+				selectionChanged = picked != selectedShape;
+				selectedShape = picked;
+			}
+		}
+
 		// Show the demo window
 		//ImGui::ShowDemoWindow(); 
 		ImGui::Begin("Window");
 		ImGui::Text("FPS: %f", io.Framerate);
 		ImGui::Text("Window dimensions: %i x %i", windowWidth, windowHeight);
+		ImGui::Text("Geometry load time: %.3f ms", geometryLoadTime);
+		ImGui::Checkbox("Use LODs", &useLods);
+		ImGui::Checkbox("Cull meshlets", &cullMeshlets);
+		ImGui::Text("Triangles per frame: %u (%u without LODs or culling)", trianglesDrawn, trianglesWithoutLods);
+		ImGui::Text("Meshlets drawn: %u of %u", meshletsDrawn, meshletsTotal);
+		ImGui::Text("Vertex fetch saved by compact meshes: at least %.1f KB per frame", fetchBytesSaved / 1024.0f);
+		ImGui::Text("Vertex/index buffer binds: %u per frame", geometryBinds);
+		ImGui::SliderFloat("Tick rate", &tickRate, 10.0f, 240.0f, "%.0f Hz");
+		ImGui::SliderFloat("Frame rate limit", &frameRateLimit, 0.0f, 1000.0f, frameRateLimit > 0.0f ? "%.0f FPS" : "None");
+		ImGui::Text("Ticks: %u this frame, %u dropped, %u shapes blended", frameTicks, droppedTicks, shapeMotion.GetBlendedCount());
+		ImGui::Text("Transforms rebuilt: %u of %u", transformsUpdated, TransformSystem::GetInstance().GetCount());
+		ImGui::Text("Object data uploaded: %u bytes per frame (%u of %u objects)",
+			objectBuffer->GetUploadBytes(),
+			objectBuffer->GetUploadCount(),
+			objectBuffer->GetCount());
+		ImGui::Text("Wave ring: %u KB, %u wraps (%u early)",
+			waves->GetRing().GetCapacity() / 1024,
+			waves->GetRing().GetWrapCount(),
+			waves->GetRing().GetEarlyWrapCount());
+		if (selectedShape >= 0)
+			ImGui::Text("Picked shape %i (%.3f ms)", selectedShape, pickTime);
+		else
+			ImGui::Text("Click a shape to pick it");
 		for (int i = 0; i < 6; i++) {
 			ImGui::PushID(i);
-			if (ImGui::CollapsingHeader("Shape"))
+			if (selectionChanged && i == selectedShape)
+				ImGui::SetNextItemOpen(true);
+			if (ImGui::CollapsingHeader(i == selectedShape ? "Shape (picked)###Shape" : "Shape###Shape"))
 			{
 
 				if (ImGui::DragFloat3("Translation", translation[i])) {
@@ -653,7 +870,7 @@ void Game::Update(float deltaTime, float totalTime)
 					shapes[i]->GetTransform()->SetScale(XMFLOAT3(scale[i]));
 				}
 				if (ImGui::ColorEdit3("Color", colorOffset[i])) {
-					shapes[i]->GetMesh()->SetTint(colorOffset[i][0], colorOffset[i][1], colorOffset[i][2], colorOffset[i][3]);
+					shapes[i]->SetTint(colorOffset[i][0], colorOffset[i][1], colorOffset[i][2], colorOffset[i][3]);
 				}
 			}
 			ImGui::PopID();
@@ -716,45 +933,131 @@ void Game::Update(float deltaTime, float totalTime)
 			}
 			ImGui::PopID();
 		}
+		if (ImGui::CollapsingHeader("Mesh Cache")) {
+			ImGui::TextUnformatted(meshCache->GetReport().c_str());
+		}
+		if (ImGui::CollapsingHeader("Geometry Arena")) {
+			if (ImGui::Button("Compact")) {
+				unsigned long long bytesCopied = geometryArena->Compact();
+				arenaReport = "Compacted, " + std::to_string(bytesCopied) + " bytes copied";
+			}
+			ImGui::TextUnformatted(geometryArena->GetReport().c_str());
+			ImGui::TextUnformatted(arenaReport.c_str());
+		}
+		if (ImGui::CollapsingHeader("Benchmarks")) {
+			if (ImGui::Button("OBJ Parsing")) {
+				benchmarkReport = BenchmarkObjParsing();
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Parallel OBJ Parsing")) {
+				benchmarkReport = BenchmarkParallelObjParsing();
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("GLB Loading")) {
+				benchmarkReport = BenchmarkGlbLoading();
+			}
+			if (ImGui::Button("Vertex Welding")) {
+				benchmarkReport = BenchmarkVertexWelding();
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Mesh Optimization")) {
+				benchmarkReport = BenchmarkMeshOptimization();
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Tangent Generation")) {
+				benchmarkReport = BenchmarkTangentGeneration();
+			}
+			if (ImGui::Button("Scene Loading")) {
+				benchmarkReport = BenchmarkSceneLoading(device, context);
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Streaming Import")) {
+				benchmarkReport = BenchmarkStreamingImport();
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Mesh Raycasts")) {
+				benchmarkReport = BenchmarkMeshRaycasts();
+			}
+			if (ImGui::Button("Scene Picking")) {
+				benchmarkReport = BenchmarkScenePicking(
+					std::vector<std::shared_ptr<GameEntity>>(shapes, shapes + 6));
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Mesh Compression")) {
+				benchmarkReport = BenchmarkMeshCompression();
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Transform Updates")) {
+				benchmarkReport = BenchmarkTransformUpdates();
+			}
+			if (ImGui::Button("Transform Hierarchy")) {
+				benchmarkReport = BenchmarkTransformHierarchy();
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Transform Rotations")) {
+				benchmarkReport = BenchmarkTransformRotations();
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Transform Classes")) {
+				benchmarkReport = BenchmarkTransformClasses();
+			}
+			ImGui::TextUnformatted(benchmarkReport.c_str());
+		}
 		ImGui::SliderInt("Blur Amount", &blurAmount, 0.0f, 5.0f);
 		//ImGui::Image(shadowSRV.Get(), ImVec2(1024, 1024));
 
 		ImGui::End();
+		selectionChanged = false;
 		if (input.KeyPress('C')) {
 			activeCamera = (activeCamera + 1) % 3;
 		}
 	}
 
-	//Shape movement
-	if (counter < 200 && going) {
-		shapes[0]->GetTransform()->MoveAbsolute(0.02f, 0, 0);
-		shapes[1]->GetTransform()->Scale(0.999f, 0.999f, 0.999f);
-		shapes[2]->GetTransform()->MoveAbsolute(0, 0.02f, 0);
-		shapes[3]->GetTransform()->Scale(1.001f, 1.001f, 1.001f);
-		shapes[4]->GetTransform()->MoveAbsolute(0, 0, 0.02f);
-		counter++;
+	camera[activeCamera]->Update(deltaTime);
+
+	UpdateWaves(totalTime);
+
+	// Example input checking: Quit if the escape key is pressed
+	if (Input::GetInstance().KeyDown(VK_ESCAPE))
+		Quit();
+
+}
+
+// --------------------------------------------------------
+// Moves the shapes by one fixed tick, so they move the same
+// however fast frames are drawn
+// --------------------------------------------------------
+void Game::FixedUpdate(float tickTime, float totalTime)
+{
+	shapeMotion.BeginTick();
+
+	float step = shapeSpeed * tickTime;
+	float grow = powf(shapeGrowth, tickTime);
+	float shrink = 1.0f / grow;
+	if (swingTime < shapeSwingSeconds && going) {
+		shapes[0]->GetTransform()->MoveAbsolute(step, 0, 0);
+		shapes[1]->GetTransform()->Scale(shrink, shrink, shrink);
+		shapes[2]->GetTransform()->MoveAbsolute(0, step, 0);
+		shapes[3]->GetTransform()->Scale(grow, grow, grow);
+		shapes[4]->GetTransform()->MoveAbsolute(0, 0, step);
+		swingTime += tickTime;
 	}
 	else {
-		if (counter <= 0) {
+		if (swingTime <= 0.0f) {
 			going = true;
 		}
 		else {
 			going = false;
 		}
-		shapes[0]->GetTransform()->MoveAbsolute(-0.02f, 0, 0);
-		shapes[1]->GetTransform()->Scale(1.001f, 1.001f, 1.001f);
-		shapes[2]->GetTransform()->MoveAbsolute(0, -0.02f, 0);
-		shapes[3]->GetTransform()->Scale(0.999f, 0.999f, 0.999f);
-		shapes[4]->GetTransform()->MoveAbsolute(0, 0, -0.02f);
-		counter--;
+		shapes[0]->GetTransform()->MoveAbsolute(-step, 0, 0);
+		shapes[1]->GetTransform()->Scale(grow, grow, grow);
+		shapes[2]->GetTransform()->MoveAbsolute(0, -step, 0);
+		shapes[3]->GetTransform()->Scale(shrink, shrink, shrink);
+		shapes[4]->GetTransform()->MoveAbsolute(0, 0, -step);
+		swingTime -= tickTime;
 	}
 
-	camera[activeCamera]->Update(deltaTime);
-
-	// Example input checking: Quit if the escape key is pressed
-	if (Input::GetInstance().KeyDown(VK_ESCAPE))
-		Quit();
-
+	shapeMotion.EndTick();
 }
 
 // --------------------------------------------------------
@@ -762,6 +1065,17 @@ void Game::Update(float deltaTime, float totalTime)
 // --------------------------------------------------------
 void Game::Draw(float deltaTime, float totalTime)
 {
+	// The shapes are drawn part way between their last two ticks,
+	// then everything that moved gets its matrices rebuilt in one
+	// batch, before anything draws
+	shapeMotion.Blend(tickBlend);
+	transformsUpdated = TransformSystem::GetInstance().UpdateMatrices();
+
+	// Only the objects that moved since last frame are sent, and
+	// every vertex shader below reads its matrices from here
+	objectBuffer->Update();
+	objectBuffer->Bind();
+
 	{
 		Microsoft::WRL::ComPtr<ID3D11RasterizerState> shadowRasterizer;
 		D3D11_RASTERIZER_DESC shadowRastDesc = {};
@@ -783,18 +1097,33 @@ void Game::Draw(float deltaTime, float totalTime)
 		viewport.Height = (float)shadowMapResolution;
 		viewport.MaxDepth = 1.0f;
 		context->RSSetViewports(1, &viewport);
-		shadowVS->SetShader();
 		shadowVS->SetMatrix4x4("view", lightViewMatrix);
 		shadowVS->SetMatrix4x4("projection", lightProjectionMatrix);
+		compactShadowVS->SetMatrix4x4("view", lightViewMatrix);
+		compactShadowVS->SetMatrix4x4("projection", lightProjectionMatrix);
+
+		// Meshes share the arena's buffers, so they're only bound
+		// when the pool changes - see GeometryArena.cpp
+		geometryArena->ResetBindings();
+		geometryArena->ResetBindingCount();
 
 		// Loop and draw all entities
 		for (int i = 0; i < 6; i++) {
-			shadowVS->SetMatrix4x4("world", shapes[i]->GetTransform()->GetWorldMatrix());
-			shadowVS->CopyAllBufferData();
+			// Compact meshes need the matching shader and their decode constants
+			std::shared_ptr<Mesh> mesh = shapes[i]->GetMesh();
+			std::shared_ptr<SimpleVertexShader> vs = mesh->HasCompactVertices() ? compactShadowVS : shadowVS;
+			if (mesh->HasCompactVertices()) {
+				CompactPositionDecode decode = mesh->GetPositionDecode();
+				vs->SetFloat3("positionOffset", decode.offset);
+				vs->SetFloat3("positionScale", decode.scale);
+			}
+			vs->SetShader();
+			vs->SetInt("objectIndex", (int)shapes[i]->GetObjectIndex());
+			vs->CopyAllBufferData();
 
-			// Draw the mesh directly to avoid the entity's material
-			// Note: Your code may differ significantly here!
-			shapes[i]->GetMesh()->Draw();
+			// Draw the mesh directly to avoid the entity's material,
+			// reading only its positions
+			mesh->DrawDepthOnly();
 		}
 		viewport.Width = (float)this->windowWidth;
 		viewport.Height = (float)this->windowHeight;
@@ -829,6 +1158,12 @@ void Game::Draw(float deltaTime, float totalTime)
 	XMFLOAT3 ambientColor = XMFLOAT3(0.0f, 0.1f, 0.2f);
 
 	//Drawing shapes -A
+	geometryArena->ResetBindings();
+	trianglesDrawn = 0;
+	trianglesWithoutLods = 0;
+	meshletsDrawn = 0;
+	meshletsTotal = 0;
+	fetchBytesSaved = 0;
 	for (int i = 0; i < 6; i++) {
 		shapes[i]->GetMaterial()->AddTextureSRV(
 			"ShadowMap",
@@ -878,10 +1213,29 @@ void Game::Draw(float deltaTime, float totalTime)
 			ambientColor);
 
 
-		shapes[i]->Draw(context, *camera[activeCamera]);
+		shapes[i]->Draw(context, *camera[activeCamera], useLods, cullMeshlets);
+
+		// Stats for the UI, compared to always drawing all of LOD 0
+		std::shared_ptr<Mesh> mesh = shapes[i]->GetMesh();
+		trianglesDrawn += shapes[i]->GetTrianglesDrawn();
+		trianglesWithoutLods += mesh->GetLodCount() > 0 ? mesh->GetLod(0).indexCount / 3 : 0;
+		meshletsDrawn += shapes[i]->GetMeshletsDrawn();
+		meshletsTotal += mesh->GetMeshletCount();
+		fetchBytesSaved += mesh->GetFetchBytesSaved(shapes[i]->GetTrianglesDrawn() * 3);
 	}
 
+	// The waves bind their own buffers, so the arena has to
+	// bind again for whatever comes next
+	DrawWaves();
+	geometryArena->ResetBindings();
+
 	sky.Draw(camera[activeCamera]);
+	geometryBinds = geometryArena->GetBindCount();
+	waves->EndFrame();
+
+	// Nothing else draws the shapes, so they go back to their last
+	// tick, ready for the next one (and for picking)
+	shapeMotion.Restore();
 
 	//Post render
 	{
@@ -5,10 +5,15 @@
 #include <wrl/client.h> // Used for ComPtr - a smart pointer for COM objects
 #include <memory>
 #include "Mesh.h"
+#include "MeshCache.h"
+#include "DynamicMesh.h"
 #include "ImGui/imgui.h"
 #include "ImGui/imgui_impl_dx11.h"
 #include "ImGui/imgui_impl_win32.h"
 #include "GameEntity.h"
+#include "ObjectBuffer.h"
+#include "TransformInterpolator.h"
+#include "ScenePicker.h"
 #include "Camera.h"
 #include "SimpleShader.h"
 #include "Lights.h"
@@ -29,6 +34,7 @@ public:
 	void Init();
 	void OnResize();
 	void Update(float deltaTime, float totalTime);
+	void FixedUpdate(float tickTime, float totalTime);
 	void Draw(float deltaTime, float totalTime);
 
 private:
@@ -40,6 +46,9 @@ private:
 	void LoadSky();
 	void CreateShadows();
 	void PostProcessSetup();
+	void CreateWaves();
+	void UpdateWaves(float totalTime);
+	void DrawWaves();
 
 	// Note the usage of ComPtr below
 	//  - This is a smart pointer for objects that abide by the
@@ -54,6 +63,9 @@ private:
 	std::shared_ptr<SimplePixelShader> pixelShader;
 	std::shared_ptr<SimpleVertexShader> vertexShader;
 	std::shared_ptr<SimplePixelShader> customShader;
+	//Versions of the vertex and shadow shaders for CompactVertex meshes
+	std::shared_ptr<SimpleVertexShader> compactVertexShader;
+	std::shared_ptr<SimpleVertexShader> compactShadowVS;
 	//Sky shaders
 	std::shared_ptr<SimpleVertexShader> skyVS;
 	std::shared_ptr<SimplePixelShader> skyPS;
@@ -98,19 +110,50 @@ private:
 	std::shared_ptr<Material> mat5;
 	std::shared_ptr<Material> mat6;
 
-	//Variables for shape movement
+	//A grid deformed on the CPU every frame - see DynamicMesh.h
+	std::shared_ptr<DynamicMesh> waves;
+	std::shared_ptr<Material> waveMaterial;
+	std::shared_ptr<Transform> waveTransform;
+	unsigned int waveObjectIndex = 0;
+
+	//Variables for shape movement, which happens in fixed ticks and is
+	//blended between the last two for drawing
 	bool going = true;
-	int counter = 0;
+	float swingTime = 0.0f;
+	TransformInterpolator shapeMotion;
 
 	std::shared_ptr<Camera> camera[3];
 	int activeCamera = 0;
 
+	//Click-to-pick over every shape - see ScenePicker.h
+	ScenePicker picker;
+	int selectedShape = -1;
+	bool selectionChanged = false;
+	bool pickPressed = false;
+	int pickPressX = 0;
+	int pickPressY = 0;
+	float pickTime = 0.0f;
+
+	//How many transforms the last batched rebuild touched - see TransformSystem.h
+	unsigned int transformsUpdated = 0;
+
+	//Every drawn object's matrices, kept on the GPU and only sent again
+	//when they change - see ObjectBuffer.h
+	std::shared_ptr<ObjectBuffer> objectBuffer;
+
 	Light directionalLight1;
 	Light directionalLight2;
 	Light directionalLight3;
 	Light pointLight1;
 	Light pointLight2;
 
+	//Every model file is loaded through here, so repeats share one Mesh,
+	//and every mesh lives in the arena's shared buffers
+	std::shared_ptr<GeometryArena> geometryArena;
+	std::shared_ptr<MeshCache> meshCache;
+	unsigned int geometryBinds = 0;
+	std::string arenaReport;
+
 	//Skybox Variables
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srvSky;
@@ -131,4 +174,19 @@ private:
 	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> ppRTV; // For rendering
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> ppSRV; // For sampling
 	int blurAmount;
+
+	//Text output of the last benchmark that was run
+	std::string benchmarkReport;
+
+	//How long CreateGeometry() took at startup
+	float geometryLoadTime = 0.0f;
+
+	//Level of detail and meshlet culling toggles, and what the last frame submitted
+	bool useLods = true;
+	bool cullMeshlets = true;
+	unsigned int trianglesDrawn = 0;
+	unsigned int trianglesWithoutLods = 0;
+	unsigned int meshletsDrawn = 0;
+	unsigned int meshletsTotal = 0;
+	unsigned int fetchBytesSaved = 0;
 };
\ No newline at end of file
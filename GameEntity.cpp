@@ -1,11 +1,35 @@
 #include "GameEntity.h"
 
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// Fraction of the screen's height a mesh's bounding sphere
+	// covers when it first drops below LOD 0.  Coarser LODs take
+	// over in proportion to the square root of their triangle
+	// counts, which keeps triangles per pixel roughly constant.
+	const float lodFullDetailScreenSize = 0.5f;
+
+	// How far past a switch point the size has to move before
+	// the LOD actually changes, so it doesn't flicker back and
+	// forth when an object sits right at the boundary
+	const float lodHysteresis = 0.15f;
+}
+
 GameEntity::GameEntity(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material)
 {
 	this->mesh = mesh;
 	this->material = material;
-	this->mesh->SetTint(material->GetTint().x, material->GetTint().y, material->GetTint().z, material->GetTint().w);
+	this->tint = material->GetTint();
 	this->transform = std::make_shared<Transform>();
+	this->objectIndex = 0;
+	this->currentLod = 0;
+	this->trianglesDrawn = 0;
+	this->meshletsDrawn = 0;
+	this->worldBoundsVersion = 0;
 }
 
 GameEntity::~GameEntity()
@@ -32,27 +56,157 @@ void GameEntity::SetMaterial(std::shared_ptr<Material> newMat)
 	this->material = newMat;
 }
 
+MeshBounds GameEntity::GetWorldBounds()
+{
+	unsigned int version = transform->GetVersion();
+	if (version != worldBoundsVersion)
+	{
+		worldBounds = TransformBounds(mesh->GetBounds(), transform->GetWorldMatrix());
+		worldBoundsVersion = version;
+	}
+	return worldBounds;
+}
+
+void GameEntity::SetObjectIndex(unsigned int index)
+{
+	objectIndex = index;
+}
+
+unsigned int GameEntity::GetObjectIndex()
+{
+	return objectIndex;
+}
+
+void GameEntity::SetTint(float r, float g, float b, float a)
+{
+	tint = XMFLOAT4(r, g, b, a);
+}
+
+XMFLOAT4 GameEntity::GetTint()
+{
+	return tint;
+}
+
+unsigned int GameEntity::GetCurrentLod()
+{
+	return currentLod;
+}
+
+unsigned int GameEntity::GetTrianglesDrawn()
+{
+	return trianglesDrawn;
+}
+
+unsigned int GameEntity::GetMeshletsDrawn()
+{
+	return meshletsDrawn;
+}
+
+// --------------------------------------------------------
+// Picks a level of detail from how much of the screen the
+// mesh's bounding sphere covers, starting from the current
+// LOD so the hysteresis has something to stick to
+// --------------------------------------------------------
+unsigned int GameEntity::SelectLod(Camera& camera)
+{
+	unsigned int lodCount = mesh->GetLodCount();
+	if (lodCount <= 1)
+		return 0;
+
+	// Bounding sphere in world space
+	MeshBounds bounds = GetWorldBounds();
+	XMVECTOR center = XMLoadFloat3(&bounds.sphereCenter);
+	float radius = bounds.sphereRadius;
+
+	// Fraction of the screen's height the sphere covers
+	XMFLOAT3 cameraPosition = camera.GetTransform()->GetPosition();
+	float distance = XMVectorGetX(XMVector3Length(center - XMLoadFloat3(&cameraPosition)));
+	float screenSize = distance > radius ?
+		radius / (distance * tanf(camera.GetFov() * 0.5f)) :
+		1.0f;
+
+	// Screen size below which "lod" replaces the LOD before it
+	float fullDetailIndices = (float)mesh->GetLod(0).indexCount;
+	auto switchSize = [&](unsigned int lod)
+	{
+		return lodFullDetailScreenSize * sqrtf(mesh->GetLod(lod).indexCount / fullDetailIndices);
+	};
+
+	unsigned int lod = std::min(currentLod, lodCount - 1);
+	while (lod + 1 < lodCount && screenSize < switchSize(lod + 1) * (1.0f - lodHysteresis))
+		lod++;
+	while (lod > 0 && screenSize > switchSize(lod) * (1.0f + lodHysteresis))
+		lod--;
+	return lod;
+}
+
 void GameEntity::Draw(
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
-	Camera camera)
+	Camera& camera,
+	bool useLods,
+	bool cullMeshlets)
 {
+	// A mesh that failed to load has nothing to draw
+	if (mesh->GetLodCount() == 0)
+	{
+		currentLod = 0;
+		trianglesDrawn = 0;
+		meshletsDrawn = 0;
+		return;
+	}
+
 	material->GetVertexShader()->SetShader();
 	material->GetPixelShader()->SetShader();
 
 
 	std::shared_ptr<SimpleVertexShader> vs = material->GetVertexShader();
-	vs->SetMatrix4x4("world", transform->GetWorldMatrix());
 	vs->SetMatrix4x4("view", camera.GetView());
 	vs->SetMatrix4x4("projection", camera.GetProjection());
-	vs->SetMatrix4x4("worldInvTranspose", GetTransform()->GetWorldInverseTransposeMatrix());
+
+	// The matrices themselves are already in the object buffer
+	vs->SetInt("objectIndex", (int)objectIndex);
+
+	// Compact meshes need a material with a compact vertex shader,
+	// which turns their quantized positions back into local ones
+	if (mesh->HasCompactVertices())
+	{
+		CompactPositionDecode decode = mesh->GetPositionDecode();
+		vs->SetFloat3("positionOffset", decode.offset);
+		vs->SetFloat3("positionScale", decode.scale);
+	}
 
 	std::shared_ptr<SimplePixelShader> ps = material->GetPixelShader();
-	ps->SetFloat4("colorTint", mesh->GetTint());
+	ps->SetFloat4("colorTint", tint);
 	ps->SetFloat3("cameraPos", camera.GetTransform()->GetPosition());
 	ps->SetFloat("roughness", material->GetRoughness());
 
 	vs->CopyAllBufferData();
 	ps->CopyAllBufferData();
 
-	mesh->Draw();
+	currentLod = useLods ? SelectLod(camera) : 0;
+
+	// Only LOD 0 is clustered, and a mesh that's a single
+	// meshlet is already covered by any object-level test
+	unsigned int meshletCount = mesh->GetMeshletCount();
+	if (cullMeshlets && currentLod == 0 && meshletCount > 1)
+	{
+		meshletsDrawn = (unsigned int)CullMeshlets(
+			mesh->GetMeshlets(),
+			meshletCount,
+			transform->GetWorldMatrix(),
+			camera.GetView(),
+			camera.GetProjection(),
+			visibleRanges);
+
+		trianglesDrawn = 0;
+		for (const MeshletDrawRange& range : visibleRanges)
+			trianglesDrawn += range.indexCount / 3;
+
+		mesh->DrawRanges(visibleRanges);
+		return;
+	}
+
+	meshletsDrawn = currentLod == 0 ? meshletCount : 0;
+	trianglesDrawn = mesh->GetLod(currentLod).indexCount / 3;
+	mesh->Draw(currentLod);
 }
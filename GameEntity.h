@@ -17,13 +17,45 @@ public:
 	std::shared_ptr<Transform> GetTransform();
 	std::shared_ptr<Material> GetMaterial();
 	void SetMaterial(std::shared_ptr<Material> newMat);
+
+	// Where the entity's matrices live in the renderer's ObjectBuffer,
+	// which Draw() passes to the vertex shader
+	void SetObjectIndex(unsigned int index);
+	unsigned int GetObjectIndex();
+
+	// Per-entity color, since meshes can be shared
+	void SetTint(float r, float g, float b, float a);
+	DirectX::XMFLOAT4 GetTint();
 	void Draw(
 		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
-		Camera camera);
+		Camera& camera,
+		bool useLods = true,
+		bool cullMeshlets = true);
+
+	// The mesh's bounds moved into world space, which are only
+	// recalculated after the transform changes
+	MeshBounds GetWorldBounds();
+
+	// The level of detail picked by the last Draw()
+	unsigned int GetCurrentLod();
+
+	// What the last Draw() actually submitted
+	unsigned int GetTrianglesDrawn();
+	unsigned int GetMeshletsDrawn();
 
 private:
+	unsigned int SelectLod(Camera& camera);
+
 	std::shared_ptr<Transform> transform;
 	std::shared_ptr<Mesh> mesh;
 	std::shared_ptr<Material> material;
+	DirectX::XMFLOAT4 tint;
+	unsigned int objectIndex;
+	unsigned int currentLod;
+	unsigned int trianglesDrawn;
+	unsigned int meshletsDrawn;
+	std::vector<MeshletDrawRange> visibleRanges;
+	MeshBounds worldBounds;
+	unsigned int worldBoundsVersion;
 };
 
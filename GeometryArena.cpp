@@ -0,0 +1,497 @@
+#include "GeometryArena.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+	const unsigned int noPool = 0xFFFFFFFF;
+
+	// --------------------------------------------------------
+	// A default usage buffer, so it can be filled a piece at a
+	// time with UpdateSubresource() and copied on the GPU
+	// --------------------------------------------------------
+	Microsoft::WRL::ComPtr<ID3D11Buffer> CreateArenaBuffer(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		unsigned int byteWidth,
+		unsigned int bindFlags)
+	{
+		D3D11_BUFFER_DESC desc = {};
+		desc.Usage = D3D11_USAGE_DEFAULT;
+		desc.ByteWidth = byteWidth;
+		desc.BindFlags = bindFlags;
+		desc.CPUAccessFlags = 0;
+		desc.MiscFlags = 0;
+		desc.StructureByteStride = 0;
+
+		Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+		device->CreateBuffer(&desc, 0, buffer.GetAddressOf());
+		return buffer;
+	}
+
+	D3D11_BOX ByteRange(unsigned int start, unsigned int bytes)
+	{
+		D3D11_BOX box = {};
+		box.left = start;
+		box.right = start + bytes;
+		box.top = 0;
+		box.bottom = 1;
+		box.front = 0;
+		box.back = 1;
+		return box;
+	}
+
+	void UploadRange(
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		ID3D11Buffer* buffer,
+		unsigned int start,
+		unsigned int bytes,
+		const void* data)
+	{
+		if (!buffer || bytes == 0)
+			return;
+
+		D3D11_BOX box = ByteRange(start, bytes);
+		context->UpdateSubresource(buffer, 0, &box, data, 0, 0);
+	}
+
+	void CopyRange(
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		ID3D11Buffer* destination,
+		unsigned int destinationStart,
+		ID3D11Buffer* source,
+		unsigned int sourceStart,
+		unsigned int bytes)
+	{
+		if (!destination || !source || bytes == 0)
+			return;
+
+		D3D11_BOX box = ByteRange(sourceStart, bytes);
+		context->CopySubresourceRegion(destination, 0, destinationStart, 0, 0, source, 0, &box);
+	}
+}
+
+ArenaAllocator::ArenaAllocator(unsigned int capacity)
+	:
+	capacity(0),
+	used(0)
+{
+	Grow(capacity);
+}
+
+// --------------------------------------------------------
+// Takes the front of the smallest block that fits, which
+// keeps big blocks whole for big meshes
+// --------------------------------------------------------
+unsigned int ArenaAllocator::Allocate(unsigned int size)
+{
+	if (size == 0)
+		return 0;
+
+	size_t best = freeBlocks.size();
+	for (size_t i = 0; i < freeBlocks.size(); i++)
+	{
+		if (freeBlocks[i].size >= size &&
+			(best == freeBlocks.size() || freeBlocks[i].size < freeBlocks[best].size))
+			best = i;
+	}
+	if (best == freeBlocks.size())
+		return invalidOffset;
+
+	unsigned int offset = freeBlocks[best].offset;
+	freeBlocks[best].offset += size;
+	freeBlocks[best].size -= size;
+	if (freeBlocks[best].size == 0)
+		freeBlocks.erase(freeBlocks.begin() + best);
+
+	used += size;
+	return offset;
+}
+
+void ArenaAllocator::Free(unsigned int offset, unsigned int size)
+{
+	if (size == 0)
+		return;
+
+	// Find its place in offset order, then merge with whichever
+	// neighbors it touches
+	size_t i = 0;
+	while (i < freeBlocks.size() && freeBlocks[i].offset < offset)
+		i++;
+
+	Block block = { offset, size };
+	freeBlocks.insert(freeBlocks.begin() + i, block);
+
+	if (i + 1 < freeBlocks.size() && freeBlocks[i].offset + freeBlocks[i].size == freeBlocks[i + 1].offset)
+	{
+		freeBlocks[i].size += freeBlocks[i + 1].size;
+		freeBlocks.erase(freeBlocks.begin() + i + 1);
+	}
+	if (i > 0 && freeBlocks[i - 1].offset + freeBlocks[i - 1].size == freeBlocks[i].offset)
+	{
+		freeBlocks[i - 1].size += freeBlocks[i].size;
+		freeBlocks.erase(freeBlocks.begin() + i);
+	}
+
+	used -= size;
+}
+
+void ArenaAllocator::Grow(unsigned int newCapacity)
+{
+	if (newCapacity <= capacity)
+		return;
+
+	if (!freeBlocks.empty() && freeBlocks.back().offset + freeBlocks.back().size == capacity)
+	{
+		freeBlocks.back().size += newCapacity - capacity;
+	}
+	else
+	{
+		Block block = { capacity, newCapacity - capacity };
+		freeBlocks.push_back(block);
+	}
+	capacity = newCapacity;
+}
+
+void ArenaAllocator::Reset(unsigned int used)
+{
+	this->used = used;
+	freeBlocks.clear();
+	if (used < capacity)
+	{
+		Block block = { used, capacity - used };
+		freeBlocks.push_back(block);
+	}
+}
+
+unsigned int ArenaAllocator::GetCapacity()
+{
+	return capacity;
+}
+
+unsigned int ArenaAllocator::GetUsed()
+{
+	return used;
+}
+
+unsigned int ArenaAllocator::GetFreeBlockCount()
+{
+	return (unsigned int)freeBlocks.size();
+}
+
+unsigned int ArenaAllocator::GetLargestFreeBlock()
+{
+	unsigned int largest = 0;
+	for (const Block& block : freeBlocks)
+		largest = std::max(largest, block.size);
+	return largest;
+}
+
+bool ArenaAllocator::IsPacked()
+{
+	return freeBlocks.empty() ||
+		(freeBlocks.size() == 1 && freeBlocks[0].offset + freeBlocks[0].size == capacity);
+}
+
+float ArenaAllocator::GetFragmentation()
+{
+	unsigned int free = capacity - used;
+	if (free == 0)
+		return 0.0f;
+	return 1.0f - (float)GetLargestFreeBlock() / free;
+}
+
+GeometryArena::GeometryArena(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	unsigned int initialVertexCapacity,
+	unsigned int initialIndexCapacity)
+	:
+	device(device),
+	context(context),
+	initialVertexCapacity(initialVertexCapacity),
+	initialIndexCapacity(initialIndexCapacity),
+	boundPool(noPool),
+	boundDepthOnly(false),
+	bindCount(0)
+{
+}
+
+// --------------------------------------------------------
+// Finds space for a mesh (growing its pool if it has to) and
+// copies the mesh's data in
+// --------------------------------------------------------
+std::shared_ptr<GeometryAllocation> GeometryArena::Allocate(
+	const void* vertices,
+	unsigned int vertexStride,
+	const void* positions,
+	unsigned int positionStride,
+	unsigned int vertexCount,
+	const void* indices,
+	DXGI_FORMAT indexFormat,
+	unsigned int indexCount)
+{
+	if (!positions)
+		positionStride = 0;
+
+	unsigned int poolIndex = FindPool(vertexStride, positionStride, indexFormat);
+	Pool& pool = pools[poolIndex];
+
+	unsigned int vertexOffset = pool.vertices.Allocate(vertexCount);
+	if (vertexOffset == ArenaAllocator::invalidOffset)
+	{
+		unsigned int capacity = pool.vertices.GetCapacity();
+		GrowVertices(pool, std::max(capacity * 2, capacity + vertexCount));
+		vertexOffset = pool.vertices.Allocate(vertexCount);
+	}
+
+	unsigned int indexOffset = pool.indices.Allocate(indexCount);
+	if (indexOffset == ArenaAllocator::invalidOffset)
+	{
+		unsigned int capacity = pool.indices.GetCapacity();
+		GrowIndices(pool, std::max(capacity * 2, capacity + indexCount));
+		indexOffset = pool.indices.Allocate(indexCount);
+	}
+
+	UploadRange(context, pool.vertexBuffer.Get(), vertexOffset * vertexStride, vertexCount * vertexStride, vertices);
+	UploadRange(context, pool.positionBuffer.Get(), vertexOffset * positionStride, vertexCount * positionStride, positions);
+	UploadRange(context, pool.indexBuffer.Get(), indexOffset * pool.indexSize, indexCount * pool.indexSize, indices);
+
+	std::shared_ptr<GeometryAllocation> allocation = std::make_shared<GeometryAllocation>();
+	allocation->pool = poolIndex;
+	allocation->vertexOffset = vertexOffset;
+	allocation->vertexCount = vertexCount;
+	allocation->indexOffset = indexOffset;
+	allocation->indexCount = indexCount;
+	pool.allocations.push_back(allocation);
+	return allocation;
+}
+
+void GeometryArena::Free(std::shared_ptr<GeometryAllocation> allocation)
+{
+	if (!allocation || allocation->pool >= pools.size())
+		return;
+
+	Pool& pool = pools[allocation->pool];
+	auto it = std::find(pool.allocations.begin(), pool.allocations.end(), allocation);
+	if (it == pool.allocations.end())
+		return;
+
+	pool.vertices.Free(allocation->vertexOffset, allocation->vertexCount);
+	pool.indices.Free(allocation->indexOffset, allocation->indexCount);
+	pool.allocations.erase(it);
+}
+
+void GeometryArena::Bind(const GeometryAllocation& allocation, bool depthOnly)
+{
+	if (allocation.pool == boundPool && depthOnly == boundDepthOnly)
+		return;
+
+	Pool& pool = pools[allocation.pool];
+	UINT offset = 0;
+	if (depthOnly && pool.positionBuffer)
+		context->IASetVertexBuffers(0, 1, pool.positionBuffer.GetAddressOf(), &pool.positionStride, &offset);
+	else
+		context->IASetVertexBuffers(0, 1, pool.vertexBuffer.GetAddressOf(), &pool.vertexStride, &offset);
+	context->IASetIndexBuffer(pool.indexBuffer.Get(), pool.indexFormat, 0);
+
+	boundPool = allocation.pool;
+	boundDepthOnly = depthOnly;
+	bindCount++;
+}
+
+void GeometryArena::ResetBindings()
+{
+	boundPool = noPool;
+}
+
+// --------------------------------------------------------
+// Vertices and indices are packed separately, each in the
+// order they already sit in, so a mesh never moves up
+// - Indices are relative to the mesh's baseVertex, so moving
+//   vertices doesn't touch the index data
+// - Everything is copied into new buffers, since copies
+//   within one buffer can't overlap
+// --------------------------------------------------------
+unsigned long long GeometryArena::Compact()
+{
+	unsigned long long bytesCopied = 0;
+	for (Pool& pool : pools)
+	{
+		std::vector<GeometryAllocation*> sorted;
+		for (auto& allocation : pool.allocations)
+			sorted.push_back(allocation.get());
+
+		// Vertices
+		std::sort(sorted.begin(), sorted.end(),
+			[](GeometryAllocation* a, GeometryAllocation* b) { return a->vertexOffset < b->vertexOffset; });
+
+		unsigned int packed = 0;
+		if (!pool.vertices.IsPacked())
+		{
+			unsigned int capacity = pool.vertices.GetCapacity();
+			Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer =
+				CreateArenaBuffer(device, capacity * pool.vertexStride, D3D11_BIND_VERTEX_BUFFER);
+			Microsoft::WRL::ComPtr<ID3D11Buffer> positionBuffer;
+			if (pool.positionStride > 0)
+				positionBuffer = CreateArenaBuffer(device, capacity * pool.positionStride, D3D11_BIND_VERTEX_BUFFER);
+
+			packed = 0;
+			for (GeometryAllocation* allocation : sorted)
+			{
+				CopyRange(context, vertexBuffer.Get(), packed * pool.vertexStride,
+					pool.vertexBuffer.Get(), allocation->vertexOffset * pool.vertexStride,
+					allocation->vertexCount * pool.vertexStride);
+				CopyRange(context, positionBuffer.Get(), packed * pool.positionStride,
+					pool.positionBuffer.Get(), allocation->vertexOffset * pool.positionStride,
+					allocation->vertexCount * pool.positionStride);
+				bytesCopied += (unsigned long long)allocation->vertexCount * (pool.vertexStride + pool.positionStride);
+
+				allocation->vertexOffset = packed;
+				packed += allocation->vertexCount;
+			}
+			pool.vertexBuffer = vertexBuffer;
+			pool.positionBuffer = positionBuffer;
+			pool.vertices.Reset(packed);
+		}
+
+		// Indices
+		std::sort(sorted.begin(), sorted.end(),
+			[](GeometryAllocation* a, GeometryAllocation* b) { return a->indexOffset < b->indexOffset; });
+
+		if (!pool.indices.IsPacked())
+		{
+			unsigned int capacity = pool.indices.GetCapacity();
+			Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer =
+				CreateArenaBuffer(device, capacity * pool.indexSize, D3D11_BIND_INDEX_BUFFER);
+
+			packed = 0;
+			for (GeometryAllocation* allocation : sorted)
+			{
+				CopyRange(context, indexBuffer.Get(), packed * pool.indexSize,
+					pool.indexBuffer.Get(), allocation->indexOffset * pool.indexSize,
+					allocation->indexCount * pool.indexSize);
+				bytesCopied += (unsigned long long)allocation->indexCount * pool.indexSize;
+
+				allocation->indexOffset = packed;
+				packed += allocation->indexCount;
+			}
+			pool.indexBuffer = indexBuffer;
+			pool.indices.Reset(packed);
+		}
+	}
+
+	ResetBindings();
+	return bytesCopied;
+}
+
+unsigned int GeometryArena::GetBindCount()
+{
+	return bindCount;
+}
+
+void GeometryArena::ResetBindingCount()
+{
+	bindCount = 0;
+}
+
+std::string GeometryArena::GetReport()
+{
+	std::string report;
+	char line[512];
+	unsigned long long usedBytes = 0;
+	unsigned long long capacityBytes = 0;
+	for (size_t i = 0; i < pools.size(); i++)
+	{
+		Pool& pool = pools[i];
+		sprintf_s(line, "Pool %zu: %u+%u byte vertices, %u byte indices, %zu meshes\n",
+			i,
+			pool.vertexStride,
+			pool.positionStride,
+			pool.indexSize,
+			pool.allocations.size());
+		report += line;
+
+		ArenaAllocator* allocators[2] = { &pool.vertices, &pool.indices };
+		const char* names[2] = { "vertices", "indices " };
+		for (int a = 0; a < 2; a++)
+		{
+			sprintf_s(line, "  %s %8u of %8u used, %3u holes, largest %8u, %5.1f%% fragmented\n",
+				names[a],
+				allocators[a]->GetUsed(),
+				allocators[a]->GetCapacity(),
+				allocators[a]->GetFreeBlockCount(),
+				allocators[a]->GetLargestFreeBlock(),
+				allocators[a]->GetFragmentation() * 100.0f);
+			report += line;
+		}
+
+		unsigned int vertexSize = pool.vertexStride + pool.positionStride;
+		usedBytes += (unsigned long long)pool.vertices.GetUsed() * vertexSize + (unsigned long long)pool.indices.GetUsed() * pool.indexSize;
+		capacityBytes += (unsigned long long)pool.vertices.GetCapacity() * vertexSize + (unsigned long long)pool.indices.GetCapacity() * pool.indexSize;
+	}
+
+	sprintf_s(line, "%.1f KB of %.1f KB used", usedBytes / 1024.0, capacityBytes / 1024.0);
+	report += line;
+	return report;
+}
+
+// --------------------------------------------------------
+// Returns the pool for these formats, making an empty one if
+// there isn't one yet
+// --------------------------------------------------------
+unsigned int GeometryArena::FindPool(unsigned int vertexStride, unsigned int positionStride, DXGI_FORMAT indexFormat)
+{
+	for (size_t i = 0; i < pools.size(); i++)
+	{
+		if (pools[i].vertexStride == vertexStride &&
+			pools[i].positionStride == positionStride &&
+			pools[i].indexFormat == indexFormat)
+			return (unsigned int)i;
+	}
+
+	Pool pool;
+	pool.vertexStride = vertexStride;
+	pool.positionStride = positionStride;
+	pool.indexFormat = indexFormat;
+	pool.indexSize = indexFormat == DXGI_FORMAT_R16_UINT ? sizeof(unsigned short) : sizeof(unsigned int);
+	pools.push_back(pool);
+
+	GrowVertices(pools.back(), initialVertexCapacity);
+	GrowIndices(pools.back(), initialIndexCapacity);
+	return (unsigned int)pools.size() - 1;
+}
+
+void GeometryArena::GrowVertices(Pool& pool, unsigned int capacity)
+{
+	unsigned int oldCapacity = pool.vertices.GetCapacity();
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer =
+		CreateArenaBuffer(device, capacity * pool.vertexStride, D3D11_BIND_VERTEX_BUFFER);
+	CopyRange(context, vertexBuffer.Get(), 0, pool.vertexBuffer.Get(), 0, oldCapacity * pool.vertexStride);
+	pool.vertexBuffer = vertexBuffer;
+
+	if (pool.positionStride > 0)
+	{
+		Microsoft::WRL::ComPtr<ID3D11Buffer> positionBuffer =
+			CreateArenaBuffer(device, capacity * pool.positionStride, D3D11_BIND_VERTEX_BUFFER);
+		CopyRange(context, positionBuffer.Get(), 0, pool.positionBuffer.Get(), 0, oldCapacity * pool.positionStride);
+		pool.positionBuffer = positionBuffer;
+	}
+
+	pool.vertices.Grow(capacity);
+	ResetBindings();
+}
+
+void GeometryArena::GrowIndices(Pool& pool, unsigned int capacity)
+{
+	unsigned int oldCapacity = pool.indices.GetCapacity();
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer =
+		CreateArenaBuffer(device, capacity * pool.indexSize, D3D11_BIND_INDEX_BUFFER);
+	CopyRange(context, indexBuffer.Get(), 0, pool.indexBuffer.Get(), 0, oldCapacity * pool.indexSize);
+	pool.indexBuffer = indexBuffer;
+
+	pool.indices.Grow(capacity);
+	ResetBindings();
+}
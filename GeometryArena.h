@@ -0,0 +1,159 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <d3d11.h>
+#include <wrl/client.h>
+
+// --------------------------------------------------------
+// A best fit free list over a range of elements (vertices or
+// indices), with no GPU resources of its own
+//
+// - Neighboring free blocks are merged when freed, so the
+//   list only holds the real holes
+// - Offsets and sizes are in elements, not bytes
+// --------------------------------------------------------
+class ArenaAllocator
+{
+public:
+	static const unsigned int invalidOffset = 0xFFFFFFFF;
+
+	ArenaAllocator(unsigned int capacity = 0);
+
+	// Returns invalidOffset when no free block is big enough
+	unsigned int Allocate(unsigned int size);
+	void Free(unsigned int offset, unsigned int size);
+
+	// Adds free space to the end
+	void Grow(unsigned int newCapacity);
+
+	// After compaction: the first "used" elements are allocated
+	// and everything after them is one free block
+	void Reset(unsigned int used);
+
+	unsigned int GetCapacity();
+	unsigned int GetUsed();
+	unsigned int GetFreeBlockCount();
+	unsigned int GetLargestFreeBlock();
+
+	// True when all the free space is one block at the end
+	bool IsPacked();
+
+	// 0 when all free space is one block, approaching 1 as it's
+	// split into many small holes
+	float GetFragmentation();
+
+private:
+	struct Block
+	{
+		unsigned int offset;
+		unsigned int size;
+	};
+
+	std::vector<Block> freeBlocks;	// Sorted by offset
+	unsigned int capacity;
+	unsigned int used;
+};
+
+// --------------------------------------------------------
+// Where one mesh lives in the arena
+// - The offsets change when the arena is compacted, so read
+//   them at draw time rather than keeping copies
+// --------------------------------------------------------
+struct GeometryAllocation
+{
+	unsigned int pool;
+	unsigned int vertexOffset;	// The baseVertex for DrawIndexed()
+	unsigned int vertexCount;
+	unsigned int indexOffset;	// Added to each draw's start index
+	unsigned int indexCount;
+};
+
+// --------------------------------------------------------
+// Packs static meshes into a few large vertex and index
+// buffers, so the input assembler is bound once per pass
+// instead of once per mesh
+//
+// - Meshes with the same vertex stride, position stream and
+//   index format share a pool of buffers
+// - Each mesh's indices stay relative to its own vertices and
+//   it draws with a baseVertex, so 16 bit indices still work
+// - Pools double in size when they fill up, copying their
+//   contents on the GPU
+// - Freeing leaves holes; Compact() closes them by copying the
+//   live meshes down into fresh buffers
+// --------------------------------------------------------
+class GeometryArena
+{
+public:
+	GeometryArena(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		unsigned int initialVertexCapacity = 256 * 1024,
+		unsigned int initialIndexCapacity = 1024 * 1024);
+
+	// Copies a mesh's data into the pool matching its formats
+	// - positions may be null, which puts it in a pool without
+	//   a position stream
+	std::shared_ptr<GeometryAllocation> Allocate(
+		const void* vertices,
+		unsigned int vertexStride,
+		const void* positions,
+		unsigned int positionStride,
+		unsigned int vertexCount,
+		const void* indices,
+		DXGI_FORMAT indexFormat,
+		unsigned int indexCount);
+	void Free(std::shared_ptr<GeometryAllocation> allocation);
+
+	// Binds an allocation's pool, skipping the calls if it's
+	// already bound
+	// - depthOnly picks the position stream if the pool has one
+	void Bind(const GeometryAllocation& allocation, bool depthOnly);
+
+	// Forgets what's bound - call at the start of each pass, and
+	// after anything else binds vertex or index buffers
+	void ResetBindings();
+
+	// Moves every live mesh down to close the holes, and
+	// returns the number of bytes copied
+	unsigned long long Compact();
+
+	// Bind calls that actually reached the context since the
+	// last ResetBindingCount()
+	unsigned int GetBindCount();
+	void ResetBindingCount();
+
+	// One line per pool with its usage and fragmentation
+	std::string GetReport();
+
+private:
+	struct Pool
+	{
+		unsigned int vertexStride;
+		unsigned int positionStride;	// 0 without a position stream
+		DXGI_FORMAT indexFormat;
+		unsigned int indexSize;
+
+		Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
+		Microsoft::WRL::ComPtr<ID3D11Buffer> positionBuffer;
+		Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
+		ArenaAllocator vertices;
+		ArenaAllocator indices;
+		std::vector<std::shared_ptr<GeometryAllocation>> allocations;
+	};
+
+	unsigned int FindPool(unsigned int vertexStride, unsigned int positionStride, DXGI_FORMAT indexFormat);
+	void GrowVertices(Pool& pool, unsigned int capacity);
+	void GrowIndices(Pool& pool, unsigned int capacity);
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	unsigned int initialVertexCapacity;
+	unsigned int initialIndexCapacity;
+	std::vector<Pool> pools;
+
+	unsigned int boundPool;
+	bool boundDepthOnly;
+	unsigned int bindCount;
+};
@@ -0,0 +1,624 @@
+#include "GltfLoader.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cwctype>
+#include <string>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// A .glb is a 12 byte header followed by chunks: a JSON chunk
+// describing the scene, then a binary chunk with the raw
+// vertex and index data.
+//
+// The JSON is small, so it's parsed into a simple tree.  The
+// binary chunk is never parsed at all: accessors say where
+// each attribute sits and in what format, and the data is
+// copied straight from the mapped file into the vertices.
+// Only the Z flip, the winding flip and any format that isn't
+// already a float (or a 32 bit index) need per-element work.
+// --------------------------------------------------------
+
+namespace
+{
+	const uint32_t glbMagic = 0x46546C67;		// "glTF"
+	const uint32_t glbChunkJson = 0x4E4F534A;	// "JSON"
+	const uint32_t glbChunkBinary = 0x004E4942;	// "BIN\0"
+
+	// Accessor component types
+	const int componentUnsignedByte = 5121;
+	const int componentUnsignedShort = 5123;
+	const int componentUnsignedInt = 5125;
+	const int componentFloat = 5126;
+
+	// Primitive mode for a triangle list
+	const int modeTriangles = 4;
+
+	// Where each output corner of a triangle comes from, which
+	// flips the winding order
+	const size_t flippedCorners[3] = { 0, 2, 1 };
+
+	// Keeps hostile files from recursing off the stack
+	const int jsonMaxDepth = 64;
+
+	// --------------------------------------------------------
+	// A parsed JSON value
+	// --------------------------------------------------------
+	struct JsonValue
+	{
+		enum Type { Null, Bool, Number, String, Array, Object };
+
+		Type type = Null;
+		bool boolean = false;
+		double number = 0;
+		std::string string;
+		std::vector<JsonValue> elements;	// Array elements or object values
+		std::vector<std::string> keys;		// Object keys, matching elements
+
+		const JsonValue* Find(const char* key) const
+		{
+			if (type != Object)
+				return 0;
+			for (size_t i = 0; i < keys.size(); i++)
+			{
+				if (keys[i] == key)
+					return &elements[i];
+			}
+			return 0;
+		}
+
+		// A member that's a number, or the fallback if it's missing
+		double GetNumber(const char* key, double fallback) const
+		{
+			const JsonValue* value = Find(key);
+			return value && value->type == Number ? value->number : fallback;
+		}
+
+		// An array member's element, or null
+		const JsonValue* GetElement(const char* key, double index) const
+		{
+			const JsonValue* array = Find(key);
+			if (!array || array->type != Array || index < 0 || index >= array->elements.size())
+				return 0;
+			return &array->elements[(size_t)index];
+		}
+	};
+
+	// --------------------------------------------------------
+	// Recursive descent JSON parser over text that need not be
+	// null terminated
+	// --------------------------------------------------------
+	class JsonParser
+	{
+	public:
+		JsonParser(const char* data, size_t size) : p(data), end(data + size) {}
+
+		bool Parse(JsonValue& out)
+		{
+			return ParseValue(out, 0);
+		}
+
+	private:
+		const char* p;
+		const char* end;
+
+		void SkipWhitespace()
+		{
+			while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+				p++;
+		}
+
+		bool Match(const char* literal)
+		{
+			size_t length = strlen(literal);
+			if ((size_t)(end - p) < length || memcmp(p, literal, length) != 0)
+				return false;
+			p += length;
+			return true;
+		}
+
+		bool ParseValue(JsonValue& out, int depth)
+		{
+			if (depth > jsonMaxDepth)
+				return false;
+
+			SkipWhitespace();
+			if (p >= end)
+				return false;
+
+			switch (*p)
+			{
+			case '{': return ParseObject(out, depth);
+			case '[': return ParseArray(out, depth);
+			case '"': out.type = JsonValue::String; return ParseString(out.string);
+			case 't': out.type = JsonValue::Bool; out.boolean = true; return Match("true");
+			case 'f': out.type = JsonValue::Bool; out.boolean = false; return Match("false");
+			case 'n': out.type = JsonValue::Null; return Match("null");
+			default: out.type = JsonValue::Number; return ParseNumber(out.number);
+			}
+		}
+
+		bool ParseObject(JsonValue& out, int depth)
+		{
+			out.type = JsonValue::Object;
+			p++;
+			SkipWhitespace();
+			if (p < end && *p == '}')
+			{
+				p++;
+				return true;
+			}
+
+			while (p < end)
+			{
+				SkipWhitespace();
+				std::string key;
+				if (p >= end || *p != '"' || !ParseString(key))
+					return false;
+
+				SkipWhitespace();
+				if (p >= end || *p != ':')
+					return false;
+				p++;
+
+				out.keys.push_back(key);
+				out.elements.push_back(JsonValue());
+				if (!ParseValue(out.elements.back(), depth + 1))
+					return false;
+
+				SkipWhitespace();
+				if (p < end && *p == ',')
+				{
+					p++;
+					continue;
+				}
+				if (p < end && *p == '}')
+				{
+					p++;
+					return true;
+				}
+				return false;
+			}
+			return false;
+		}
+
+		bool ParseArray(JsonValue& out, int depth)
+		{
+			out.type = JsonValue::Array;
+			p++;
+			SkipWhitespace();
+			if (p < end && *p == ']')
+			{
+				p++;
+				return true;
+			}
+
+			while (p < end)
+			{
+				out.elements.push_back(JsonValue());
+				if (!ParseValue(out.elements.back(), depth + 1))
+					return false;
+
+				SkipWhitespace();
+				if (p < end && *p == ',')
+				{
+					p++;
+					continue;
+				}
+				if (p < end && *p == ']')
+				{
+					p++;
+					return true;
+				}
+				return false;
+			}
+			return false;
+		}
+
+		// Escapes are decoded, with \u escapes outside of ASCII
+		// replaced by '?', since only keys and names are strings
+		bool ParseString(std::string& out)
+		{
+			p++;
+			while (p < end && *p != '"')
+			{
+				if (*p != '\\')
+				{
+					out += *p++;
+					continue;
+				}
+
+				p++;
+				if (p >= end)
+					return false;
+				char escape = *p++;
+				switch (escape)
+				{
+				case 'b': out += '\b'; break;
+				case 'f': out += '\f'; break;
+				case 'n': out += '\n'; break;
+				case 'r': out += '\r'; break;
+				case 't': out += '\t'; break;
+				case 'u':
+				{
+					if (end - p < 4)
+						return false;
+					char hex[5] = { p[0], p[1], p[2], p[3], 0 };
+					long code = strtol(hex, 0, 16);
+					out += code < 0x80 ? (char)code : '?';
+					p += 4;
+					break;
+				}
+				default: out += escape; break;
+				}
+			}
+
+			if (p >= end)
+				return false;
+			p++;
+			return true;
+		}
+
+		bool ParseNumber(double& out)
+		{
+			// strtod() needs a terminator, so copy the token out
+			char token[64];
+			size_t length = 0;
+			while (p < end && length < sizeof(token) - 1 &&
+				((*p >= '0' && *p <= '9') || *p == '-' || *p == '+' || *p == '.' || *p == 'e' || *p == 'E'))
+				token[length++] = *p++;
+			token[length] = 0;
+
+			char* tokenEnd;
+			out = strtod(token, &tokenEnd);
+			return length > 0 && tokenEnd == token + length;
+		}
+	};
+
+	// --------------------------------------------------------
+	// Where an accessor's elements sit in the binary chunk,
+	// after checking that every one of them is in bounds
+	// --------------------------------------------------------
+	struct AccessorView
+	{
+		const unsigned char* data;
+		size_t stride;
+		size_t count;
+		int componentType;
+		int components;
+		bool normalized;
+	};
+
+	size_t ComponentSize(int componentType)
+	{
+		switch (componentType)
+		{
+		case componentUnsignedByte: return 1;
+		case componentUnsignedShort: return 2;
+		case componentUnsignedInt:
+		case componentFloat: return 4;
+		default: return 0;
+		}
+	}
+
+	int ComponentCount(const std::string& type)
+	{
+		if (type == "SCALAR") return 1;
+		if (type == "VEC2") return 2;
+		if (type == "VEC3") return 3;
+		if (type == "VEC4") return 4;
+		return 0;
+	}
+
+	bool GetAccessor(
+		const JsonValue& root,
+		double index,
+		const unsigned char* binary,
+		size_t binarySize,
+		AccessorView& view)
+	{
+		const JsonValue* accessor = root.GetElement("accessors", index);
+		if (!accessor || accessor->Find("sparse"))
+			return false;
+
+		const JsonValue* type = accessor->Find("type");
+		view.componentType = (int)accessor->GetNumber("componentType", 0);
+		view.components = type && type->type == JsonValue::String ? ComponentCount(type->string) : 0;
+		view.count = (size_t)accessor->GetNumber("count", 0);
+		const JsonValue* normalized = accessor->Find("normalized");
+		view.normalized = normalized && normalized->type == JsonValue::Bool && normalized->boolean;
+
+		size_t elementSize = ComponentSize(view.componentType) * view.components;
+		if (elementSize == 0)
+			return false;
+
+		const JsonValue* bufferView = root.GetElement("bufferViews", accessor->GetNumber("bufferView", -1));
+		if (!bufferView || bufferView->GetNumber("buffer", 0) != 0)
+			return false;
+
+		size_t viewOffset = (size_t)bufferView->GetNumber("byteOffset", 0);
+		size_t viewLength = (size_t)bufferView->GetNumber("byteLength", 0);
+		size_t accessorOffset = (size_t)accessor->GetNumber("byteOffset", 0);
+		view.stride = (size_t)bufferView->GetNumber("byteStride", 0);
+		if (view.stride == 0)
+			view.stride = elementSize;
+
+		if (viewOffset > binarySize || viewLength > binarySize - viewOffset || view.stride < elementSize)
+			return false;
+		if (view.count > 0 &&
+			(accessorOffset > viewLength ||
+			viewLength - accessorOffset < elementSize ||
+			(view.count - 1) > (viewLength - accessorOffset - elementSize) / view.stride))
+			return false;
+
+		view.data = binary + viewOffset + accessorOffset;
+		return true;
+	}
+
+	// Reads one component as a float, scaling normalized integers
+	inline float ReadComponent(const AccessorView& view, const unsigned char* element, int component)
+	{
+		switch (view.componentType)
+		{
+		case componentFloat:
+		{
+			float value;
+			memcpy(&value, element + component * 4, 4);
+			return value;
+		}
+		case componentUnsignedByte:
+			return view.normalized ? element[component] / 255.0f : element[component];
+		case componentUnsignedShort:
+		{
+			uint16_t value;
+			memcpy(&value, element + component * 2, 2);
+			return view.normalized ? value / 65535.0f : value;
+		}
+		default:
+			return 0.0f;
+		}
+	}
+
+	// Copies whole triangles of indices, flipping each one's
+	// winding order on the way
+	template <typename Index>
+	void ReadIndices(const AccessorView& view, unsigned int* destination, size_t count)
+	{
+		for (size_t i = 0; i < count; i += 3)
+		{
+			for (int corner = 0; corner < 3; corner++)
+			{
+				Index value;
+				memcpy(&value, view.data + (i + flippedCorners[corner]) * view.stride, sizeof(Index));
+				destination[i + corner] = value;
+			}
+		}
+	}
+
+	// --------------------------------------------------------
+	// Copies an accessor into one field of each vertex, with a
+	// straight copy when it's already floats and a conversion
+	// otherwise
+	// --------------------------------------------------------
+	template <typename Field>
+	void CopyAttribute(const AccessorView& view, Vertex* vertices, Field Vertex::* field)
+	{
+		const int components = sizeof(Field) / sizeof(float);
+		if (view.componentType == componentFloat && view.components == components)
+		{
+			for (size_t i = 0; i < view.count; i++)
+				memcpy(&(vertices[i].*field), view.data + i * view.stride, sizeof(Field));
+			return;
+		}
+
+		for (size_t i = 0; i < view.count; i++)
+		{
+			float values[4] = {};
+			const unsigned char* element = view.data + i * view.stride;
+			for (int c = 0; c < components && c < view.components; c++)
+				values[c] = ReadComponent(view, element, c);
+			memcpy(&(vertices[i].*field), values, sizeof(Field));
+		}
+	}
+
+	// --------------------------------------------------------
+	// Appends one triangle primitive's vertices and indices
+	// --------------------------------------------------------
+	bool AppendPrimitive(
+		const JsonValue& root,
+		const JsonValue& primitive,
+		const unsigned char* binary,
+		size_t binarySize,
+		ObjMeshData& out)
+	{
+		const JsonValue* attributes = primitive.Find("attributes");
+		if (!attributes)
+			return false;
+
+		AccessorView positions;
+		if (!GetAccessor(root, attributes->GetNumber("POSITION", -1), binary, binarySize, positions) ||
+			positions.componentType != componentFloat ||
+			positions.components != 3)
+			return false;
+
+		if (positions.count == 0)
+			return true;
+
+		AccessorView normals = {};
+		if (attributes->Find("NORMAL") &&
+			(!GetAccessor(root, attributes->GetNumber("NORMAL", -1), binary, binarySize, normals) ||
+			normals.count != positions.count))
+			return false;
+
+		AccessorView uvs = {};
+		if (attributes->Find("TEXCOORD_0") &&
+			(!GetAccessor(root, attributes->GetNumber("TEXCOORD_0", -1), binary, binarySize, uvs) ||
+			uvs.count != positions.count))
+			return false;
+
+		size_t firstVertex = out.vertices.size();
+		out.vertices.resize(firstVertex + positions.count, Vertex());
+		Vertex* vertices = &out.vertices[firstVertex];
+
+		// Z is flipped (RH -> LH) the same as the OBJ loader, but
+		// glTF's uvs already start at the top left, so they stay put
+		// - The usual layout (all floats) is copied in a single pass
+		if (normals.componentType == componentFloat && normals.components == 3 &&
+			uvs.componentType == componentFloat && uvs.components == 2)
+		{
+			for (size_t i = 0; i < positions.count; i++)
+			{
+				Vertex& v = vertices[i];
+				memcpy(&v.position, positions.data + i * positions.stride, sizeof(XMFLOAT3));
+				memcpy(&v.normal, normals.data + i * normals.stride, sizeof(XMFLOAT3));
+				memcpy(&v.uv, uvs.data + i * uvs.stride, sizeof(XMFLOAT2));
+				v.position.z *= -1.0f;
+				v.normal.z *= -1.0f;
+			}
+		}
+		else
+		{
+			CopyAttribute(positions, vertices, &Vertex::position);
+			if (normals.data)
+				CopyAttribute(normals, vertices, &Vertex::normal);
+			if (uvs.data)
+				CopyAttribute(uvs, vertices, &Vertex::uv);
+
+			for (size_t i = 0; i < positions.count; i++)
+			{
+				vertices[i].position.z *= -1.0f;
+				vertices[i].normal.z *= -1.0f;
+			}
+		}
+
+		// Indices (or one per vertex when there aren't any), with
+		// the winding order flipped as they're read, like the OBJ loader
+		AccessorView indices = {};
+		bool indexed = primitive.Find("indices") != 0;
+		if (indexed &&
+			(!GetAccessor(root, primitive.GetNumber("indices", -1), binary, binarySize, indices) ||
+			indices.components != 1 ||
+			indices.componentType == componentFloat))
+			return false;
+
+		size_t firstIndex = out.indices.size();
+		size_t indexCount = (indexed ? indices.count : positions.count) / 3 * 3;
+		out.indices.resize(firstIndex + indexCount);
+		unsigned int* destination = out.indices.data() + firstIndex;
+		if (!indexed)
+		{
+			for (size_t i = 0; i < indexCount; i++)
+				destination[i] = (unsigned int)(i - i % 3 + flippedCorners[i % 3]);
+		}
+		else if (indices.componentType == componentUnsignedByte)
+			ReadIndices<uint8_t>(indices, destination, indexCount);
+		else if (indices.componentType == componentUnsignedShort)
+			ReadIndices<uint16_t>(indices, destination, indexCount);
+		else
+			ReadIndices<uint32_t>(indices, destination, indexCount);
+
+		// Check them, then point them past the earlier primitives
+		unsigned int largest = 0;
+		for (size_t i = 0; i < indexCount; i++)
+		{
+			largest = std::max(largest, destination[i]);
+			destination[i] += (unsigned int)firstVertex;
+		}
+		return largest < positions.count;
+	}
+}
+
+bool LoadGlb(const wchar_t* glbFile, ObjMeshData& out)
+{
+	MappedFile file(glbFile);
+	if (!file.IsOpen())
+		return false;
+
+	return ParseGlb(file.GetData(), file.GetSize(), out);
+}
+
+bool ParseGlb(const char* data, size_t size, ObjMeshData& out)
+{
+	out.vertices.clear();
+	out.indices.clear();
+
+	// Header: magic, version, total length
+	uint32_t header[3];
+	if (size < sizeof(header))
+		return false;
+	memcpy(header, data, sizeof(header));
+	if (header[0] != glbMagic || header[1] != 2 || header[2] > size)
+		return false;
+	size = header[2];
+
+	// Chunks: length, type, then the data (padded to 4 bytes)
+	const char* json = 0;
+	size_t jsonSize = 0;
+	const unsigned char* binary = 0;
+	size_t binarySize = 0;
+	size_t offset = sizeof(header);
+	while (size - offset >= 8)
+	{
+		uint32_t chunk[2];
+		memcpy(chunk, data + offset, sizeof(chunk));
+		offset += sizeof(chunk);
+		if (chunk[0] > size - offset)
+			return false;
+
+		if (chunk[1] == glbChunkJson && !json)
+		{
+			json = data + offset;
+			jsonSize = chunk[0];
+		}
+		else if (chunk[1] == glbChunkBinary && !binary)
+		{
+			binary = (const unsigned char*)data + offset;
+			binarySize = chunk[0];
+		}
+		offset += chunk[0];
+	}
+
+	JsonValue root;
+	if (!json || !JsonParser(json, jsonSize).Parse(root) || root.type != JsonValue::Object)
+		return false;
+
+	// The first buffer has to be the binary chunk
+	const JsonValue* buffer = root.GetElement("buffers", 0);
+	if (!buffer || buffer->Find("uri") || !binary)
+		return false;
+
+	const JsonValue* meshes = root.Find("meshes");
+	if (!meshes || meshes->type != JsonValue::Array)
+		return false;
+
+	for (const JsonValue& mesh : meshes->elements)
+	{
+		const JsonValue* primitives = mesh.Find("primitives");
+		if (!primitives || primitives->type != JsonValue::Array)
+			continue;
+
+		for (const JsonValue& primitive : primitives->elements)
+		{
+			if ((int)primitive.GetNumber("mode", modeTriangles) != modeTriangles)
+				continue;
+			if (!AppendPrimitive(root, primitive, binary, binarySize, out))
+				return false;
+		}
+	}
+
+	return !out.vertices.empty() && !out.indices.empty();
+}
+
+bool IsGlbFile(const wchar_t* path)
+{
+	size_t length = wcslen(path);
+	return length >= 4 &&
+		path[length - 4] == L'.' &&
+		towlower(path[length - 3]) == L'g' &&
+		towlower(path[length - 2]) == L'l' &&
+		towlower(path[length - 1]) == L'b';
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "ObjLoader.h"
+
+// --------------------------------------------------------
+// glTF 2.0 binary (.glb) loading
+//
+// - The output is the same GPU-ready arrays the OBJ loader
+//   makes, converted the same way: Z and the winding order
+//   are flipped from glTF's right-handed space
+// - Every triangle primitive of every mesh is merged into
+//   one, in local space (node transforms are ignored)
+// - Only POSITION, NORMAL and TEXCOORD_0 are read; tangents
+//   are generated later like they are for OBJ files
+// - The binary chunk must hold the data; external buffers
+//   and sparse accessors aren't supported
+// --------------------------------------------------------
+
+// Memory maps the file and reads it in place
+bool LoadGlb(const wchar_t* glbFile, ObjMeshData& out);
+
+// Reads a .glb that's already in memory
+bool ParseGlb(const char* data, size_t size, ObjMeshData& out);
+
+// True when the path ends in ".glb" (in any case)
+bool IsGlbFile(const wchar_t* path);
@@ -0,0 +1,30 @@
+#pragma once
+#include <Windows.h>
+
+// --------------------------------------------------------
+// Read-only, memory-mapped view of an entire file
+//
+// - The OS pages the file in on demand, so there is no
+//   copy into a user-side buffer and no per-line reads
+// - The view is NOT null terminated; always use GetSize()
+// --------------------------------------------------------
+class MappedFile
+{
+public:
+	MappedFile(const wchar_t* path);
+	~MappedFile();
+
+	// Mapped views own OS handles, so they can't be copied
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool IsOpen();
+	const char* GetData();
+	size_t GetSize();
+
+private:
+	HANDLE file;
+	HANDLE mapping;
+	const char* data;
+	size_t size;
+};
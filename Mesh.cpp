@@ -1,7 +1,95 @@
 #include "Mesh.h"
+#include "GltfLoader.h"
+#include "MeshOptimizer.h"
+#include "MeshTangents.h"
+
+#include <cstring>
 
 using namespace DirectX;
 
+unsigned int GetCookedOptionsKey(const MeshLoadOptions& options)
+{
+	return
+		(options.weldVertices ? 1u : 0u) |
+		(options.optimize ? 2u : 0u) |
+		(options.generateLods ? 4u : 0u) |
+		(options.buildMeshlets ? 8u : 0u);
+}
+
+unsigned int GetMeshOptionsKey(const MeshLoadOptions& options)
+{
+	return
+		GetCookedOptionsKey(options) |
+		(options.compactVertices ? 16u : 0u) |
+		(options.shortIndices ? 32u : 0u) |
+		(options.positionStream ? 64u : 0u) |
+		(options.streamingImport ? 128u : 0u) |
+		(options.buildBvh ? 256u : 0u);
+}
+
+namespace
+{
+	// --------------------------------------------------------
+	// Runs the optional load-time processing on a mesh's arrays
+	// and returns its LOD ranges (always at least LOD 0)
+	// - LODs come first, so each one can be optimized for the
+	//   vertex cache on its own
+	// - Meshlets come last and only regroup LOD 0's triangles,
+	//   so the LOD ranges and vertex order stay valid
+	// - Tangents always come from LOD 0, since every LOD
+	//   shares its vertices
+	// --------------------------------------------------------
+	std::vector<MeshLod> ProcessGeometry(
+		std::vector<Vertex>& vertices,
+		std::vector<unsigned int>& indices,
+		const MeshLoadOptions& options,
+		std::vector<Meshlet>& meshlets)
+	{
+		std::vector<MeshLod> lods;
+		if (options.generateLods && !vertices.empty())
+		{
+			lods = GenerateLodChain(&vertices[0], vertices.size(), indices);
+		}
+		else
+		{
+			MeshLod all = { 0, (unsigned int)indices.size(), 0.0f };
+			lods.push_back(all);
+		}
+
+		// Reorder for the GPU's caches - see MeshOptimizer.cpp
+		if (options.optimize)
+			OptimizeMesh(vertices, indices, &lods[0], lods.size());
+
+		// Cluster LOD 0 for culling - see Meshlets.cpp
+		meshlets.clear();
+		if (options.buildMeshlets && lods[0].indexCount > 0)
+		{
+			meshlets = BuildMeshlets(&indices[0], lods[0].indexCount, &vertices[0], vertices.size());
+
+			// Clustering shuffles triangles a little, so re-sort
+			// each meshlet for the vertex cache on its own
+			if (options.optimize)
+			{
+				std::vector<unsigned int> clustered(indices.begin(), indices.begin() + lods[0].indexCount);
+				for (const Meshlet& meshlet : meshlets)
+				{
+					OptimizeVertexCache(
+						&indices[meshlet.indexStart],
+						&clustered[meshlet.indexStart],
+						meshlet.indexCount,
+						vertices.size());
+				}
+			}
+		}
+
+		// Tangents for normal mapping - see MeshTangents.cpp
+		if (lods[0].indexCount > 0)
+			GenerateTangents(&vertices[0], vertices.size(), &indices[0], lods[0].indexCount);
+
+		return lods;
+	}
+}
+
 /// <summary>
 /// Constructor
 /// 
@@ -12,310 +100,398 @@ Mesh::Mesh(
 	unsigned int indices[],
 	int indexCount,
 	Microsoft::WRL::ComPtr<ID3D11Device> device,
-	Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext) {
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext,
+	MeshLoadOptions options,
+	std::shared_ptr<GeometryArena> arena) {
 
-	this->indexCount = indexCount;
 	this->deviceContext = deviceContext;
+	this->arena = arena;
+	SetEmpty();
 
-	//Vertex Buffer
-	D3D11_BUFFER_DESC vbd = {};
-	vbd.Usage = D3D11_USAGE_IMMUTABLE;
-	vbd.ByteWidth = sizeof(Vertex) * vertexCount;
-	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	vbd.CPUAccessFlags = 0;
-	vbd.MiscFlags = 0;
-	vbd.StructureByteStride = 0;
-
-	D3D11_SUBRESOURCE_DATA initialVertexData = {};
-	initialVertexData.pSysMem = vertices;
-
-	device->CreateBuffer(&vbd, &initialVertexData, vertexBuffer.GetAddressOf());
-
-	//Index Buffer
-	D3D11_BUFFER_DESC ibd = {};
-	ibd.Usage = D3D11_USAGE_IMMUTABLE;
-	ibd.ByteWidth = sizeof(unsigned int) * indexCount;
-	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	ibd.CPUAccessFlags = 0;
-	ibd.MiscFlags = 0;
-	ibd.StructureByteStride = 0;
+	// Nothing to upload, so the mesh stays empty and draws
+	// nothing, like a file that failed to load
+	if (vertexCount <= 0 || indexCount <= 0)
+		return;
 
-	D3D11_SUBRESOURCE_DATA initialIndexData = {};
-	initialIndexData.pSysMem = indices;
+	bounds = ComputeBounds(vertices, vertexCount);
 
-	device->CreateBuffer(&ibd, &initialIndexData, indexBuffer.GetAddressOf());
+	// Process copies, since the caller owns these arrays
+	std::vector<Vertex> processedVertices(vertices, vertices + vertexCount);
+	std::vector<unsigned int> processedIndices(indices, indices + indexCount);
+	std::vector<Meshlet> processedMeshlets;
+	std::vector<MeshLod> processedLods = ProcessGeometry(processedVertices, processedIndices, options, processedMeshlets);
+	if (processedLods.empty())
+		return;
 
-	CalculateTangents(&vertices[0], vertexCount, &indices[0], indexCount);
+	CreateBuffers(
+		&processedVertices[0],
+		(int)processedVertices.size(),
+		&processedIndices[0],
+		(int)processedIndices.size(),
+		&processedLods[0],
+		(int)processedLods.size(),
+		processedMeshlets.data(),
+		(int)processedMeshlets.size(),
+		options,
+		device);
 }
 
 Mesh::Mesh(
 	const wchar_t* objFile,
 	Microsoft::WRL::ComPtr<ID3D11Device> device,
-	Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext)
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext,
+	MeshLoadOptions options,
+	std::shared_ptr<GeometryArena> arena)
 {
-	// Author: Chris Cascioli
-// Purpose: Basic .OBJ 3D model loading, supporting positions, uvs and normals
-// 
-// - You are allowed to directly copy/paste this into your code base
-//   for assignments, given that you clearly cite that this is not
-//   code of your own design.
-//
-// - NOTE: You'll need to #include <fstream>
-
 	this->deviceContext = deviceContext;
-	//indexBuffer = 
+	this->arena = arena;
+	SetEmpty();
 
-	// File input object
-	std::ifstream obj(objFile);
-
-	// Check for successful open
-	if (!obj.is_open())
+	// The source is mapped either way, since its hash tells us
+	// whether a previously cooked .mesh file is still current
+	MappedFile source(objFile);
+	if (!source.IsOpen())
 		return;
 
-	// Variables used while reading the file
-	std::vector<XMFLOAT3> positions;	// Positions from the file
-	std::vector<XMFLOAT3> normals;		// Normals from the file
-	std::vector<XMFLOAT2> uvs;		// UVs from the file
-	std::vector<Vertex> verts;		// Verts we're assembling
-	std::vector<UINT> indices;		// Indices of these verts
-	int vertCounter = 0;			// Count of vertices
-	int indexCounter = 0;			// Count of indices
-	char chars[100];			// String for line reading
-
-	// Still have data left?
-	while (obj.good())
+	// A streamed mesh is never in memory all at once, so there's
+	// no chance to simplify or reorder it, and a BVH over every
+	// triangle would need far more memory than streaming saved
+	bool streaming = options.streamingImport && !IsGlbFile(objFile);
+	if (streaming)
 	{
-		// Get the line (100 characters should be more than enough)
-		obj.getline(chars, 100);
+		options.optimize = false;
+		options.generateLods = false;
+		options.buildMeshlets = false;
+		options.buildBvh = false;
+	}
 
-		// Check the type of line
-		if (chars[0] == 'v' && chars[1] == 'n')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 norm;
-			sscanf_s(
-				chars,
-				"vn %f %f %f",
-				&norm.x, &norm.y, &norm.z);
-
-			// Add to the list of normals
-			normals.push_back(norm);
-		}
-		else if (chars[0] == 'v' && chars[1] == 't')
-		{
-			// Read the 2 numbers directly into an XMFLOAT2
-			XMFLOAT2 uv;
-			sscanf_s(
-				chars,
-				"vt %f %f",
-				&uv.x, &uv.y);
-
-			// Add to the list of uv's
-			uvs.push_back(uv);
-		}
-		else if (chars[0] == 'v')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 pos;
-			sscanf_s(
-				chars,
-				"v %f %f %f",
-				&pos.x, &pos.y, &pos.z);
-
-			// Add to the positions
-			positions.push_back(pos);
-		}
-		else if (chars[0] == 'f')
-		{
-			// Read the face indices into an array
-			// NOTE: This assumes the given obj file contains
-			//  vertex positions, uv coordinates AND normals.
-			unsigned int i[12];
-			int numbersRead = sscanf_s(
-				chars,
-				"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
-				&i[0], &i[1], &i[2],
-				&i[3], &i[4], &i[5],
-				&i[6], &i[7], &i[8],
-				&i[9], &i[10], &i[11]);
-
-			// If we only got the first number, chances are the OBJ
-			// file has no UV coordinates.  This isn't great, but we
-			// still want to load the model without crashing, so we
-			// need to re-read a different pattern (in which we assume
-			// there are no UVs denoted for any of the vertices)
-			if (numbersRead == 1)
-			{
-				// Re-read with a different pattern
-				numbersRead = sscanf_s(
-					chars,
-					"f %d//%d %d//%d %d//%d %d//%d",
-					&i[0], &i[2],
-					&i[3], &i[5],
-					&i[6], &i[8],
-					&i[9], &i[11]);
-
-				// The following indices are where the UVs should 
-				// have been, so give them a valid value
-				i[1] = 1;
-				i[4] = 1;
-				i[7] = 1;
-				i[10] = 1;
-
-				// If we have no UVs, create a single UV coordinate
-				// that will be used for all vertices
-				if (uvs.size() == 0)
-					uvs.push_back(XMFLOAT2(0, 0));
-			}
+	unsigned long long sourceHash = HashBytes(source.GetData(), source.GetSize());
+	std::wstring cookedPath = GetCookedPath(objFile);
+	unsigned int cookedOptionsKey = GetCookedOptionsKey(options);
 
-			// - Create the verts by looking up
-			//    corresponding data from vectors
-			// - OBJ File indices are 1-based, so
-			//    they need to be adusted
-			Vertex v1;
-			v1.position = positions[i[0] - 1];
-			v1.uv = uvs[i[1] - 1];
-			v1.normal = normals[i[2] - 1];
-
-			Vertex v2;
-			v2.position = positions[i[3] - 1];
-			v2.uv = uvs[i[4] - 1];
-			v2.normal = normals[i[5] - 1];
-
-			Vertex v3;
-			v3.position = positions[i[6] - 1];
-			v3.uv = uvs[i[7] - 1];
-			v3.normal = normals[i[8] - 1];
-
-			// The model is most likely in a right-handed space,
-			// especially if it came from Maya.  We want to convert
-			// to a left-handed space for DirectX.  This means we 
-			// need to:
-			//  - Invert the Z position
-			//  - Invert the normal's Z
-			//  - Flip the winding order
-			// We also need to flip the UV coordinate since DirectX
-			// defines (0,0) as the top left of the texture, and many
-			// 3D modeling packages use the bottom left as (0,0)
-
-			// Flip the UV's since they're probably "upside down"
-			v1.uv.y = 1.0f - v1.uv.y;
-			v2.uv.y = 1.0f - v2.uv.y;
-			v3.uv.y = 1.0f - v3.uv.y;
-
-			// Flip Z (LH vs. RH)
-			v2.position.z *= -1.0f;
-			v1.position.z *= -1.0f;
-			v3.position.z *= -1.0f;
-
-			// Flip normal's Z
-			v1.normal.z *= -1.0f;
-			v2.normal.z *= -1.0f;
-			v3.normal.z *= -1.0f;
-
-			// Add the verts to the vector (flipping the winding order)
-			verts.push_back(v1);
-			verts.push_back(v3);
-			verts.push_back(v2);
-			vertCounter += 3;
-
-			// Add three more indices
-			indices.push_back(indexCounter); indexCounter += 1;
-			indices.push_back(indexCounter); indexCounter += 1;
-			indices.push_back(indexCounter); indexCounter += 1;
-
-			// Was there a 4th face?
-			// - 12 numbers read means 4 faces WITH uv's
-			// - 8 numbers read means 4 faces WITHOUT uv's
-			if (numbersRead == 12 || numbersRead == 8)
-			{
-				// Make the last vertex
-				Vertex v4;
-				v4.position = positions[i[9] - 1];
-				v4.uv = uvs[i[10] - 1];
-				v4.normal = normals[i[11] - 1];
-
-				// Flip the UV, Z pos and normal's Z
-				v4.uv.y = 1.0f - v4.uv.y;
-				v4.position.z *= -1.0f;
-				v4.normal.z *= -1.0f;
-
-				// Add a whole triangle (flipping the winding order)
-				verts.push_back(v1);
-				verts.push_back(v4);
-				verts.push_back(v3);
-				vertCounter += 3;
-
-				// Add three more indices
-				indices.push_back(indexCounter); indexCounter += 1;
-				indices.push_back(indexCounter); indexCounter += 1;
-				indices.push_back(indexCounter); indexCounter += 1;
-			}
-		}
+	// Maps the cooked file, if it's current, and its vertices and
+	// indices go straight into the immutable buffers - with no
+	// copies, unless they were encoded and had to be decoded
+	auto loadCooked = [&]()
+	{
+		CookedMesh cooked(cookedPath.c_str());
+		if (!cooked.IsCurrent(sourceHash, source.GetSize(), cookedOptionsKey))
+			return false;
+
+		bounds = cooked.GetBounds();
+		CreateBuffers(
+			cooked.GetVertices(),
+			cooked.GetVertexCount(),
+			cooked.GetIndices(),
+			cooked.GetIndexCount(),
+			cooked.GetLods(),
+			cooked.GetLodCount(),
+			cooked.GetMeshlets(),
+			cooked.GetMeshletCount(),
+			options,
+			device);
+		return true;
+	};
+
+	// Warm path
+	if (loadCooked())
+		return;
 
+	// Streaming cold path: the OBJ goes straight into the cooked
+	// file, which then loads like a warm one - see StreamObj()
+	// - Without a writable cooked file there's nowhere to put the
+	//   mesh, so it stays empty
+	if (streaming)
+	{
+		CookedMeshWriter writer(cookedPath.c_str());
+		MeshBounds streamedBounds;
+		if (StreamObj(source.GetData(), source.GetSize(), writer, streamedBounds, options.weldVertices) &&
+			writer.Finish(sourceHash, source.GetSize(), cookedOptionsKey, streamedBounds))
+			loadCooked();
+		return;
 	}
 
-	// Close the file and create the actual buffers
-	obj.close();
+	// Cold path: read the .glb's buffers or parse the OBJ text - see
+	// GltfLoader.cpp and ObjLoader.cpp for the details
+	// - Very large OBJ files are split across every hardware thread
+	ObjMeshData obj;
+	bool parsed =
+		IsGlbFile(objFile) ? ParseGlb(source.GetData(), source.GetSize(), obj) :
+		source.GetSize() >= objParallelThreshold ?
+		ParseObjParallel(source.GetData(), source.GetSize(), obj, options.weldVertices) :
+		ParseObj(source.GetData(), source.GetSize(), obj, options.weldVertices);
+	if (!parsed)
+		return;
+
+	// Build LODs, reorder for the GPU, cluster and generate tangents - see
+	// MeshSimplifier.cpp, MeshOptimizer.cpp, Meshlets.cpp and MeshTangents.cpp
+	std::vector<Meshlet> meshlets;
+	std::vector<MeshLod> meshLods = ProcessGeometry(obj.vertices, obj.indices, options, meshlets);
 
-	// - At this point, "verts" is a vector of Vertex structs, and can be used
-	//    directly to create a vertex buffer:  &verts[0] is the address of the first vert
+	// - At this point, "vertices" is a vector of Vertex structs, and can be used
+	//    directly to create a vertex buffer:  &vertices[0] is the address of the first vert
 	//
 	// - The vector "indices" is similar. It's a vector of unsigned ints and
 	//    can be used directly for the index buffer: &indices[0] is the address of the first int
 	//
-	// - "vertCounter" is the number of vertices
-	// - "indexCounter" is the number of indices
-	// - Yes, these are effectively the same since OBJs do not index entire vertices!  This means
-	//    an index buffer isn't doing much for us.  We could try to optimize the mesh ourselves
-	//    and detect duplicate vertices, but at that point it would be better to use a more
-	//    sophisticated model loading library like TinyOBJLoader or The Open Asset Importer Library
+	// - Face corners that share a position/uv/normal have been welded into a single
+	//    vertex, so there are (usually far) fewer vertices than indices
+	//
+	// - When optimized, triangles are in vertex cache friendly order and the vertices
+	//    are in the order they're first used
+	//
+	// - With LODs, "indices" holds LOD 0 followed by each simpler level, and
+	//    "meshLods" says where each one starts
+	//
+	// - With meshlets, LOD 0's triangles are grouped into small clusters, and
+	//    "meshlets" says where each one starts
+	int vertCounter = (int)obj.vertices.size();
+	int indexCounter = (int)obj.indices.size();
+	bounds = ComputeBounds(&obj.vertices[0], vertCounter);
+
+	// Save the final arrays so the next launch can skip parsing
+	// - Failing to write (read-only folder, etc.) isn't fatal
+	CookedMesh::Write(
+		cookedPath.c_str(),
+		sourceHash,
+		source.GetSize(),
+		cookedOptionsKey,
+		&obj.vertices[0],
+		vertCounter,
+		&obj.indices[0],
+		indexCounter,
+		&meshLods[0],
+		(unsigned int)meshLods.size(),
+		meshlets.data(),
+		(unsigned int)meshlets.size(),
+		bounds,
+		options.encodeCooked);
+
+	CreateBuffers(
+		&obj.vertices[0],
+		vertCounter,
+		&obj.indices[0],
+		indexCounter,
+		&meshLods[0],
+		(int)meshLods.size(),
+		meshlets.data(),
+		(int)meshlets.size(),
+		options,
+		device);
+}
+
+// --------------------------------------------------------
+// What a mesh looks like before (or without) CreateBuffers():
+// no LODs, so it draws nothing and reports no buffer memory
+// --------------------------------------------------------
+void Mesh::SetEmpty()
+{
+	indexCount = 0;
+	vertexCount = 0;
+	vertexStride = sizeof(Vertex);
+	positionStride = 0;
+	indexFormat = DXGI_FORMAT_R32_UINT;
+	compactVertices = false;
+	positionDecode = CompactPositionDecode();
+	bufferBytes = 0;
+	uncompressedBufferBytes = 0;
+	loadCopyBytes = 0;
+	bounds = MeshBounds();
+}
+
+// --------------------------------------------------------
+// Creates the immutable vertex and index buffers shared by
+// both constructors (or copies the data into the arena) and
+// remembers each LOD's and meshlet's index range
+// - The BVH is built here too, from the final triangle order
+// - Compact vertices, short indices and the position stream
+//   are converted here, so cooked files always hold the full
+//   precision data
+// - Expects bounds to be set already
+// --------------------------------------------------------
+void Mesh::CreateBuffers(
+	const Vertex* vertices,
+	int vertexCount,
+	const unsigned int* indices,
+	int indexCount,
+	const MeshLod* lods,
+	int lodCount,
+	const Meshlet* meshlets,
+	int meshletCount,
+	const MeshLoadOptions& options,
+	Microsoft::WRL::ComPtr<ID3D11Device> device)
+{
+	this->lods.assign(lods, lods + lodCount);
+	this->meshlets.assign(meshlets, meshlets + meshletCount);
+	this->indexCount = lods[0].indexCount;
+	this->vertexCount = vertexCount;
+
+	// Ray queries - see MeshBvh.cpp
+	if (options.buildBvh)
+		bvh.Build(&vertices[0].position, sizeof(Vertex), indices, lods[0].indexCount);
+
+	// Vertex data, either as is or compacted
+	const void* vertexData = vertices;
+	std::vector<CompactVertex> compact;
+	compactVertices = options.compactVertices;
+	positionDecode = GetCompactPositionDecode(bounds);
+	vertexStride = sizeof(Vertex);
+	if (compactVertices)
+	{
+		compact.resize(vertexCount);
+		EncodeCompactVertices(vertices, vertexCount, positionDecode, &compact[0]);
+		vertexData = &compact[0];
+		vertexStride = sizeof(CompactVertex);
+	}
+
+	// Index data, with 16 bits whenever every index fits
+	const void* indexData = indices;
+	std::vector<unsigned short> shortIndices;
+	indexFormat = DXGI_FORMAT_R32_UINT;
+	unsigned int indexSize = sizeof(unsigned int);
+	if (options.shortIndices && vertexCount <= 0x10000)
+	{
+		shortIndices.assign(indices, indices + indexCount);
+		indexData = shortIndices.data();
+		indexFormat = DXGI_FORMAT_R16_UINT;
+		indexSize = sizeof(unsigned short);
+	}
+
+	// Positions on their own for depth-only passes, in the same
+	// format as the main stream's positions
+	std::vector<XMFLOAT3> fullPositions;
+	std::vector<unsigned short> compactPositions;
+	const void* positionData = 0;
+	positionStride = 0;
+	if (options.positionStream)
+	{
+		if (compactVertices)
+		{
+			compactPositions.resize((size_t)vertexCount * 4);
+			for (int i = 0; i < vertexCount; i++)
+				memcpy(&compactPositions[(size_t)i * 4], compact[i].position, sizeof(compact[i].position));
+			positionData = &compactPositions[0];
+			positionStride = sizeof(compact[0].position);
+		}
+		else
+		{
+			fullPositions.resize(vertexCount);
+			for (int i = 0; i < vertexCount; i++)
+				fullPositions[i] = vertices[i].position;
+			positionData = &fullPositions[0];
+			positionStride = sizeof(XMFLOAT3);
+		}
+	}
+
+	this->bufferBytes = (vertexStride + positionStride) * vertexCount + indexSize * indexCount;
+	this->uncompressedBufferBytes = sizeof(Vertex) * vertexCount + sizeof(unsigned int) * indexCount;
+	this->loadCopyBytes =
+		(unsigned int)(compact.size() * sizeof(CompactVertex)) +
+		(unsigned int)(shortIndices.size() * sizeof(unsigned short)) +
+		(unsigned int)(fullPositions.size() * sizeof(XMFLOAT3)) +
+		(unsigned int)(compactPositions.size() * sizeof(unsigned short));
+
+	// Static geometry arena - see GeometryArena.cpp
+	if (arena)
+	{
+		allocation = arena->Allocate(
+			vertexData,
+			vertexStride,
+			positionData,
+			positionStride,
+			vertexCount,
+			indexData,
+			indexFormat,
+			indexCount);
+		return;
+	}
 
 	//Vertex Buffer
 	D3D11_BUFFER_DESC vbd = {};
 	vbd.Usage = D3D11_USAGE_IMMUTABLE;
-	vbd.ByteWidth = sizeof(Vertex) * vertCounter;
+	vbd.ByteWidth = vertexStride * vertexCount;
 	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 	vbd.CPUAccessFlags = 0;
 	vbd.MiscFlags = 0;
 	vbd.StructureByteStride = 0;
 
 	D3D11_SUBRESOURCE_DATA initialVertexData = {};
-	initialVertexData.pSysMem = &verts[0];
+	initialVertexData.pSysMem = vertexData;
 
 	device->CreateBuffer(&vbd, &initialVertexData, vertexBuffer.GetAddressOf());
 
+	//Position Buffer
+	if (positionData)
+	{
+		D3D11_BUFFER_DESC pbd = vbd;
+		pbd.ByteWidth = positionStride * vertexCount;
+
+		D3D11_SUBRESOURCE_DATA initialPositionData = {};
+		initialPositionData.pSysMem = positionData;
+
+		device->CreateBuffer(&pbd, &initialPositionData, positionBuffer.GetAddressOf());
+	}
+
 	//Index Buffer
 	D3D11_BUFFER_DESC ibd = {};
 	ibd.Usage = D3D11_USAGE_IMMUTABLE;
-	ibd.ByteWidth = sizeof(unsigned int) * indexCounter;
+	ibd.ByteWidth = indexSize * indexCount;
 	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
 	ibd.CPUAccessFlags = 0;
 	ibd.MiscFlags = 0;
 	ibd.StructureByteStride = 0;
 
 	D3D11_SUBRESOURCE_DATA initialIndexData = {};
-	initialIndexData.pSysMem = &indices[0];
+	initialIndexData.pSysMem = indexData;
 
 	device->CreateBuffer(&ibd, &initialIndexData, indexBuffer.GetAddressOf());
+}
 
-	indexCount = indexCounter;
+// --------------------------------------------------------
+// Binds the buffers in whichever formats they were made
+// - depthOnly picks the position stream if there is one
+// --------------------------------------------------------
+void Mesh::SetBuffers(bool depthOnly)
+{
+	if (allocation)
+	{
+		arena->Bind(*allocation, depthOnly);
+		return;
+	}
 
-	CalculateTangents(&verts[0], vertCounter, &indices[0], indexCounter);
+	UINT offset = 0;
+	if (depthOnly && positionBuffer)
+		deviceContext->IASetVertexBuffers(0, 1, positionBuffer.GetAddressOf(), &positionStride, &offset);
+	else
+		deviceContext->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &vertexStride, &offset);
+	deviceContext->IASetIndexBuffer(indexBuffer.Get(), indexFormat, 0);
+}
+
+// --------------------------------------------------------
+// Draws indices relative to this mesh's own index data, which
+// in the arena starts partway into the shared buffers
+// --------------------------------------------------------
+void Mesh::DrawIndexedRange(unsigned int indexCount, unsigned int indexStart)
+{
+	if (allocation)
+		deviceContext->DrawIndexed(indexCount, allocation->indexOffset + indexStart, (int)allocation->vertexOffset);
+	else
+		deviceContext->DrawIndexed(indexCount, indexStart, 0);
 }
 
 /// <summary>
 /// Destructor
 /// </summary>
 Mesh::~Mesh() {
-
+	// Leaves a hole for GeometryArena::Compact() to close
+	if (allocation)
+		arena->Free(allocation);
 }
 
 // --------------------------------------------------------
 // Calculates the tangents of the vertices in a mesh
-// - Code originally adapted from: http://www.terathon.com/code/tangent.html
-// - Updated version found here: http://foundationsofgameenginedev.com/FGED2-sample.pdf
-// - See listing 7.4 in section 7.5 (page 9 of the PDF)
+// - See GenerateTangents() in MeshTangents.cpp, which both
+//   constructors already run on their own geometry
 //
 // - Note: For this code to work, your Vertex format must
 // contain an XMFLOAT3 called Tangent
@@ -324,62 +500,7 @@ Mesh::~Mesh() {
 // --------------------------------------------------------
 void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
 {
-	// Reset tangents
-	for (int i = 0; i < numVerts; i++)
-	{
-		verts[i].tangent = XMFLOAT3(0, 0, 0);
-	}
-	// Calculate tangents one whole triangle at a time
-	for (int i = 0; i < numIndices;)
-	{
-		// Grab indices and vertices of first triangle
-		unsigned int i1 = indices[i++];
-		unsigned int i2 = indices[i++];
-		unsigned int i3 = indices[i++];
-		Vertex* v1 = &verts[i1];
-		Vertex* v2 = &verts[i2];
-		Vertex* v3 = &verts[i3];
-		// Calculate vectors relative to triangle positions
-		float x1 = v2->position.x - v1->position.x;
-		float y1 = v2->position.y - v1->position.y;
-		float z1 = v2->position.z - v1->position.z;
-		float x2 = v3->position.x - v1->position.x;
-		float y2 = v3->position.y - v1->position.y;
-		float z2 = v3->position.z - v1->position.z;
-		// Do the same for vectors relative to triangle uv's
-		float s1 = v2->uv.x - v1->uv.x;
-		float t1 = v2->uv.y - v1->uv.y;
-		float s2 = v3->uv.x - v1->uv.x;
-		float t2 = v3->uv.y - v1->uv.y;
-		// Create vectors for tangent calculation
-		float r = 1.0f / (s1 * t2 - s2 * t1);
-		float tx = (t2 * x1 - t1 * x2) * r;
-		float ty = (t2 * y1 - t1 * y2) * r;
-		float tz = (t2 * z1 - t1 * z2) * r;
-		// Adjust tangents of each vert of the triangle
-		v1->tangent.x += tx;
-		v1->tangent.y += ty;
-		v1->tangent.z += tz;
-		v2->tangent.x += tx;
-		v2->tangent.y += ty;
-		v2->tangent.z += tz;
-		v3->tangent.x += tx;
-		v3->tangent.y += ty;
-		v3->tangent.z += tz;
-	}
-	// Ensure all of the tangents are orthogonal to the normals
-	for (int i = 0; i < numVerts; i++)
-	{
-		// Grab the two vectors
-		XMVECTOR normal = XMLoadFloat3(&verts[i].normal);
-		XMVECTOR tangent = XMLoadFloat3(&verts[i].tangent);
-		// Use Gram-Schmidt orthonormalize to ensure
-		// the normal and tangent are exactly 90 degrees apart
-		tangent = XMVector3Normalize(
-			tangent - normal * XMVector3Dot(normal, tangent));
-		// Store the tangent
-		XMStoreFloat3(&verts[i].tangent, tangent);
-	}
+	GenerateTangents(verts, numVerts, indices, numIndices);
 }
 
 Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetVertexBuffer() {
@@ -396,22 +517,132 @@ int Mesh::GetIndexCount() {
 	return indexCount;
 }
 void Mesh::Draw() {
+	if (lods.empty())
+		return;
+
 	//Draw mesh using buffers
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
+	SetBuffers(false);
+
+	DrawIndexedRange(indexCount, 0);
+}
 
-	deviceContext->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
-	deviceContext->IASetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+// --------------------------------------------------------
+// Draws one level of detail (0 is the full mesh)
+// - A mesh that failed to load has no LODs, and draws nothing
+// --------------------------------------------------------
+void Mesh::Draw(unsigned int lod) {
+	if (lods.empty())
+		return;
+	if (lod >= lods.size())
+		lod = (unsigned int)lods.size() - 1;
 
-	deviceContext->DrawIndexed(indexCount, 0, 0);
+	SetBuffers(false);
+
+	DrawIndexedRange(lods[lod].indexCount, lods[lod].indexStart);
+}
+
+// --------------------------------------------------------
+// Draws only the given ranges of LOD 0, such as the meshlets
+// that survived CullMeshlets()
+// --------------------------------------------------------
+void Mesh::DrawRanges(const std::vector<MeshletDrawRange>& ranges) {
+	if (lods.empty())
+		return;
+
+	SetBuffers(false);
+
+	for (const MeshletDrawRange& range : ranges)
+		DrawIndexedRange(range.indexCount, range.indexStart);
+}
+
+// --------------------------------------------------------
+// Draws a level of detail for a pass that only needs depth,
+// like the shadow map, using the position stream
+// - The vertex shader must only read POSITION (like
+//   ShadowVS.hlsl), which also lets it fall back to the full
+//   stream when there's no position stream
+// --------------------------------------------------------
+void Mesh::DrawDepthOnly(unsigned int lod) {
+	if (lods.empty())
+		return;
+	if (lod >= lods.size())
+		lod = (unsigned int)lods.size() - 1;
+
+	SetBuffers(true);
+
+	DrawIndexedRange(lods[lod].indexCount, lods[lod].indexStart);
+}
+
+unsigned int Mesh::GetLodCount()
+{
+	return (unsigned int)lods.size();
+}
+
+MeshLod Mesh::GetLod(unsigned int lod)
+{
+	return lods[lod];
+}
+
+MeshBounds Mesh::GetBounds()
+{
+	return bounds;
+}
+
+unsigned int Mesh::GetMeshletCount()
+{
+	return (unsigned int)meshlets.size();
+}
+
+const Meshlet* Mesh::GetMeshlets()
+{
+	return meshlets.data();
+}
+
+bool Mesh::Raycast(const XMFLOAT3& origin, const XMFLOAT3& direction, float maxDistance, RayHit& hit)
+{
+	return bvh.Raycast(origin, direction, maxDistance, hit);
+}
+
+MeshBvh& Mesh::GetBvh()
+{
+	return bvh;
+}
+
+unsigned int Mesh::GetBufferBytes()
+{
+	return bufferBytes;
+}
+
+unsigned int Mesh::GetUncompressedBufferBytes()
+{
+	return uncompressedBufferBytes;
+}
+
+unsigned int Mesh::GetLoadCopyBytes()
+{
+	return loadCopyBytes;
+}
+
+bool Mesh::IsInArena()
+{
+	return allocation != nullptr;
+}
+
+bool Mesh::HasCompactVertices()
+{
+	return compactVertices;
 }
 
-void Mesh::SetTint(float r, float g, float b, float a)
+CompactPositionDecode Mesh::GetPositionDecode()
 {
-	XMStoreFloat4(&colorTint, { r,g,b,a });
+	return positionDecode;
 }
 
-DirectX::XMFLOAT4 Mesh::GetTint()
+unsigned int Mesh::GetFetchBytesSaved(unsigned int indicesDrawn)
 {
-	return colorTint;
+	unsigned int indexSize = indexFormat == DXGI_FORMAT_R16_UINT ? sizeof(unsigned short) : sizeof(unsigned int);
+	unsigned int verticesRead = indicesDrawn < vertexCount ? indicesDrawn : vertexCount;
+	return
+		indicesDrawn * (sizeof(unsigned int) - indexSize) +
+		verticesRead * (sizeof(Vertex) - vertexStride);
 }
\ No newline at end of file
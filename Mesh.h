@@ -4,9 +4,66 @@
 #include <wrl/client.h>
 #include <d3d11.h>
 #include "Vertex.h"
-#include <fstream>
+#include "ObjLoader.h"
+#include "CookedMesh.h"
+#include "MeshSimplifier.h"
+#include "Meshlets.h"
+#include "CompactVertex.h"
+#include "GeometryArena.h"
+#include "MeshBvh.h"
+#include <memory>
 #include <vector>
 
+// --------------------------------------------------------
+// How a Mesh processes its geometry before creating buffers
+// --------------------------------------------------------
+struct MeshLoadOptions
+{
+	bool weldVertices = true;	// Share identical face corners (OBJ files only; .glb is already indexed)
+	bool optimize = true;		// Reorder for vertex cache, overdraw and fetch
+	bool generateLods = true;	// Append simplified levels of detail
+	bool buildMeshlets = true;	// Split LOD 0 into clusters for culling
+	bool streamingImport = false;	// Cook OBJ files straight to disk a chunk at a time, for scans
+									// too big to load whole - turns off optimize, LODs, meshlets
+									// and the BVH (so Raycast() always misses)
+	bool encodeCooked = false;		// Write cooked files' vertices and indices with MeshCodec.h
+									// (not part of the options key, since either kind loads);
+									// smaller files, but warm loads decode into copies instead
+									// of uploading straight from the mapped file - worth it on
+									// slow drives (see BenchmarkMeshCompression())
+
+	// Only change how the buffers are uploaded, not the cooked file
+	// - Cooked files always hold full Vertex data and 32 bit
+	//   indices, so these are converted into a copy on every load,
+	//   warm ones included, rather than uploaded straight from the
+	//   mapped file (see Mesh::GetLoadCopyBytes())
+	bool compactVertices = false;	// Upload CompactVertex data, which needs a vertex shader
+									// that reads it (like CompactVertexShader.hlsl)
+	bool shortIndices = true;		// Upload 16 bit indices when there are few enough vertices;
+									// half the index memory, for a copy of the indices per load
+	bool positionStream = true;		// Also upload positions on their own for DrawDepthOnly();
+									// gathered into a copy per load, since cooked files only
+									// hold them interleaved with the rest of each vertex
+	bool buildBvh = true;			// Keep a BVH of LOD 0 on the CPU for Raycast()
+};
+
+// Identifies the load options in cooked .mesh files, so a
+// change in options never picks up a stale cooked mesh
+// - Bit 0: vertices are welded
+// - Bit 1: buffers are optimized
+// - Bit 2: LODs are generated
+// - Bit 3: meshlets are built
+unsigned int GetCookedOptionsKey(const MeshLoadOptions& options);
+
+// Identifies every load option, including the upload-only ones
+// - Bits 0-3: the same as GetCookedOptionsKey()
+// - Bit 4: compact vertices
+// - Bit 5: short indices
+// - Bit 6: position stream
+// - Bit 7: streaming import
+// - Bit 8: BVH
+unsigned int GetMeshOptionsKey(const MeshLoadOptions& options);
+
 class Mesh
 {
 public:
@@ -15,24 +72,98 @@ public:
 		unsigned int indices[],
 		int indexCount, 
 		Microsoft::WRL::ComPtr<ID3D11Device> device,
-		Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext);
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext,
+		MeshLoadOptions options = MeshLoadOptions(),
+		std::shared_ptr<GeometryArena> arena = nullptr);
+	// Loads an .obj, or a .glb when the file ends in .glb
 	Mesh(
 		const wchar_t* objFile,
 		Microsoft::WRL::ComPtr<ID3D11Device> device,
-		Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext);
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext,
+		MeshLoadOptions options = MeshLoadOptions(),
+		std::shared_ptr<GeometryArena> arena = nullptr);
 	~Mesh();
 	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer();
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffed();
 	int GetIndexCount();
+	unsigned int GetLodCount();		// 0 if the mesh failed to load
+	MeshLod GetLod(unsigned int lod);	// lod must be below GetLodCount()
+	MeshBounds GetBounds();
+	unsigned int GetMeshletCount();
+	const Meshlet* GetMeshlets();
+
+	// Finds LOD 0's closest triangle along a local-space ray
+	// - See MeshBvh::Raycast(); always misses without a BVH
+	bool Raycast(
+		const DirectX::XMFLOAT3& origin,
+		const DirectX::XMFLOAT3& direction,
+		float maxDistance,
+		RayHit& hit);
+	MeshBvh& GetBvh();
 	void Draw();
-	void SetTint(float r, float g, float b, float a);
-	DirectX::XMFLOAT4 GetTint();
+	void Draw(unsigned int lod);
+	void DrawRanges(const std::vector<MeshletDrawRange>& ranges);
+	void DrawDepthOnly(unsigned int lod = 0);
+
+	// Meshes made with an arena live in its shared buffers and
+	// have no buffers of their own
+	bool IsInArena();
+
+	// Bytes of vertex and index buffer memory this mesh uses, and
+	// would use with full Vertex data and 32 bit indices
+	unsigned int GetBufferBytes();
+	unsigned int GetUncompressedBufferBytes();
+
+	// Bytes that were converted into a copy on the CPU at load
+	// time (compact vertices, 16 bit indices, the position stream)
+	// rather than uploaded straight from the cooked file
+	unsigned int GetLoadCopyBytes();
+
+	// Compact meshes need their position decode constants sent
+	// to the vertex shader (as positionOffset and positionScale)
+	bool HasCompactVertices();
+	CompactPositionDecode GetPositionDecode();
+
+	// A lower bound on the vertex and index bytes that compact
+	// vertices and short indices save in a draw of this many
+	// indices (every vertex it uses is read at least once)
+	unsigned int GetFetchBytesSaved(unsigned int indicesDrawn);
 private:
+	void SetEmpty();
+	void CreateBuffers(
+		const Vertex* vertices,
+		int vertexCount,
+		const unsigned int* indices,
+		int indexCount,
+		const MeshLod* lods,
+		int lodCount,
+		const Meshlet* meshlets,
+		int meshletCount,
+		const MeshLoadOptions& options,
+		Microsoft::WRL::ComPtr<ID3D11Device> device);
+	void SetBuffers(bool depthOnly);
+	void DrawIndexedRange(unsigned int indexCount, unsigned int indexStart);
+
 	Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
 	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> positionBuffer;
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext;
+	std::shared_ptr<GeometryArena> arena;
+	std::shared_ptr<GeometryAllocation> allocation;
 	int indexCount;
-	DirectX::XMFLOAT4 colorTint;
+	std::vector<MeshLod> lods;
+	std::vector<Meshlet> meshlets;
+	MeshBounds bounds;
+	MeshBvh bvh;
+	unsigned int vertexCount;
+	unsigned int vertexStride;
+	unsigned int positionStride;
+	DXGI_FORMAT indexFormat;
+	bool compactVertices;
+	CompactPositionDecode positionDecode;
+	unsigned int bufferBytes;
+	unsigned int uncompressedBufferBytes;
+	unsigned int loadCopyBytes;
 };
 
@@ -0,0 +1,165 @@
+#include "MeshBvh.h"
+
+#include <algorithm>
+
+using namespace DirectX;
+
+namespace
+{
+	// --------------------------------------------------------
+	// Ray vs. one triangle (Moller-Trumbore), for hits closer
+	// than "closest", which is updated along with the hit
+	// --------------------------------------------------------
+	inline bool IntersectTriangle(
+		const BvhTriangle& tri,
+		const XMFLOAT3& origin,
+		const XMFLOAT3& direction,
+		float& closest,
+		RayHit& hit)
+	{
+		const XMFLOAT3& e1 = tri.edge1;
+		const XMFLOAT3& e2 = tri.edge2;
+
+		// p = direction x edge2
+		float px = direction.y * e2.z - direction.z * e2.y;
+		float py = direction.z * e2.x - direction.x * e2.z;
+		float pz = direction.x * e2.y - direction.y * e2.x;
+		float determinant = e1.x * px + e1.y * py + e1.z * pz;
+		if (determinant == 0.0f)
+			return false;	// Parallel to the triangle
+		float inverse = 1.0f / determinant;
+
+		float sx = origin.x - tri.corner.x;
+		float sy = origin.y - tri.corner.y;
+		float sz = origin.z - tri.corner.z;
+		float u = (sx * px + sy * py + sz * pz) * inverse;
+		if (u < 0.0f || u > 1.0f)
+			return false;
+
+		// q = s x edge1
+		float qx = sy * e1.z - sz * e1.y;
+		float qy = sz * e1.x - sx * e1.z;
+		float qz = sx * e1.y - sy * e1.x;
+		float v = (direction.x * qx + direction.y * qy + direction.z * qz) * inverse;
+		if (v < 0.0f || u + v > 1.0f)
+			return false;
+
+		float t = (e2.x * qx + e2.y * qy + e2.z * qz) * inverse;
+		if (t < 0.0f || t >= closest)
+			return false;
+
+		closest = t;
+		hit.distance = t;
+		hit.triangle = tri.triangle;
+		hit.u = u;
+		hit.v = v;
+		return true;
+	}
+}
+
+MeshBvh::MeshBvh()
+	:
+	depth(0)
+{
+}
+
+void MeshBvh::Build(
+	const XMFLOAT3* positions,
+	size_t stride,
+	const unsigned int* indices,
+	size_t indexCount)
+{
+	nodes.clear();
+	triangles.clear();
+	depth = 0;
+
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	auto positionAt = [=](unsigned int i) -> const XMFLOAT3&
+	{
+		return *(const XMFLOAT3*)((const char*)positions + i * stride);
+	};
+
+	std::vector<BvhBox> boxes(triangleCount);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		const XMFLOAT3& a = positionAt(indices[t * 3 + 0]);
+		const XMFLOAT3& b = positionAt(indices[t * 3 + 1]);
+		const XMFLOAT3& c = positionAt(indices[t * 3 + 2]);
+		boxes[t].min = XMFLOAT3(std::min(std::min(a.x, b.x), c.x), std::min(std::min(a.y, b.y), c.y), std::min(std::min(a.z, b.z), c.z));
+		boxes[t].max = XMFLOAT3(std::max(std::max(a.x, b.x), c.x), std::max(std::max(a.y, b.y), c.y), std::max(std::max(a.z, b.z), c.z));
+	}
+
+	std::vector<unsigned int> order;
+	depth = BuildBvh(boxes, bvhMaxLeafTriangles, nodes, order);
+
+	// Triangles in leaf order
+	triangles.resize(triangleCount);
+	for (size_t i = 0; i < triangleCount; i++)
+	{
+		unsigned int t = order[i];
+		const XMFLOAT3& a = positionAt(indices[t * 3 + 0]);
+		const XMFLOAT3& b = positionAt(indices[t * 3 + 1]);
+		const XMFLOAT3& c = positionAt(indices[t * 3 + 2]);
+		BvhTriangle& tri = triangles[i];
+		tri.corner = a;
+		tri.edge1 = XMFLOAT3(b.x - a.x, b.y - a.y, b.z - a.z);
+		tri.edge2 = XMFLOAT3(c.x - a.x, c.y - a.y, c.z - a.z);
+		tri.triangle = t;
+	}
+}
+
+bool MeshBvh::Raycast(const XMFLOAT3& origin, const XMFLOAT3& direction, float maxDistance, RayHit& hit)
+{
+	return Traverse<false>(origin, direction, maxDistance, hit);
+}
+
+bool MeshBvh::IsOccluded(const XMFLOAT3& origin, const XMFLOAT3& direction, float maxDistance)
+{
+	RayHit hit;
+	return Traverse<true>(origin, direction, maxDistance, hit);
+}
+
+template <bool anyHit>
+bool MeshBvh::Traverse(const XMFLOAT3& origin, const XMFLOAT3& direction, float maxDistance, RayHit& hit)
+{
+	auto testLeaf = [&](unsigned int first, unsigned int count, float& closest)
+	{
+		bool found = false;
+		for (unsigned int t = first; t < first + count; t++)
+		{
+			if (IntersectTriangle(triangles[t], origin, direction, closest, hit))
+			{
+				found = true;
+				if (anyHit)
+					break;
+			}
+		}
+		return found;
+	};
+
+	float closest = maxDistance;
+	return TraverseBvh<anyHit>(nodes, origin, direction, closest, testLeaf);
+}
+
+unsigned int MeshBvh::GetNodeCount()
+{
+	return (unsigned int)nodes.size();
+}
+
+unsigned int MeshBvh::GetTriangleCount()
+{
+	return (unsigned int)triangles.size();
+}
+
+unsigned int MeshBvh::GetDepth()
+{
+	return depth;
+}
+
+size_t MeshBvh::GetMemoryBytes()
+{
+	return nodes.size() * sizeof(BvhNode) + triangles.size() * sizeof(BvhTriangle);
+}
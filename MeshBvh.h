@@ -0,0 +1,88 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include <DirectXMath.h>
+#include "Bvh.h"
+
+// Most triangles a single BVH leaf holds
+const unsigned int bvhMaxLeafTriangles = 4;
+
+// --------------------------------------------------------
+// The closest triangle a ray hit
+//
+// - The hit point is origin + direction * distance, so the
+//   distance is in units of the direction's length
+// - u and v are barycentrics, so the hit point is also
+//   (1 - u - v) * corner0 + u * corner1 + v * corner2
+// --------------------------------------------------------
+struct RayHit
+{
+	float distance;
+	unsigned int triangle;	// Which triangle (its first index / 3)
+	float u;
+	float v;
+};
+
+// A triangle, stored the way the ray test wants it
+struct BvhTriangle
+{
+	DirectX::XMFLOAT3 corner;	// Corner 0
+	DirectX::XMFLOAT3 edge1;	// Corner 1 - corner 0
+	DirectX::XMFLOAT3 edge2;	// Corner 2 - corner 0
+	unsigned int triangle;		// Index in the original triangle list
+};
+
+// --------------------------------------------------------
+// Bounding volume hierarchy over a mesh's triangles, for
+// ray queries on the CPU (picking, baking, probes)
+//
+// - Built with BuildBvh() over the triangles' boxes
+// - Triangles are copied into leaf order, so each leaf's
+//   triangles sit next to each other in memory
+// - Rays hit both sides of every triangle
+// --------------------------------------------------------
+class MeshBvh
+{
+public:
+	MeshBvh();
+
+	// Builds over a triangle list whose positions are stride
+	// bytes apart, replacing anything built before
+	void Build(
+		const DirectX::XMFLOAT3* positions,
+		size_t stride,
+		const unsigned int* indices,
+		size_t indexCount);
+
+	// Finds the closest hit nearer than maxDistance (in units of
+	// the direction's length), which needn't be normalized
+	bool Raycast(
+		const DirectX::XMFLOAT3& origin,
+		const DirectX::XMFLOAT3& direction,
+		float maxDistance,
+		RayHit& hit);
+
+	// Is anything nearer than maxDistance?  Stops at the first
+	// hit it finds, which is cheaper than finding the closest
+	bool IsOccluded(
+		const DirectX::XMFLOAT3& origin,
+		const DirectX::XMFLOAT3& direction,
+		float maxDistance);
+
+	unsigned int GetNodeCount();
+	unsigned int GetTriangleCount();
+	unsigned int GetDepth();
+	size_t GetMemoryBytes();
+
+private:
+	template <bool anyHit>
+	bool Traverse(
+		const DirectX::XMFLOAT3& origin,
+		const DirectX::XMFLOAT3& direction,
+		float maxDistance,
+		RayHit& hit);
+
+	std::vector<BvhNode> nodes;
+	std::vector<BvhTriangle> triangles;
+	unsigned int depth;
+};
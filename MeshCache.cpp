@@ -0,0 +1,77 @@
+#include "MeshCache.h"
+#include "PathHelpers.h"
+
+#include <cstdio>
+
+MeshCache::MeshCache(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	std::shared_ptr<GeometryArena> arena)
+	:
+	device(device),
+	context(context),
+	arena(arena)
+{
+	stats = {};
+}
+
+// --------------------------------------------------------
+// Returns the mesh for this file and these options, only
+// creating it if no one is using one already
+// --------------------------------------------------------
+std::shared_ptr<Mesh> MeshCache::Load(const wchar_t* objFile, MeshLoadOptions options)
+{
+	std::wstring key = NormalizePath(objFile) + L"|" + std::to_wstring(GetMeshOptionsKey(options));
+
+	Entry& entry = entries[key];
+	std::shared_ptr<Mesh> mesh = entry.mesh.lock();
+	if (mesh)
+	{
+		entry.hits++;
+		stats.hits++;
+		stats.bytesSaved += mesh->GetBufferBytes();
+		return mesh;
+	}
+
+	mesh = std::make_shared<Mesh>(objFile, device, context, options, arena);
+	entry.mesh = mesh;
+	entry.misses++;
+	stats.misses++;
+	return mesh;
+}
+
+MeshCacheStats MeshCache::GetStats()
+{
+	return stats;
+}
+
+std::string MeshCache::GetReport()
+{
+	std::string report;
+	char line[512];
+	for (auto& pair : entries)
+	{
+		// Trim the key down to the file name and options
+		const std::wstring& key = pair.first;
+		size_t slash = key.find_last_of(L'\\');
+		std::wstring name = slash == std::wstring::npos ? key : key.substr(slash + 1);
+
+		std::shared_ptr<Mesh> mesh = pair.second.mesh.lock();
+		sprintf_s(line, "%-28ls loads %2u  hits %2u  users %2ld  %8u bytes (%8u uncompressed, %8u copied on load)\n",
+			name.c_str(),
+			pair.second.misses,
+			pair.second.hits,
+			mesh ? mesh.use_count() - 1 : 0L,
+			mesh ? mesh->GetBufferBytes() : 0u,
+			mesh ? mesh->GetUncompressedBufferBytes() : 0u,
+			mesh ? mesh->GetLoadCopyBytes() : 0u);
+		report += line;
+	}
+
+	sprintf_s(line, "Hits %u, misses %u, %.1f KB of buffers saved",
+		stats.hits,
+		stats.misses,
+		stats.bytesSaved / 1024.0);
+	report += line;
+	return report;
+}
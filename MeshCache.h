@@ -0,0 +1,65 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <d3d11.h>
+#include <wrl/client.h>
+#include "Mesh.h"
+
+// --------------------------------------------------------
+// What the cache has saved so far
+// --------------------------------------------------------
+struct MeshCacheStats
+{
+	unsigned int hits;				// Loads handed an existing mesh
+	unsigned int misses;			// Loads that created a new mesh
+	unsigned long long bytesSaved;	// Buffer memory the hits didn't allocate
+};
+
+// --------------------------------------------------------
+// Hands out shared Meshes, so a model file that's used more
+// than once is only loaded (and uploaded to the GPU) once
+//
+// - Meshes are keyed by their normalized path plus load
+//   options, so "a/../cube.obj" and "CUBE.OBJ" are one mesh,
+//   but a compact and a full copy of it are two
+// - The cache only holds weak references: a mesh is freed
+//   once nothing else uses it, and is loaded again if it's
+//   asked for after that
+// - With an arena, every mesh it loads goes into the arena's
+//   shared buffers
+// --------------------------------------------------------
+class MeshCache
+{
+public:
+	MeshCache(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		std::shared_ptr<GeometryArena> arena = nullptr);
+
+	std::shared_ptr<Mesh> Load(const wchar_t* objFile, MeshLoadOptions options = MeshLoadOptions());
+
+	MeshCacheStats GetStats();
+
+	// One line per cached mesh with its hits and users,
+	// followed by the totals
+	// - "Copied on load" is what the upload-only options (like
+	//   shortIndices and positionStream) converted on the CPU,
+	//   even on warm loads that could otherwise upload straight
+	//   from the cooked file
+	std::string GetReport();
+
+private:
+	struct Entry
+	{
+		std::weak_ptr<Mesh> mesh;
+		unsigned int hits;
+		unsigned int misses;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	std::shared_ptr<GeometryArena> arena;
+	std::unordered_map<std::wstring, Entry> entries;
+	MeshCacheStats stats;
+};
@@ -0,0 +1,652 @@
+#include "MeshCodec.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Every x64 CPU has SSE2, so only other targets (or a build that
+// defines MESH_CODEC_NO_SIMD) decode with the scalar loops
+#if (defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)) && !defined(MESH_CODEC_NO_SIMD)
+#define MESH_CODEC_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// First byte of each encoded buffer, so the wrong kind of
+	// data (or a future version of the format) is rejected
+	const unsigned char vertexCodecTag = 0xA0;
+	const unsigned char indexCodecTag = 0xE0;
+
+	// Vertices per block, and bytes per bit-packed group
+	const size_t vertexBlockSize = 256;
+	const size_t vertexGroupSize = 16;
+
+	// Encoded size of a group for each 2-bit group header (which
+	// stand for 0, 2, 4 and 8 bits per byte)
+	const size_t groupBytes[4] = { 0, 4, 8, 16 };
+
+	// Ages the FIFOs can refer to - code 15 means "none of them"
+	const unsigned int fifoSize = 16;
+	const unsigned char noEdge = 15;
+	const unsigned char explicitVertex = 15;
+
+	inline unsigned char Zigzag8(unsigned char delta)
+	{
+		return (unsigned char)((delta << 1) ^ (unsigned char)((signed char)delta >> 7));
+	}
+
+	inline unsigned char Unzigzag8(unsigned char value)
+	{
+		return (unsigned char)((value >> 1) ^ (unsigned char)-(value & 1));
+	}
+
+	inline unsigned int Zigzag32(unsigned int delta)
+	{
+		return (delta << 1) ^ (unsigned int)((int)delta >> 31);
+	}
+
+	inline unsigned int Unzigzag32(unsigned int value)
+	{
+		return (value >> 1) ^ (unsigned int)-(int)(value & 1);
+	}
+
+	// --------------------------------------------------------
+	// Vertex encoding
+	// --------------------------------------------------------
+
+	// Zigzagged differences for one byte of every vertex in a
+	// block, zero padded to whole groups, bit-packed onto "out"
+	void EncodeVertexChannel(const unsigned char* row, size_t paddedCount, std::vector<unsigned char>& out)
+	{
+		size_t groupCount = paddedCount / vertexGroupSize;
+		size_t headerStart = out.size();
+		out.resize(out.size() + (groupCount + 3) / 4, 0);
+
+		for (size_t g = 0; g < groupCount; g++)
+		{
+			const unsigned char* group = row + g * vertexGroupSize;
+			unsigned char largest = *std::max_element(group, group + vertexGroupSize);
+			unsigned char code = largest == 0 ? 0 : largest < 4 ? 1 : largest < 16 ? 2 : 3;
+			out[headerStart + g / 4] |= (unsigned char)(code << ((g % 4) * 2));
+
+			if (code == 1)
+			{
+				for (size_t i = 0; i < vertexGroupSize; i += 4)
+					out.push_back((unsigned char)((group[i] << 6) | (group[i + 1] << 4) | (group[i + 2] << 2) | group[i + 3]));
+			}
+			else if (code == 2)
+			{
+				for (size_t i = 0; i < vertexGroupSize; i += 2)
+					out.push_back((unsigned char)((group[i] << 4) | group[i + 1]));
+			}
+			else if (code == 3)
+			{
+				out.insert(out.end(), group, group + vertexGroupSize);
+			}
+		}
+	}
+
+	// --------------------------------------------------------
+	// Vertex decoding
+	// --------------------------------------------------------
+
+	// Unpacks one group into 16 bytes of "row"
+	inline void DecodeGroup(const unsigned char* data, unsigned char code, unsigned char* row)
+	{
+#ifdef MESH_CODEC_SSE2
+		__m128i result;
+		if (code == 0)
+		{
+			result = _mm_setzero_si128();
+		}
+		else if (code == 1)
+		{
+			int packed;
+			memcpy(&packed, data, sizeof(packed));
+			__m128i bits = _mm_cvtsi32_si128(packed);
+			__m128i mask = _mm_set1_epi8(3);
+			__m128i a = _mm_and_si128(_mm_srli_epi16(bits, 6), mask);
+			__m128i b = _mm_and_si128(_mm_srli_epi16(bits, 4), mask);
+			__m128i c = _mm_and_si128(_mm_srli_epi16(bits, 2), mask);
+			__m128i d = _mm_and_si128(bits, mask);
+			result = _mm_unpacklo_epi16(_mm_unpacklo_epi8(a, b), _mm_unpacklo_epi8(c, d));
+		}
+		else if (code == 2)
+		{
+			__m128i bits = _mm_loadl_epi64((const __m128i*)data);
+			__m128i mask = _mm_set1_epi8(15);
+			__m128i high = _mm_and_si128(_mm_srli_epi16(bits, 4), mask);
+			__m128i low = _mm_and_si128(bits, mask);
+			result = _mm_unpacklo_epi8(high, low);
+		}
+		else
+		{
+			result = _mm_loadu_si128((const __m128i*)data);
+		}
+		_mm_storeu_si128((__m128i*)row, result);
+#else
+		if (code == 0)
+		{
+			memset(row, 0, vertexGroupSize);
+		}
+		else if (code == 1)
+		{
+			for (size_t i = 0; i < vertexGroupSize; i += 4)
+			{
+				unsigned char bits = data[i / 4];
+				row[i] = bits >> 6;
+				row[i + 1] = (bits >> 4) & 3;
+				row[i + 2] = (bits >> 2) & 3;
+				row[i + 3] = bits & 3;
+			}
+		}
+		else if (code == 2)
+		{
+			for (size_t i = 0; i < vertexGroupSize; i += 2)
+			{
+				row[i] = data[i / 2] >> 4;
+				row[i + 1] = data[i / 2] & 15;
+			}
+		}
+		else
+		{
+			memcpy(row, data, vertexGroupSize);
+		}
+#endif
+	}
+
+	// Unpacks one channel of a block into its row, returning
+	// where the next channel starts, or null if it's cut short
+	const unsigned char* DecodeVertexChannel(
+		const unsigned char* data,
+		const unsigned char* end,
+		size_t paddedCount,
+		unsigned char* row)
+	{
+		size_t groupCount = paddedCount / vertexGroupSize;
+		size_t headerSize = (groupCount + 3) / 4;
+		if ((size_t)(end - data) < headerSize)
+			return 0;
+
+		const unsigned char* header = data;
+		data += headerSize;
+		for (size_t g = 0; g < groupCount; g++)
+		{
+			unsigned char code = (header[g / 4] >> ((g % 4) * 2)) & 3;
+			if ((size_t)(end - data) < groupBytes[code])
+				return 0;
+
+			DecodeGroup(data, code, row + g * vertexGroupSize);
+			data += groupBytes[code];
+		}
+		return data;
+	}
+
+#ifdef MESH_CODEC_SSE2
+	// --------------------------------------------------------
+	// Transposes a 16x16 byte matrix held as 16 rows
+	//
+	// - Interleaving row i with row i + 8 (low halves into row
+	//   2i, high halves into row 2i + 1) rotates the four bits
+	//   of each byte's row and column numbers by one place, so
+	//   doing it four times swaps rows and columns
+	// --------------------------------------------------------
+	inline void Transpose16x16(__m128i rows[16])
+	{
+		for (int pass = 0; pass < 4; pass++)
+		{
+			__m128i interleaved[16];
+			for (int i = 0; i < 8; i++)
+			{
+				interleaved[i * 2] = _mm_unpacklo_epi8(rows[i], rows[i + 8]);
+				interleaved[i * 2 + 1] = _mm_unpackhi_epi8(rows[i], rows[i + 8]);
+			}
+			for (int i = 0; i < 16; i++)
+				rows[i] = interleaved[i];
+		}
+	}
+
+	inline __m128i Unzigzag8(__m128i value)
+	{
+		__m128i half = _mm_and_si128(_mm_srli_epi16(value, 1), _mm_set1_epi8(0x7F));
+		__m128i sign = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(value, _mm_set1_epi8(1)));
+		return _mm_xor_si128(half, sign);
+	}
+#endif
+
+	// --------------------------------------------------------
+	// Turns a block's decoded rows back into vertices, adding
+	// each vertex's differences to the one before it
+	//
+	// - "rows" holds one row of vertexBlockSize bytes for each
+	//   byte of the vertex, rounded up to a multiple of 16 rows
+	//   (the extra rows are zero)
+	// - "previous" is the vertex before the block, and ends up
+	//   as the block's last vertex
+	// --------------------------------------------------------
+	void UntransposeBlock(
+		const unsigned char* rows,
+		size_t count,
+		size_t vertexSize,
+		unsigned char* previous,
+		unsigned char* vertices,
+		unsigned char* verticesEnd)
+	{
+#ifdef MESH_CODEC_SSE2
+		size_t chunkCount = (vertexSize + 15) / 16;
+		__m128i last[codecMaxVertexSize / 16];
+		for (size_t c = 0; c < chunkCount; c++)
+			last[c] = _mm_loadu_si128((const __m128i*)(previous + c * 16));
+
+		for (size_t first = 0; first < count; first += 16)
+		{
+			// Sixteen vertices' worth of each chunk of 16 bytes
+			__m128i tile[codecMaxVertexSize / 16][16];
+			for (size_t c = 0; c < chunkCount; c++)
+			{
+				for (int i = 0; i < 16; i++)
+					tile[c][i] = _mm_loadu_si128((const __m128i*)(rows + (c * 16 + i) * vertexBlockSize + first));
+				Transpose16x16(tile[c]);
+			}
+
+			// Full 16 byte stores spill into the next vertex, which
+			// overwrites them later - except past the very end
+			size_t end = std::min<size_t>(16, count - first);
+			for (size_t v = 0; v < end; v++)
+			{
+				unsigned char* vertex = vertices + (first + v) * vertexSize;
+				for (size_t c = 0; c < chunkCount; c++)
+				{
+					last[c] = _mm_add_epi8(last[c], Unzigzag8(tile[c][v]));
+					unsigned char* destination = vertex + c * 16;
+					if (destination + 16 <= verticesEnd)
+					{
+						_mm_storeu_si128((__m128i*)destination, last[c]);
+					}
+					else
+					{
+						unsigned char bytes[16];
+						_mm_storeu_si128((__m128i*)bytes, last[c]);
+						memcpy(destination, bytes, std::min<size_t>(16, vertexSize - c * 16));
+					}
+				}
+			}
+		}
+
+		for (size_t c = 0; c < chunkCount; c++)
+			_mm_storeu_si128((__m128i*)(previous + c * 16), last[c]);
+#else
+		for (size_t i = 0; i < count; i++)
+		{
+			unsigned char* vertex = vertices + i * vertexSize;
+			for (size_t k = 0; k < vertexSize; k++)
+			{
+				previous[k] = (unsigned char)(previous[k] + Unzigzag8(rows[k * vertexBlockSize + i]));
+				vertex[k] = previous[k];
+			}
+		}
+		(void)verticesEnd;
+#endif
+	}
+
+	// --------------------------------------------------------
+	// Index encoding
+	// --------------------------------------------------------
+
+	struct Edge
+	{
+		unsigned int a;
+		unsigned int b;
+	};
+
+	// The state both sides of the index codec keep in step
+	struct IndexFifos
+	{
+		Edge edges[fifoSize];
+		unsigned int vertices[fifoSize];
+		unsigned int edgeOffset;
+		unsigned int vertexOffset;
+		unsigned int next;	// The next vertex never used before
+		unsigned int last;	// The last vertex stored outright
+
+		IndexFifos()
+			:
+			edgeOffset(0),
+			vertexOffset(0),
+			next(0),
+			last(0)
+		{
+			// No real vertex is ~0, so these never match anything
+			for (unsigned int i = 0; i < fifoSize; i++)
+			{
+				edges[i].a = ~0u;
+				edges[i].b = ~0u;
+				vertices[i] = ~0u;
+			}
+		}
+
+		void PushEdge(unsigned int a, unsigned int b)
+		{
+			edges[edgeOffset % fifoSize].a = a;
+			edges[edgeOffset % fifoSize].b = b;
+			edgeOffset++;
+		}
+
+		void PushVertex(unsigned int v)
+		{
+			vertices[vertexOffset % fifoSize] = v;
+			vertexOffset++;
+		}
+
+		// Edge "age" (0 is the newest)
+		const Edge& GetEdge(unsigned int age)
+		{
+			return edges[(edgeOffset - 1 - age) % fifoSize];
+		}
+
+		// Vertex "age" (1 is the newest)
+		unsigned int GetVertex(unsigned int age)
+		{
+			return vertices[(vertexOffset - age) % fifoSize];
+		}
+
+		// How v is coded, which is also the state change that
+		// comes with it, so the decoder can follow along
+		unsigned char EncodeVertex(unsigned int v)
+		{
+			if (v == next)
+			{
+				next++;
+				PushVertex(v);
+				return 0;
+			}
+			for (unsigned int age = 1; age < explicitVertex; age++)
+			{
+				if (GetVertex(age) == v)
+					return (unsigned char)age;
+			}
+			PushVertex(v);
+			return explicitVertex;
+		}
+	};
+
+	void WriteVarint(unsigned int value, std::vector<unsigned char>& out)
+	{
+		while (value >= 0x80)
+		{
+			out.push_back((unsigned char)(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back((unsigned char)value);
+	}
+
+	// Outright vertices go in the data as the zigzagged
+	// difference from the last one
+	void WriteExplicitVertex(unsigned int v, IndexFifos& fifos, std::vector<unsigned char>& data)
+	{
+		WriteVarint(Zigzag32(v - fifos.last), data);
+		fifos.last = v;
+	}
+
+	// --------------------------------------------------------
+	// Index decoding
+	// --------------------------------------------------------
+
+	inline bool ReadVarint(const unsigned char*& data, const unsigned char* end, unsigned int& value)
+	{
+		value = 0;
+		for (int shift = 0; shift < 35; shift += 7)
+		{
+			if (data == end)
+				return false;
+			unsigned char byte = *data++;
+			value |= (unsigned int)(byte & 0x7F) << shift;
+			if (byte < 0x80)
+				return true;
+		}
+		return false;
+	}
+
+	inline bool DecodeVertex(
+		unsigned char code,
+		IndexFifos& fifos,
+		const unsigned char*& data,
+		const unsigned char* end,
+		unsigned int& v)
+	{
+		if (code == 0)
+		{
+			v = fifos.next++;
+			fifos.PushVertex(v);
+		}
+		else if (code < explicitVertex)
+		{
+			v = fifos.GetVertex(code);
+		}
+		else
+		{
+			unsigned int delta;
+			if (!ReadVarint(data, end, delta))
+				return false;
+			v = fifos.last + Unzigzag32(delta);
+			fifos.last = v;
+			fifos.PushVertex(v);
+		}
+		return true;
+	}
+}
+
+void EncodeVertexBuffer(
+	const void* vertices,
+	size_t vertexCount,
+	size_t vertexSize,
+	std::vector<unsigned char>& out)
+{
+	out.push_back(vertexCodecTag);
+
+	const unsigned char* bytes = (const unsigned char*)vertices;
+	unsigned char previous[codecMaxVertexSize] = {};
+	unsigned char row[vertexBlockSize];
+
+	for (size_t first = 0; first < vertexCount; first += vertexBlockSize)
+	{
+		size_t count = std::min(vertexBlockSize, vertexCount - first);
+		size_t paddedCount = (count + vertexGroupSize - 1) & ~(vertexGroupSize - 1);
+		const unsigned char* block = bytes + first * vertexSize;
+
+		for (size_t k = 0; k < vertexSize; k++)
+		{
+			unsigned char last = previous[k];
+			for (size_t i = 0; i < count; i++)
+			{
+				unsigned char value = block[i * vertexSize + k];
+				row[i] = Zigzag8((unsigned char)(value - last));
+				last = value;
+			}
+			memset(row + count, 0, paddedCount - count);
+			previous[k] = last;
+
+			EncodeVertexChannel(row, paddedCount, out);
+		}
+	}
+}
+
+bool DecodeVertexBuffer(
+	void* vertices,
+	size_t vertexCount,
+	size_t vertexSize,
+	const unsigned char* data,
+	size_t size)
+{
+	if (vertexSize == 0 || vertexSize > codecMaxVertexSize || size == 0 || data[0] != vertexCodecTag)
+		return false;
+
+	const unsigned char* end = data + size;
+	data++;
+
+	// Rows for the padding bytes past vertexSize stay zero
+	size_t rowCount = (vertexSize + 15) & ~(size_t)15;
+	std::vector<unsigned char> rows(rowCount * vertexBlockSize, 0);
+	unsigned char previous[codecMaxVertexSize] = {};
+	unsigned char* output = (unsigned char*)vertices;
+	unsigned char* outputEnd = output + vertexCount * vertexSize;
+
+	for (size_t first = 0; first < vertexCount; first += vertexBlockSize)
+	{
+		size_t count = std::min(vertexBlockSize, vertexCount - first);
+		size_t paddedCount = (count + vertexGroupSize - 1) & ~(vertexGroupSize - 1);
+
+		for (size_t k = 0; k < vertexSize && data; k++)
+			data = DecodeVertexChannel(data, end, paddedCount, &rows[k * vertexBlockSize]);
+		if (!data)
+			return false;
+
+		UntransposeBlock(&rows[0], count, vertexSize, previous, output + first * vertexSize, outputEnd);
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Each triangle is rotated (if it can be) so its first edge is
+// in the edge FIFO, giving a code byte of:
+//   - The edge's age in the high 4 bits, and the third
+//     vertex's code in the low 4
+// Otherwise it gets a code byte and an extra byte in the data:
+//   - 15 in the high 4 bits, the first vertex's code in the low
+//   - The second vertex's code in the high 4 bits, the third's
+//     in the low
+// A vertex code is 0 for the next new vertex, a FIFO age from
+// 1 to 14, or 15 for a vertex stored outright in the data
+// --------------------------------------------------------
+void EncodeIndexBuffer(
+	const unsigned int* indices,
+	size_t indexCount,
+	std::vector<unsigned char>& out)
+{
+	size_t triangleCount = indexCount / 3;
+	out.push_back(indexCodecTag);
+	size_t codeStart = out.size();
+	out.resize(codeStart + triangleCount);
+
+	std::vector<unsigned char> data;
+	data.reserve(triangleCount);
+	IndexFifos fifos;
+
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		unsigned int a = indices[t * 3 + 0];
+		unsigned int b = indices[t * 3 + 1];
+		unsigned int c = indices[t * 3 + 2];
+
+		// Look for a shared edge, in any of the three rotations
+		int edgeAge = -1;
+		for (unsigned int age = 0; age < noEdge && edgeAge < 0; age++)
+		{
+			const Edge& edge = fifos.GetEdge(age);
+			unsigned int rotated[3] = { a, b, c };
+			for (int r = 0; r < 3; r++)
+			{
+				if (edge.a == rotated[r] && edge.b == rotated[(r + 1) % 3])
+				{
+					a = rotated[r];
+					b = rotated[(r + 1) % 3];
+					c = rotated[(r + 2) % 3];
+					edgeAge = (int)age;
+					break;
+				}
+			}
+		}
+
+		if (edgeAge >= 0)
+		{
+			unsigned char code = fifos.EncodeVertex(c);
+			out[codeStart + t] = (unsigned char)((edgeAge << 4) | code);
+			if (code == explicitVertex)
+				WriteExplicitVertex(c, fifos, data);
+
+			// The two new edges, the way a neighbor would see them
+			fifos.PushEdge(c, b);
+			fifos.PushEdge(a, c);
+		}
+		else
+		{
+			unsigned char codeA = fifos.EncodeVertex(a);
+			unsigned char codeB = fifos.EncodeVertex(b);
+			unsigned char codeC = fifos.EncodeVertex(c);
+			out[codeStart + t] = (unsigned char)((noEdge << 4) | codeA);
+			data.push_back((unsigned char)((codeB << 4) | codeC));
+			if (codeA == explicitVertex)
+				WriteExplicitVertex(a, fifos, data);
+			if (codeB == explicitVertex)
+				WriteExplicitVertex(b, fifos, data);
+			if (codeC == explicitVertex)
+				WriteExplicitVertex(c, fifos, data);
+
+			fifos.PushEdge(b, a);
+			fifos.PushEdge(c, b);
+			fifos.PushEdge(a, c);
+		}
+	}
+
+	out.insert(out.end(), data.begin(), data.end());
+}
+
+bool DecodeIndexBuffer(
+	unsigned int* indices,
+	size_t indexCount,
+	size_t vertexCount,
+	const unsigned char* data,
+	size_t size)
+{
+	size_t triangleCount = indexCount / 3;
+	if (indexCount % 3 != 0 || size < 1 + triangleCount || data[0] != indexCodecTag)
+		return false;
+
+	const unsigned char* codes = data + 1;
+	const unsigned char* extra = codes + triangleCount;
+	const unsigned char* end = data + size;
+	IndexFifos fifos;
+
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		unsigned char code = codes[t];
+		unsigned char edgeAge = code >> 4;
+		unsigned int a;
+		unsigned int b;
+		unsigned int c;
+
+		if (edgeAge != noEdge)
+		{
+			const Edge& edge = fifos.GetEdge(edgeAge);
+			a = edge.a;
+			b = edge.b;
+			if (!DecodeVertex(code & 15, fifos, extra, end, c))
+				return false;
+
+			fifos.PushEdge(c, b);
+			fifos.PushEdge(a, c);
+		}
+		else
+		{
+			if (extra == end)
+				return false;
+			unsigned char codesBC = *extra++;
+			if (!DecodeVertex(code & 15, fifos, extra, end, a) ||
+				!DecodeVertex(codesBC >> 4, fifos, extra, end, b) ||
+				!DecodeVertex(codesBC & 15, fifos, extra, end, c))
+				return false;
+
+			fifos.PushEdge(b, a);
+			fifos.PushEdge(c, b);
+			fifos.PushEdge(a, c);
+		}
+
+		if (a >= vertexCount || b >= vertexCount || c >= vertexCount)
+			return false;
+
+		indices[t * 3 + 0] = a;
+		indices[t * 3 + 1] = b;
+		indices[t * 3 + 2] = c;
+	}
+	return true;
+}
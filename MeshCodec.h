@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// Largest vertex, in bytes, the vertex codec handles
+const size_t codecMaxVertexSize = 256;
+
+// --------------------------------------------------------
+// Lossless compression for vertex and index buffers, used
+// for cooked .mesh files (in the spirit of meshoptimizer's
+// vertex and index codecs)
+//
+// Vertices are encoded in blocks of up to 256:
+//  - Each vertex is subtracted from the one before it, byte
+//    by byte, and each difference is zigzagged so small
+//    negative ones become small positive ones
+//  - The differences are transposed, so byte 0 of every
+//    vertex in the block comes first, then byte 1, and so on,
+//    which puts similar bytes (like every position's highest
+//    byte) next to each other
+//  - Each run of 16 transposed bytes is stored with 0, 2, 4
+//    or 8 bits per byte, whichever is the fewest that fit
+//  - Decoding unpacks with SSE2 where it's available, then
+//    transposes back 16 vertices at a time
+//
+// Triangles are encoded one at a time, most in a single byte:
+//  - Triangles that share an edge with one of the last 15
+//    edges seen only need that edge's age and a third vertex
+//  - A vertex is either the next one never used before, one
+//    of the last 14 new vertices, or stored outright as the
+//    difference from the last vertex stored outright
+//  - Triangles keep their order, but each one's corners may
+//    be rotated (the winding stays the same)
+//
+// Both work best on buffers that went through OptimizeMesh()
+// --------------------------------------------------------
+
+// Appends the encoded vertices to "out"
+// - vertexSize can't be more than codecMaxVertexSize
+void EncodeVertexBuffer(
+	const void* vertices,
+	size_t vertexCount,
+	size_t vertexSize,
+	std::vector<unsigned char>& out);
+
+// Decodes exactly vertexCount vertices from the first "size"
+// bytes of data, returning false if they're corrupt or cut
+// short (anything after the vertices is ignored)
+bool DecodeVertexBuffer(
+	void* vertices,
+	size_t vertexCount,
+	size_t vertexSize,
+	const unsigned char* data,
+	size_t size);
+
+// Appends the encoded triangle list to "out"
+// - indexCount must be a multiple of 3
+void EncodeIndexBuffer(
+	const unsigned int* indices,
+	size_t indexCount,
+	std::vector<unsigned char>& out);
+
+// Decodes exactly indexCount indices, returning false if the
+// data is corrupt, cut short or names a vertex that isn't
+// below vertexCount
+bool DecodeIndexBuffer(
+	unsigned int* indices,
+	size_t indexCount,
+	size_t vertexCount,
+	const unsigned char* data,
+	size_t size);
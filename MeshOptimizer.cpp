@@ -0,0 +1,477 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// Size of the LRU cache modeled by the vertex cache optimizer.
+	// Bigger than most real caches on purpose, as recommended by
+	// Forsyth, so the order degrades gracefully on any hardware.
+	const int forsythCacheSize = 32;
+
+	// Scores for vertices with at most this many triangles left
+	// are looked up; anything higher is computed on the fly
+	const unsigned int forsythValenceTableSize = 32;
+
+	// Marks "no triangle" and "vertex not yet remapped"
+	const unsigned int noIndex = 0xFFFFFFFF;
+
+	// --------------------------------------------------------
+	// Precomputed pieces of Forsyth's vertex score
+	//
+	// - Vertices near the front of the cache score higher, except
+	//   for the three used by the very last triangle, which get a
+	//   fixed lower score so we don't just walk along a strip
+	// - Vertices with few triangles left get a boost, so lone
+	//   triangles are finished off rather than left behind
+	// --------------------------------------------------------
+	struct ForsythScoreTables
+	{
+		float cache[forsythCacheSize];
+		float valence[forsythValenceTableSize];
+
+		ForsythScoreTables()
+		{
+			for (int i = 0; i < forsythCacheSize; i++)
+			{
+				cache[i] = i < 3 ?
+					0.75f :
+					powf(1.0f - (i - 3) / (float)(forsythCacheSize - 3), 1.5f);
+			}
+
+			valence[0] = 0.0f;
+			for (unsigned int i = 1; i < forsythValenceTableSize; i++)
+				valence[i] = 2.0f * powf((float)i, -0.5f);
+		}
+	};
+
+	float ForsythVertexScore(const ForsythScoreTables& tables, int cachePosition, unsigned int remainingTriangles)
+	{
+		// Vertices with nothing left to draw are never wanted
+		if (remainingTriangles == 0)
+			return -1.0f;
+
+		float score = cachePosition >= 0 ? tables.cache[cachePosition] : 0.0f;
+		score += remainingTriangles < forsythValenceTableSize ?
+			tables.valence[remainingTriangles] :
+			2.0f * powf((float)remainingTriangles, -0.5f);
+		return score;
+	}
+}
+
+// --------------------------------------------------------
+// Simulates a FIFO post-transform vertex cache
+//
+// - Rather than actually shuffling a queue, each vertex
+//   remembers the "time" (miss count) it entered the cache.
+//   It's still cached if fewer than cacheSize misses have
+//   happened since then.
+// - ACMR ranges from 0.5 (ideal for a large grid) to 3.0
+//   (no reuse at all); ATVR is 1.0 when every vertex is
+//   transformed exactly once
+// --------------------------------------------------------
+VertexCacheStats AnalyzeVertexCache(
+	const unsigned int* indices,
+	size_t indexCount,
+	size_t vertexCount,
+	unsigned int cacheSize)
+{
+	VertexCacheStats stats = {};
+	if (indexCount == 0 || vertexCount == 0)
+		return stats;
+
+	std::vector<unsigned int> timestamps(vertexCount, 0);
+	unsigned int time = cacheSize + 1;
+
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		unsigned int v = indices[i];
+		if (time - timestamps[v] > cacheSize)
+		{
+			timestamps[v] = time++;
+			stats.transformedVertices++;
+		}
+	}
+
+	stats.hitRate = 1.0f - (float)stats.transformedVertices / indexCount;
+	stats.acmr = (float)stats.transformedVertices / (indexCount / 3);
+	stats.atvr = (float)stats.transformedVertices / vertexCount;
+	return stats;
+}
+
+// --------------------------------------------------------
+// Tom Forsyth's linear-speed vertex cache optimization
+// - https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+//
+// Greedily emits the highest scoring triangle, where a
+// triangle's score is the sum of its vertices' scores.  Only
+// triangles touching the (modeled) cache can change score,
+// so only those are considered after each step.
+// --------------------------------------------------------
+void OptimizeVertexCache(
+	unsigned int* destination,
+	const unsigned int* indices,
+	size_t indexCount,
+	size_t vertexCount)
+{
+	static const ForsythScoreTables tables;
+
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Triangles that use each vertex, as one flat array where
+	// vertex v's triangles start at adjacencyOffsets[v].  Emitted
+	// triangles are swapped to the end of each vertex's range.
+	std::vector<unsigned int> remainingTriangles(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		remainingTriangles[indices[i]]++;
+
+	std::vector<unsigned int> adjacencyOffsets(vertexCount);
+	unsigned int offset = 0;
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		adjacencyOffsets[v] = offset;
+		offset += remainingTriangles[v];
+	}
+
+	std::vector<unsigned int> adjacency(triangleCount * 3);
+	std::vector<unsigned int> fill(adjacencyOffsets);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+
+	// Starting scores, with an empty cache
+	std::vector<int> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		vertexScores[v] = ForsythVertexScore(tables, -1, remainingTriangles[v]);
+
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	unsigned int bestTriangle = 0;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		const unsigned int* tri = indices + t * 3;
+		triangleScores[t] = vertexScores[tri[0]] + vertexScores[tri[1]] + vertexScores[tri[2]];
+		if (triangleScores[t] > triangleScores[bestTriangle])
+			bestTriangle = (unsigned int)t;
+	}
+
+	// The modeled LRU cache, with room for the three vertices
+	// pushed in before the oldest ones fall off the end
+	unsigned int cache[forsythCacheSize + 3];
+	int cacheCount = 0;
+	size_t nextUnemitted = 0;
+
+	for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+	{
+		// Nothing in the cache has triangles left, so
+		// just start again from the next one in the file
+		if (bestTriangle == noIndex)
+		{
+			while (emitted[nextUnemitted])
+				nextUnemitted++;
+			bestTriangle = (unsigned int)nextUnemitted;
+		}
+
+		const unsigned int* tri = indices + (size_t)bestTriangle * 3;
+		destination[emittedCount * 3 + 0] = tri[0];
+		destination[emittedCount * 3 + 1] = tri[1];
+		destination[emittedCount * 3 + 2] = tri[2];
+		emitted[bestTriangle] = true;
+
+		// Take the triangle out of each of its vertices' lists
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int* list = &adjacency[adjacencyOffsets[tri[k]]];
+			unsigned int& count = remainingTriangles[tri[k]];
+			for (unsigned int i = 0; i < count; i++)
+			{
+				if (list[i] == bestTriangle)
+				{
+					std::swap(list[i], list[count - 1]);
+					count--;
+					break;
+				}
+			}
+		}
+
+		// The triangle's vertices move to the front of the cache,
+		// followed by everything that was already there
+		unsigned int newCache[forsythCacheSize + 3];
+		int newCount = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			if (std::find(newCache, newCache + newCount, tri[k]) == newCache + newCount)
+				newCache[newCount++] = tri[k];
+		}
+		for (int i = 0; i < cacheCount; i++)
+		{
+			if (cache[i] != tri[0] && cache[i] != tri[1] && cache[i] != tri[2])
+				newCache[newCount++] = cache[i];
+		}
+
+		// Rescore everything that's in (or just fell out of) the cache,
+		// pushing the change in score onto the vertices' triangles
+		for (int i = 0; i < newCount; i++)
+		{
+			unsigned int v = newCache[i];
+			cachePositions[v] = i < forsythCacheSize ? i : -1;
+
+			float score = ForsythVertexScore(tables, cachePositions[v], remainingTriangles[v]);
+			float change = score - vertexScores[v];
+			vertexScores[v] = score;
+
+			const unsigned int* list = &adjacency[adjacencyOffsets[v]];
+			for (unsigned int j = 0; j < remainingTriangles[v]; j++)
+				triangleScores[list[j]] += change;
+		}
+
+		// The next triangle is the best one touching the cache
+		cacheCount = std::min(newCount, forsythCacheSize);
+		bestTriangle = noIndex;
+		float bestScore = -1.0f;
+		for (int i = 0; i < cacheCount; i++)
+		{
+			unsigned int v = newCache[i];
+			cache[i] = v;
+
+			const unsigned int* list = &adjacency[adjacencyOffsets[v]];
+			for (unsigned int j = 0; j < remainingTriangles[v]; j++)
+			{
+				if (triangleScores[list[j]] > bestScore)
+				{
+					bestScore = triangleScores[list[j]];
+					bestTriangle = list[j];
+				}
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Overdraw optimization, after Sander, Nehab and Barczak's
+// "Fast Triangle Reordering for Vertex Locality and Reduced
+// Overdraw" (the same approach meshoptimizer uses)
+//
+// 1. Split the cache-optimized triangles into clusters, first
+//    wherever the FIFO cache would be cold anyway (all three
+//    vertices miss) and then wherever a cluster's own ACMR is
+//    already within the threshold of its parent's
+// 2. Sort the clusters so the ones facing away from the mesh's
+//    center (which tend to occlude everything else) come first
+//
+// Triangles inside each cluster keep their order, so the cache
+// efficiency only suffers at the cluster boundaries.
+// --------------------------------------------------------
+void OptimizeOverdraw(
+	unsigned int* destination,
+	const unsigned int* indices,
+	size_t indexCount,
+	const Vertex* vertices,
+	size_t vertexCount,
+	float threshold)
+{
+	const unsigned int cacheSize = 16;
+
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Same FIFO model as AnalyzeVertexCache(), where bumping the
+	// clock by more than the cache size flushes everything at once
+	std::vector<unsigned int> timestamps(vertexCount, 0);
+	unsigned int time = cacheSize + 1;
+	auto triangleMisses = [&](size_t t)
+	{
+		unsigned int misses = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int v = indices[t * 3 + k];
+			if (time - timestamps[v] > cacheSize)
+			{
+				timestamps[v] = time++;
+				misses++;
+			}
+		}
+		return misses;
+	};
+	auto flushCache = [&]() { time += cacheSize + 1; };
+
+	// Hard boundaries, where starting over costs nothing
+	std::vector<size_t> hardStarts;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		if (triangleMisses(t) == 3 || t == 0)
+			hardStarts.push_back(t);
+	}
+	hardStarts.push_back(triangleCount);
+
+	// Soft boundaries, where starting over costs a little
+	std::vector<size_t> clusterStarts;
+	for (size_t h = 0; h + 1 < hardStarts.size(); h++)
+	{
+		size_t start = hardStarts[h];
+		size_t end = hardStarts[h + 1];
+
+		flushCache();
+		unsigned int hardMisses = 0;
+		for (size_t t = start; t < end; t++)
+			hardMisses += triangleMisses(t);
+		float acmrThreshold = threshold * hardMisses / (end - start);
+
+		flushCache();
+		clusterStarts.push_back(start);
+		size_t clusterStart = start;
+		unsigned int clusterMisses = 0;
+		for (size_t t = start; t + 1 < end; t++)
+		{
+			clusterMisses += triangleMisses(t);
+			if (clusterMisses <= acmrThreshold * (t + 1 - clusterStart))
+			{
+				clusterStarts.push_back(t + 1);
+				clusterStart = t + 1;
+				clusterMisses = 0;
+				flushCache();
+			}
+		}
+	}
+	size_t clusterCount = clusterStarts.size();
+	clusterStarts.push_back(triangleCount);
+
+	// Area weighted centroid and normal of every cluster, plus
+	// the centroid of the whole mesh
+	std::vector<float> clusterData(clusterCount * 6, 0.0f);
+	float meshCentroid[3] = { 0, 0, 0 };
+	float meshArea = 0.0f;
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		float* centroid = &clusterData[c * 6];
+		float* normal = centroid + 3;
+		float clusterArea = 0.0f;
+		for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++)
+		{
+			const DirectX::XMFLOAT3& a = vertices[indices[t * 3 + 0]].position;
+			const DirectX::XMFLOAT3& b = vertices[indices[t * 3 + 1]].position;
+			const DirectX::XMFLOAT3& d = vertices[indices[t * 3 + 2]].position;
+
+			// With our clockwise front faces this points outward,
+			// and its length is twice the triangle's area
+			float e1[3] = { b.x - a.x, b.y - a.y, b.z - a.z };
+			float e2[3] = { d.x - a.x, d.y - a.y, d.z - a.z };
+			float n[3] = {
+				e1[1] * e2[2] - e1[2] * e2[1],
+				e1[2] * e2[0] - e1[0] * e2[2],
+				e1[0] * e2[1] - e1[1] * e2[0] };
+			float area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+			centroid[0] += (a.x + b.x + d.x) * area;
+			centroid[1] += (a.y + b.y + d.y) * area;
+			centroid[2] += (a.z + b.z + d.z) * area;
+			normal[0] += n[0];
+			normal[1] += n[1];
+			normal[2] += n[2];
+			clusterArea += area;
+		}
+
+		for (int k = 0; k < 3; k++)
+			meshCentroid[k] += centroid[k];
+		meshArea += clusterArea;
+
+		float scale = clusterArea > 0.0f ? 1.0f / (clusterArea * 3.0f) : 0.0f;
+		for (int k = 0; k < 3; k++)
+			centroid[k] *= scale;
+	}
+
+	float meshScale = meshArea > 0.0f ? 1.0f / (meshArea * 3.0f) : 0.0f;
+	for (int k = 0; k < 3; k++)
+		meshCentroid[k] *= meshScale;
+
+	// How much each cluster faces away from the middle of the mesh
+	std::vector<float> sortKeys(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+	{
+		const float* centroid = &clusterData[c * 6];
+		const float* normal = centroid + 3;
+		float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		float scale = length > 0.0f ? 1.0f / length : 0.0f;
+		sortKeys[c] =
+			((centroid[0] - meshCentroid[0]) * normal[0] +
+			(centroid[1] - meshCentroid[1]) * normal[1] +
+			(centroid[2] - meshCentroid[2]) * normal[2]) * scale;
+	}
+
+	// Stable, so equal keys keep their (cache friendly) order
+	std::vector<unsigned int> order(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++)
+		order[c] = (unsigned int)c;
+	std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b)
+	{
+		return sortKeys[a] > sortKeys[b];
+	});
+
+	size_t written = 0;
+	for (unsigned int c : order)
+	{
+		for (size_t i = clusterStarts[c] * 3; i < clusterStarts[c + 1] * 3; i++)
+			destination[written++] = indices[i];
+	}
+}
+
+// --------------------------------------------------------
+// Puts vertices in the order the GPU will first fetch them,
+// so reading the vertex buffer walks forward through memory
+// --------------------------------------------------------
+size_t OptimizeVertexFetch(
+	Vertex* vertices,
+	unsigned int* indices,
+	size_t indexCount,
+	size_t vertexCount)
+{
+	std::vector<Vertex> original(vertices, vertices + vertexCount);
+	std::vector<unsigned int> remap(vertexCount, noIndex);
+
+	size_t nextVertex = 0;
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		unsigned int& newIndex = remap[indices[i]];
+		if (newIndex == noIndex)
+		{
+			newIndex = (unsigned int)nextVertex;
+			vertices[nextVertex++] = original[indices[i]];
+		}
+		indices[i] = newIndex;
+	}
+	return nextVertex;
+}
+
+void OptimizeMesh(
+	std::vector<Vertex>& vertices,
+	std::vector<unsigned int>& indices,
+	const MeshLod* lods,
+	size_t lodCount)
+{
+	if (indices.empty() || vertices.empty())
+		return;
+
+	// No LODs is the same as one LOD covering everything
+	MeshLod all = { 0, (unsigned int)indices.size(), 0.0f };
+	if (lodCount == 0)
+	{
+		lods = &all;
+		lodCount = 1;
+	}
+
+	std::vector<unsigned int> cacheOrder(indices.size());
+	for (size_t i = 0; i < lodCount; i++)
+	{
+		unsigned int* lodIndices = &indices[lods[i].indexStart];
+		unsigned int* lodCacheOrder = &cacheOrder[lods[i].indexStart];
+		OptimizeVertexCache(lodCacheOrder, lodIndices, lods[i].indexCount, vertices.size());
+		OptimizeOverdraw(lodIndices, lodCacheOrder, lods[i].indexCount, &vertices[0], vertices.size());
+	}
+
+	// LOD 0 comes first, so its vertices end up in its fetch order
+	vertices.resize(OptimizeVertexFetch(&vertices[0], &indices[0], indices.size(), vertices.size()));
+}
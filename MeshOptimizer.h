@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "MeshSimplifier.h"
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Results of running an index buffer through a simulated
+// FIFO post-transform vertex cache
+// --------------------------------------------------------
+struct VertexCacheStats
+{
+	unsigned int transformedVertices;	// Cache misses (vertex shader invocations)
+	float hitRate;						// Fraction of corners served from the cache
+	float acmr;							// Average cache miss ratio: misses per triangle
+	float atvr;							// Average transform to vertex ratio: misses per vertex
+};
+
+// Simulates a FIFO post-transform cache of the given size
+VertexCacheStats AnalyzeVertexCache(
+	const unsigned int* indices,
+	size_t indexCount,
+	size_t vertexCount,
+	unsigned int cacheSize = 16);
+
+// --------------------------------------------------------
+// Index and vertex buffer reordering, run before a mesh's
+// buffers are created.  None of these change the mesh's
+// shape; they only change the order things are stored in.
+// --------------------------------------------------------
+
+// Reorders triangles so recently transformed vertices get re-used
+// (Tom Forsyth's "Linear-Speed Vertex Cache Optimisation")
+// - destination and indices must not overlap
+void OptimizeVertexCache(
+	unsigned int* destination,
+	const unsigned int* indices,
+	size_t indexCount,
+	size_t vertexCount);
+
+// Reorders clusters of cache-optimized triangles so outward facing
+// ones are drawn first, which lets early-Z reject more pixels
+// - threshold: how much worse the ACMR is allowed to get (1.05 = 5%)
+// - destination and indices must not overlap
+void OptimizeOverdraw(
+	unsigned int* destination,
+	const unsigned int* indices,
+	size_t indexCount,
+	const Vertex* vertices,
+	size_t vertexCount,
+	float threshold = 1.05f);
+
+// Reorders vertices into the order the index buffer first uses them,
+// remapping the indices to match and dropping unused vertices
+// - Returns the new vertex count
+size_t OptimizeVertexFetch(
+	Vertex* vertices,
+	unsigned int* indices,
+	size_t indexCount,
+	size_t vertexCount);
+
+// Runs all three of the above, in order, on a mesh's arrays
+// - With LODs, each LOD's index range is reordered separately
+void OptimizeMesh(
+	std::vector<Vertex>& vertices,
+	std::vector<unsigned int>& indices,
+	const MeshLod* lods = 0,
+	size_t lodCount = 0);
@@ -0,0 +1,439 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+using namespace DirectX;
+
+namespace
+{
+	// --------------------------------------------------------
+	// Sum of weighted squared distances to a set of planes,
+	// stored as the upper triangle of a symmetric 4x4 matrix
+	// --------------------------------------------------------
+	struct Quadric
+	{
+		double a2, ab, ac, ad;
+		double b2, bc, bd;
+		double c2, cd;
+		double d2;
+		double weight;
+	};
+
+	// Adds the plane ax + by + cz + d = 0, where (a, b, c) is unit length
+	void AddPlane(Quadric& q, double a, double b, double c, double d, double weight)
+	{
+		q.a2 += a * a * weight;
+		q.ab += a * b * weight;
+		q.ac += a * c * weight;
+		q.ad += a * d * weight;
+		q.b2 += b * b * weight;
+		q.bc += b * c * weight;
+		q.bd += b * d * weight;
+		q.c2 += c * c * weight;
+		q.cd += c * d * weight;
+		q.d2 += d * d * weight;
+		q.weight += weight;
+	}
+
+	void AddQuadric(Quadric& q, const Quadric& other)
+	{
+		q.a2 += other.a2;
+		q.ab += other.ab;
+		q.ac += other.ac;
+		q.ad += other.ad;
+		q.b2 += other.b2;
+		q.bc += other.bc;
+		q.bd += other.bd;
+		q.c2 += other.c2;
+		q.cd += other.cd;
+		q.d2 += other.d2;
+		q.weight += other.weight;
+	}
+
+	// Weighted average squared distance from p to the quadric's planes
+	double QuadricError(const Quadric& q, const XMFLOAT3& p)
+	{
+		double x = p.x;
+		double y = p.y;
+		double z = p.z;
+		double error =
+			q.a2 * x * x + q.b2 * y * y + q.c2 * z * z +
+			2.0 * (q.ab * x * y + q.ac * x * z + q.bc * y * z) +
+			2.0 * (q.ad * x + q.bd * y + q.cd * z) +
+			q.d2;
+		return q.weight > 0.0 ? fabs(error) / q.weight : 0.0;
+	}
+
+	// Un-normalized triangle normal (its length is twice the area)
+	XMFLOAT3 TriangleNormal(const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c)
+	{
+		XMFLOAT3 e1(b.x - a.x, b.y - a.y, b.z - a.z);
+		XMFLOAT3 e2(c.x - a.x, c.y - a.y, c.z - a.z);
+		return XMFLOAT3(
+			e1.y * e2.z - e1.z * e2.y,
+			e1.z * e2.x - e1.x * e2.z,
+			e1.x * e2.y - e1.y * e2.x);
+	}
+
+	// Moving vertex "from" onto vertex "to"
+	struct Collapse
+	{
+		unsigned int from;
+		unsigned int to;
+		double error;
+	};
+
+	// Levels of detail aren't worth their own draw range
+	// for meshes that are already this small
+	const size_t lodMinTriangles = 100;
+
+	unsigned long long EdgeKey(unsigned int a, unsigned int b)
+	{
+		return ((unsigned long long)a << 32) | b;
+	}
+}
+
+// --------------------------------------------------------
+// Edge collapse simplification
+//
+// - Works on positions rather than vertices, since a position
+//   on a UV or normal seam has several vertices ("wedges").
+//   Collapsing position P onto neighbor Q moves every wedge of
+//   P onto the wedge of Q it shares an edge with, so seams can
+//   only slide along themselves and never tear open.
+// - Every position gets a quadric built from the planes of the
+//   triangles around it (weighted by area).  Collapsing P onto
+//   Q costs P's quadric evaluated at Q.
+// - Collapses happen in passes: all candidates are sorted by
+//   cost, and the cheapest ones that don't touch each other's
+//   triangles (or flip any triangle over) are applied
+//   together, then the candidate list is rebuilt
+// - Vertices are never created or moved, only re-used, so
+//   every level of detail can share one vertex buffer
+// - Open borders and non-manifold edges are left alone
+// --------------------------------------------------------
+size_t SimplifyMesh(
+	unsigned int* destination,
+	const unsigned int* indices,
+	size_t indexCount,
+	const Vertex* vertices,
+	size_t vertexCount,
+	size_t targetIndexCount,
+	float targetError,
+	float* resultError)
+{
+	std::vector<unsigned int> result(indices, indices + indexCount - indexCount % 3);
+	double maxErrorFound = 0.0;
+
+	// Errors are relative to the mesh's largest dimension
+	XMFLOAT3 minP = vertexCount > 0 ? vertices[0].position : XMFLOAT3(0, 0, 0);
+	XMFLOAT3 maxP = minP;
+	for (size_t v = 1; v < vertexCount; v++)
+	{
+		const XMFLOAT3& p = vertices[v].position;
+		minP = XMFLOAT3(std::min(minP.x, p.x), std::min(minP.y, p.y), std::min(minP.z, p.z));
+		maxP = XMFLOAT3(std::max(maxP.x, p.x), std::max(maxP.y, p.y), std::max(maxP.z, p.z));
+	}
+	double extent = std::max(maxP.x - minP.x, std::max(maxP.y - minP.y, maxP.z - minP.z));
+	if (extent <= 0.0)
+		extent = 1.0;
+	double maxErrorSq = (targetError * extent) * (targetError * extent);
+
+	// Group vertices that share a position.  The wedges of
+	// position p are wedges[wedgeOffsets[p] .. wedgeOffsets[p + 1])
+	std::vector<unsigned int> wedges(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		wedges[v] = (unsigned int)v;
+	std::sort(wedges.begin(), wedges.end(), [&](unsigned int a, unsigned int b)
+	{
+		const XMFLOAT3& pa = vertices[a].position;
+		const XMFLOAT3& pb = vertices[b].position;
+		if (pa.x != pb.x) return pa.x < pb.x;
+		if (pa.y != pb.y) return pa.y < pb.y;
+		if (pa.z != pb.z) return pa.z < pb.z;
+		return a < b;
+	});
+
+	std::vector<unsigned int> positionIds(vertexCount);
+	std::vector<unsigned int> wedgeOffsets;
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const XMFLOAT3& p = vertices[wedges[i]].position;
+		const XMFLOAT3* previous = i > 0 ? &vertices[wedges[i - 1]].position : 0;
+		if (!previous || p.x != previous->x || p.y != previous->y || p.z != previous->z)
+			wedgeOffsets.push_back((unsigned int)i);
+
+		positionIds[wedges[i]] = (unsigned int)wedgeOffsets.size() - 1;
+	}
+	size_t positionCount = wedgeOffsets.size();
+	wedgeOffsets.push_back((unsigned int)vertexCount);
+
+	// Lock open borders and non-manifold edges, where an edge
+	// (by position) isn't matched by exactly one opposite edge
+	std::unordered_map<unsigned long long, unsigned int> edgeCounts;
+	edgeCounts.reserve(result.size());
+	for (size_t i = 0; i < result.size(); i += 3)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int a = positionIds[result[i + k]];
+			unsigned int b = positionIds[result[i + (k + 1) % 3]];
+			edgeCounts[EdgeKey(a, b)]++;
+		}
+	}
+
+	std::vector<bool> locked(positionCount, false);
+	for (size_t i = 0; i < result.size(); i += 3)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int a = positionIds[result[i + k]];
+			unsigned int b = positionIds[result[i + (k + 1) % 3]];
+			auto opposite = edgeCounts.find(EdgeKey(b, a));
+			if (edgeCounts[EdgeKey(a, b)] != 1 || opposite == edgeCounts.end() || opposite->second != 1)
+			{
+				locked[a] = true;
+				locked[b] = true;
+			}
+		}
+	}
+
+	// Starting quadrics, from every triangle's plane
+	std::vector<Quadric> quadrics(positionCount, Quadric());
+	for (size_t i = 0; i < result.size(); i += 3)
+	{
+		const XMFLOAT3& a = vertices[result[i + 0]].position;
+		XMFLOAT3 n = TriangleNormal(a, vertices[result[i + 1]].position, vertices[result[i + 2]].position);
+		double length = sqrt((double)n.x * n.x + (double)n.y * n.y + (double)n.z * n.z);
+		if (length <= 0.0)
+			continue;
+
+		double nx = n.x / length;
+		double ny = n.y / length;
+		double nz = n.z / length;
+		double d = -(nx * a.x + ny * a.y + nz * a.z);
+		for (int k = 0; k < 3; k++)
+			AddPlane(quadrics[positionIds[result[i + k]]], nx, ny, nz, d, length * 0.5);
+	}
+
+	std::vector<unsigned int> remap(vertexCount);
+	std::vector<bool> touched(positionCount);
+	std::vector<unsigned int> adjacencyOffsets(vertexCount + 1);
+	std::vector<unsigned int> adjacency;
+	std::vector<Collapse> collapses;
+	std::vector<unsigned int> targets;
+
+	// Finds the wedge of position "to" that each wedge of "from"
+	// would move onto, failing if any wedge has none or several
+	auto findTargets = [&](const Collapse& c)
+	{
+		targets.clear();
+		for (unsigned int w = wedgeOffsets[c.from]; w < wedgeOffsets[c.from + 1]; w++)
+		{
+			unsigned int wedge = wedges[w];
+			unsigned int target = 0xFFFFFFFF;
+			for (unsigned int j = adjacencyOffsets[wedge]; j < adjacencyOffsets[wedge + 1]; j++)
+			{
+				const unsigned int* tri = &result[adjacency[j] * 3];
+				for (int k = 0; k < 3; k++)
+				{
+					if (positionIds[tri[k]] != c.to || tri[k] == target)
+						continue;
+					if (target != 0xFFFFFFFF)
+						return false;
+					target = tri[k];
+				}
+			}
+
+			// Two wedges landing on one would merge their attributes
+			if (target == 0xFFFFFFFF || std::find(targets.begin(), targets.end(), target) != targets.end())
+				return false;
+			targets.push_back(target);
+		}
+		return true;
+	};
+
+	// Would collapsing turn any of the remaining triangles around
+	// the moving position upside down?
+	auto flipsTriangle = [&](const Collapse& c)
+	{
+		const XMFLOAT3& destinationPosition = vertices[wedges[wedgeOffsets[c.to]]].position;
+		for (unsigned int w = wedgeOffsets[c.from]; w < wedgeOffsets[c.from + 1]; w++)
+		{
+			unsigned int wedge = wedges[w];
+			for (unsigned int j = adjacencyOffsets[wedge]; j < adjacencyOffsets[wedge + 1]; j++)
+			{
+				const unsigned int* tri = &result[adjacency[j] * 3];
+				if (positionIds[tri[0]] == c.to || positionIds[tri[1]] == c.to || positionIds[tri[2]] == c.to)
+					continue;
+
+				XMFLOAT3 before[3];
+				XMFLOAT3 after[3];
+				for (int k = 0; k < 3; k++)
+				{
+					before[k] = vertices[tri[k]].position;
+					after[k] = tri[k] == wedge ? destinationPosition : before[k];
+				}
+
+				XMFLOAT3 n0 = TriangleNormal(before[0], before[1], before[2]);
+				XMFLOAT3 n1 = TriangleNormal(after[0], after[1], after[2]);
+				if (n0.x * n1.x + n0.y * n1.y + n0.z * n1.z <= 0.0f)
+					return true;
+			}
+		}
+		return false;
+	};
+
+	while (result.size() > targetIndexCount)
+	{
+		// Every unlocked position can slide along any of its edges
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int from = positionIds[result[i + k]];
+				unsigned int to = positionIds[result[i + (k + 1) % 3]];
+				if (!locked[from] && from != to)
+				{
+					Collapse c = { from, to, QuadricError(quadrics[from], vertices[result[i + (k + 1) % 3]].position) };
+					collapses.push_back(c);
+				}
+			}
+		}
+		if (collapses.empty())
+			break;
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b)
+		{
+			if (a.error != b.error) return a.error < b.error;
+			if (a.from != b.from) return a.from < b.from;
+			return a.to < b.to;
+		});
+
+		// Triangles around each vertex
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for (size_t i = 0; i < result.size(); i++)
+			adjacencyOffsets[result[i] + 1]++;
+		for (size_t v = 0; v < vertexCount; v++)
+			adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+
+		adjacency.resize(result.size());
+		std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < result.size(); i++)
+			adjacency[fill[result[i]]++] = (unsigned int)(i / 3);
+
+		// Each collapse removes about two triangles, so don't
+		// overshoot the target by much in the last pass
+		size_t wanted = (result.size() - targetIndexCount) / 6 + 1;
+		size_t performed = 0;
+		for (size_t v = 0; v < vertexCount; v++)
+			remap[v] = (unsigned int)v;
+		std::fill(touched.begin(), touched.end(), false);
+
+		for (const Collapse& c : collapses)
+		{
+			if (performed >= wanted || c.error > maxErrorSq)
+				break;
+			if (touched[c.from] || touched[c.to] || !findTargets(c) || flipsTriangle(c))
+				continue;
+
+			for (unsigned int w = wedgeOffsets[c.from]; w < wedgeOffsets[c.from + 1]; w++)
+				remap[wedges[w]] = targets[w - wedgeOffsets[c.from]];
+
+			AddQuadric(quadrics[c.to], quadrics[c.from]);
+			maxErrorFound = std::max(maxErrorFound, c.error);
+			performed++;
+
+			// Nothing else around this position can move this pass,
+			// since the triangles its checks used just changed
+			for (unsigned int w = wedgeOffsets[c.from]; w < wedgeOffsets[c.from + 1]; w++)
+			{
+				unsigned int wedge = wedges[w];
+				for (unsigned int j = adjacencyOffsets[wedge]; j < adjacencyOffsets[wedge + 1]; j++)
+				{
+					const unsigned int* tri = &result[adjacency[j] * 3];
+					touched[positionIds[tri[0]]] = true;
+					touched[positionIds[tri[1]]] = true;
+					touched[positionIds[tri[2]]] = true;
+				}
+			}
+		}
+		if (performed == 0)
+			break;
+
+		// Apply the collapses, dropping triangles that became degenerate
+		size_t written = 0;
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			unsigned int a = remap[result[i + 0]];
+			unsigned int b = remap[result[i + 1]];
+			unsigned int c = remap[result[i + 2]];
+			if (a == b || b == c || a == c)
+				continue;
+
+			result[written++] = a;
+			result[written++] = b;
+			result[written++] = c;
+		}
+		result.resize(written);
+	}
+
+	std::copy(result.begin(), result.end(), destination);
+	if (resultError)
+		*resultError = (float)(sqrt(maxErrorFound) / extent);
+	return result.size();
+}
+
+// --------------------------------------------------------
+// Each level is simplified from the one before it, and its
+// error is the sum of the errors along the chain so far
+// (an upper bound on its distance from LOD 0)
+// --------------------------------------------------------
+std::vector<MeshLod> GenerateLodChain(
+	const Vertex* vertices,
+	size_t vertexCount,
+	std::vector<unsigned int>& indices,
+	unsigned int maxLods,
+	float maxError)
+{
+	std::vector<MeshLod> lods;
+	MeshLod original = { 0, (unsigned int)indices.size(), 0.0f };
+	lods.push_back(original);
+	if (indices.empty())
+		return lods;
+
+	std::vector<unsigned int> previous(indices);
+	std::vector<unsigned int> simplified(indices.size());
+	float totalError = 0.0f;
+
+	while (lods.size() < maxLods && totalError < maxError && previous.size() / 3 >= lodMinTriangles)
+	{
+		size_t target = previous.size() / 6 * 3;
+		float levelError = 0.0f;
+		size_t count = SimplifyMesh(
+			&simplified[0],
+			&previous[0],
+			previous.size(),
+			vertices,
+			vertexCount,
+			target,
+			maxError - totalError,
+			&levelError);
+
+		// Not worth a draw range if it barely got smaller
+		if (count == 0 || count > previous.size() * 3 / 4)
+			break;
+
+		totalError += levelError;
+		MeshLod lod = { (unsigned int)indices.size(), (unsigned int)count, totalError };
+		lods.push_back(lod);
+
+		indices.insert(indices.end(), simplified.begin(), simplified.begin() + count);
+		previous.assign(simplified.begin(), simplified.begin() + count);
+	}
+
+	return lods;
+}
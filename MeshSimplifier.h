@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// One level of detail: a range of a mesh's index buffer.
+// Every LOD shares the same vertex buffer.
+// --------------------------------------------------------
+struct MeshLod
+{
+	unsigned int indexStart;
+	unsigned int indexCount;
+	float error;				// Max deviation from LOD 0, relative to the mesh's size
+};
+
+// Simplifies a mesh by collapsing edges in order of their quadric
+// error (Garland & Heckbert), re-using the existing vertices
+// - Stops at targetIndexCount indices, or once the next collapse
+//   would move the surface by more than targetError (relative to
+//   the mesh's largest dimension)
+// - UV/normal seams can only collapse along themselves, so they
+//   never tear open; open borders and non-manifold edges are
+//   locked and never collapse at all
+// - Returns the number of indices written to destination, which
+//   must have room for indexCount of them
+size_t SimplifyMesh(
+	unsigned int* destination,
+	const unsigned int* indices,
+	size_t indexCount,
+	const Vertex* vertices,
+	size_t vertexCount,
+	size_t targetIndexCount,
+	float targetError,
+	float* resultError = 0);
+
+// Builds up to maxLods levels of detail, each about half the
+// triangles of the one before, and appends the indices of
+// every new level after the original ones
+// - Stops early once a level doesn't shrink by at least a
+//   quarter, would exceed maxError, or the mesh is tiny
+// - The first entry returned is always the original mesh
+std::vector<MeshLod> GenerateLodChain(
+	const Vertex* vertices,
+	size_t vertexCount,
+	std::vector<unsigned int>& indices,
+	unsigned int maxLods = 4,
+	float maxError = 0.02f);
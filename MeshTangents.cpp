@@ -0,0 +1,232 @@
+#include "MeshTangents.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Triangles whose uv area is smaller than this (in uv space)
+	// can't define a direction, and are skipped
+	const float degenerateUvArea = 1e-12f;
+
+	// --------------------------------------------------------
+	// Runs func(0) .. func(count - 1) at the same time, using
+	// the calling thread for the last one
+	// --------------------------------------------------------
+	template <typename Func>
+	void RunOnThreads(unsigned int count, Func func)
+	{
+		std::vector<std::thread> threads;
+		threads.reserve(count);
+		for (unsigned int i = 0; i + 1 < count; i++)
+			threads.emplace_back(func, i);
+
+		func(count - 1);
+
+		for (auto& t : threads)
+			t.join();
+	}
+
+	// --------------------------------------------------------
+	// Adds the (unnormalized) tangent of each triangle in a
+	// range to its three vertices' entries in accumulator
+	//
+	// - Triangles go through four at a time in SoA form: every
+	//   vector holds one component of four different triangles,
+	//   so each operation works on all four at once
+	// - A partial last block is padded with empty triangles,
+	//   which fail the uv test like any other degenerate one
+	// --------------------------------------------------------
+	void AccumulateTangents(
+		const Vertex* vertices,
+		const unsigned int* indices,
+		size_t firstTriangle,
+		size_t lastTriangle,
+		XMFLOAT3* accumulator)
+	{
+		XMVECTOR minArea = XMVectorReplicate(degenerateUvArea);
+
+		for (size_t block = firstTriangle; block < lastTriangle; block += 4)
+		{
+			size_t count = std::min<size_t>(4, lastTriangle - block);
+
+			// Gather: [corner][component][triangle]
+			XMFLOAT4 position[3][3] = {};
+			XMFLOAT4 uv[3][2] = {};
+			for (size_t t = 0; t < count; t++)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					const Vertex& v = vertices[indices[(block + t) * 3 + k]];
+					(&position[k][0].x)[t] = v.position.x;
+					(&position[k][1].x)[t] = v.position.y;
+					(&position[k][2].x)[t] = v.position.z;
+					(&uv[k][0].x)[t] = v.uv.x;
+					(&uv[k][1].x)[t] = v.uv.y;
+				}
+			}
+
+			// Edges from the first corner, in position and uv space
+			XMVECTOR x1 = XMLoadFloat4(&position[1][0]) - XMLoadFloat4(&position[0][0]);
+			XMVECTOR y1 = XMLoadFloat4(&position[1][1]) - XMLoadFloat4(&position[0][1]);
+			XMVECTOR z1 = XMLoadFloat4(&position[1][2]) - XMLoadFloat4(&position[0][2]);
+			XMVECTOR x2 = XMLoadFloat4(&position[2][0]) - XMLoadFloat4(&position[0][0]);
+			XMVECTOR y2 = XMLoadFloat4(&position[2][1]) - XMLoadFloat4(&position[0][1]);
+			XMVECTOR z2 = XMLoadFloat4(&position[2][2]) - XMLoadFloat4(&position[0][2]);
+			XMVECTOR s1 = XMLoadFloat4(&uv[1][0]) - XMLoadFloat4(&uv[0][0]);
+			XMVECTOR t1 = XMLoadFloat4(&uv[1][1]) - XMLoadFloat4(&uv[0][1]);
+			XMVECTOR s2 = XMLoadFloat4(&uv[2][0]) - XMLoadFloat4(&uv[0][0]);
+			XMVECTOR t2 = XMLoadFloat4(&uv[2][1]) - XMLoadFloat4(&uv[0][1]);
+
+			// r = 1 / (s1 * t2 - s2 * t1), or 0 for degenerate uvs
+			// - The division never sees a zero, so no lane can
+			//   turn into an infinity or NaN
+			XMVECTOR determinant = s1 * t2 - s2 * t1;
+			XMVECTOR usable = XMVectorGreater(XMVectorAbs(determinant), minArea);
+			XMVECTOR r = XMVectorSelect(
+				XMVectorZero(),
+				XMVectorReciprocal(XMVectorSelect(XMVectorSplatOne(), determinant, usable)),
+				usable);
+
+			XMFLOAT4 tangent[3];
+			XMStoreFloat4(&tangent[0], (t2 * x1 - t1 * x2) * r);
+			XMStoreFloat4(&tangent[1], (t2 * y1 - t1 * y2) * r);
+			XMStoreFloat4(&tangent[2], (t2 * z1 - t1 * z2) * r);
+
+			// Scatter to the triangles' vertices
+			for (size_t t = 0; t < count; t++)
+			{
+				float tx = (&tangent[0].x)[t];
+				float ty = (&tangent[1].x)[t];
+				float tz = (&tangent[2].x)[t];
+				for (int k = 0; k < 3; k++)
+				{
+					XMFLOAT3& sum = accumulator[indices[(block + t) * 3 + k]];
+					sum.x += tx;
+					sum.y += ty;
+					sum.z += tz;
+				}
+			}
+		}
+	}
+
+	// --------------------------------------------------------
+	// Sums every thread's totals for a range of vertices, then
+	// finishes each vertex's tangent
+	// --------------------------------------------------------
+	void OrthonormalizeTangents(
+		Vertex* vertices,
+		size_t firstVertex,
+		size_t lastVertex,
+		const std::vector<std::vector<XMFLOAT3>>& threadSums)
+	{
+		for (size_t i = firstVertex; i < lastVertex; i++)
+		{
+			XMVECTOR tangent = XMVectorZero();
+			for (const std::vector<XMFLOAT3>& sums : threadSums)
+				tangent = tangent + XMLoadFloat3(&sums[i]);
+
+			XMFLOAT3 sum;
+			XMStoreFloat3(&sum, tangent);
+			FinishTangent(vertices[i], sum);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Tangents from positions and uvs, based on:
+// - http://www.terathon.com/code/tangent.html
+// - http://foundationsofgameenginedev.com/FGED2-sample.pdf
+//   (listing 7.4 in section 7.5)
+//
+// On multiple threads:
+// - Each thread takes a slice of the triangles and adds them
+//   up in its own buffer, so there's no sharing or locking
+// - After they're all done, each thread takes a slice of the
+//   vertices, sums the buffers and orthonormalizes
+// --------------------------------------------------------
+void GenerateTangents(
+	Vertex* vertices,
+	size_t vertexCount,
+	const unsigned int* indices,
+	size_t indexCount,
+	unsigned int threadCount)
+{
+	size_t triangleCount = indexCount / 3;
+	if (threadCount == 0)
+		threadCount = triangleCount >= tangentParallelThreshold ? std::thread::hardware_concurrency() : 1;
+	if (threadCount == 0)
+		threadCount = 1;
+
+	if (vertexCount == 0)
+		return;
+
+	std::vector<std::vector<XMFLOAT3>> threadSums(threadCount);
+	RunOnThreads(threadCount, [&](unsigned int thread)
+	{
+		threadSums[thread].assign(vertexCount, XMFLOAT3(0, 0, 0));
+
+		size_t first = triangleCount * thread / threadCount;
+		size_t last = triangleCount * (thread + 1) / threadCount;
+		AccumulateTangents(vertices, indices, first, last, &threadSums[thread][0]);
+	});
+	RunOnThreads(threadCount, [&](unsigned int thread)
+	{
+		size_t first = vertexCount * thread / threadCount;
+		size_t last = vertexCount * (thread + 1) / threadCount;
+		OrthonormalizeTangents(vertices, first, last, threadSums);
+	});
+}
+
+XMFLOAT3 GetTriangleTangent(const XMFLOAT3 positions[3], const XMFLOAT2 uvs[3])
+{
+	float x1 = positions[1].x - positions[0].x;
+	float y1 = positions[1].y - positions[0].y;
+	float z1 = positions[1].z - positions[0].z;
+	float x2 = positions[2].x - positions[0].x;
+	float y2 = positions[2].y - positions[0].y;
+	float z2 = positions[2].z - positions[0].z;
+	float s1 = uvs[1].x - uvs[0].x;
+	float t1 = uvs[1].y - uvs[0].y;
+	float s2 = uvs[2].x - uvs[0].x;
+	float t2 = uvs[2].y - uvs[0].y;
+
+	// Same test and rounding as AccumulateTangents()
+	float determinant = s1 * t2 - s2 * t1;
+	if (!(fabsf(determinant) > degenerateUvArea))
+		return XMFLOAT3(0, 0, 0);
+
+	float r = 1.0f / determinant;
+	return XMFLOAT3(
+		(t2 * x1 - t1 * x2) * r,
+		(t2 * y1 - t1 * y2) * r,
+		(t2 * z1 - t1 * z2) * r);
+}
+
+// --------------------------------------------------------
+// Gram-Schmidt makes the tangent exactly 90 degrees from
+// the normal
+// --------------------------------------------------------
+void FinishTangent(Vertex& vertex, const XMFLOAT3& tangentSum)
+{
+	XMVECTOR tangent = XMLoadFloat3(&tangentSum);
+	XMVECTOR normal = XMLoadFloat3(&vertex.normal);
+	tangent = tangent - normal * XMVector3Dot(normal, tangent);
+
+	// Nothing usable (only degenerate triangles, or a
+	// tangent parallel to the normal), so take any
+	// direction that's perpendicular to the normal
+	if (XMVectorGetX(XMVector3LengthSq(tangent)) < 1e-20f)
+	{
+		XMVECTOR axis = fabsf(vertex.normal.x) < 0.9f ?
+			XMVectorSet(1, 0, 0, 0) :
+			XMVectorSet(0, 1, 0, 0);
+		tangent = XMVector3Cross(normal, axis);
+	}
+
+	XMStoreFloat3(&vertex.tangent, XMVector3Normalize(tangent));
+}
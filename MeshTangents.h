@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include "Vertex.h"
+
+// Meshes with at least this many triangles get their tangents
+// generated on multiple threads by GenerateTangents()
+const size_t tangentParallelThreshold = 64 * 1024;
+
+// Fills in every vertex's tangent from its triangles' positions
+// and uvs, then makes it a unit vector perpendicular to the normal
+// - Run this before the vertex buffer is created
+// - Triangles with degenerate uvs add nothing, and vertices left
+//   with no usable tangent get an arbitrary perpendicular one
+// - threadCount 0 picks one thread for small meshes and every
+//   hardware thread for big ones
+void GenerateTangents(
+	Vertex* vertices,
+	size_t vertexCount,
+	const unsigned int* indices,
+	size_t indexCount,
+	unsigned int threadCount = 0);
+
+// --------------------------------------------------------
+// The same math one piece at a time, for meshes that are
+// streamed rather than held in memory whole
+// --------------------------------------------------------
+
+// The unnormalized tangent a triangle adds to each of its
+// corners (zero when its uvs are degenerate)
+DirectX::XMFLOAT3 GetTriangleTangent(const DirectX::XMFLOAT3 positions[3], const DirectX::XMFLOAT2 uvs[3]);
+
+// Turns a vertex's summed triangle tangents into its final
+// tangent, perpendicular to its normal
+void FinishTangent(Vertex& vertex, const DirectX::XMFLOAT3& tangentSum);
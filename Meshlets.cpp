@@ -0,0 +1,300 @@
+#include "Meshlets.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// Marks "no triangle" and "vertex in no meshlet yet"
+	const unsigned int noIndex = 0xFFFFFFFF;
+
+	// --------------------------------------------------------
+	// Bounding sphere and normal cone of one finished meshlet
+	// --------------------------------------------------------
+	void ComputeMeshletBounds(
+		Meshlet& meshlet,
+		const unsigned int* indices,
+		const Vertex* vertices,
+		const std::vector<unsigned int>& meshletVertices)
+	{
+		// Sphere around the center of the cluster's box
+		XMVECTOR minV = XMLoadFloat3(&vertices[meshletVertices[0]].position);
+		XMVECTOR maxV = minV;
+		for (unsigned int v : meshletVertices)
+		{
+			XMVECTOR p = XMLoadFloat3(&vertices[v].position);
+			minV = XMVectorMin(minV, p);
+			maxV = XMVectorMax(maxV, p);
+		}
+
+		XMVECTOR center = (minV + maxV) * 0.5f;
+		float radiusSq = 0.0f;
+		for (unsigned int v : meshletVertices)
+		{
+			XMVECTOR p = XMLoadFloat3(&vertices[v].position);
+			radiusSq = std::max(radiusSq, XMVectorGetX(XMVector3LengthSq(p - center)));
+		}
+		XMStoreFloat3(&meshlet.center, center);
+		meshlet.radius = sqrtf(radiusSq);
+
+		// Unit normals of every triangle.  With our clockwise
+		// front faces, cross(b - a, c - a) points outward.
+		std::vector<XMVECTOR> normals;
+		normals.reserve(meshlet.indexCount / 3);
+		XMVECTOR axis = XMVectorZero();
+		for (unsigned int i = 0; i < meshlet.indexCount; i += 3)
+		{
+			XMVECTOR a = XMLoadFloat3(&vertices[indices[i + 0]].position);
+			XMVECTOR b = XMLoadFloat3(&vertices[indices[i + 1]].position);
+			XMVECTOR c = XMLoadFloat3(&vertices[indices[i + 2]].position);
+			XMVECTOR n = XMVector3Cross(b - a, c - a);
+			if (XMVectorGetX(XMVector3LengthSq(n)) <= 0.0f)
+				continue;
+
+			n = XMVector3Normalize(n);
+			normals.push_back(n);
+			axis = axis + n;
+		}
+
+		// The cone is only worth testing if it's well under a
+		// hemisphere, since the test gets very conservative
+		meshlet.coneAxis = XMFLOAT3(0, 0, 0);
+		meshlet.coneCosAngle = 0.0f;
+		if (normals.empty() || XMVectorGetX(XMVector3LengthSq(axis)) <= 0.0f)
+			return;
+
+		axis = XMVector3Normalize(axis);
+		float minDot = 1.0f;
+		for (const XMVECTOR& n : normals)
+			minDot = std::min(minDot, XMVectorGetX(XMVector3Dot(n, axis)));
+
+		XMStoreFloat3(&meshlet.coneAxis, axis);
+		meshlet.coneCosAngle = minDot > 0.1f ? minDot : 0.0f;
+	}
+}
+
+// --------------------------------------------------------
+// Greedy meshlet builder
+//
+// - Each meshlet is seeded with the first unused triangle in
+//   the current order, then grows one triangle at a time
+// - The next triangle is the unused one touching the meshlet
+//   that adds the fewest new vertices, with ties going to the
+//   one closest to the meshlet's center to keep it compact
+// - A meshlet ends when it's full (either limit) or nothing
+//   connected to it fits
+// --------------------------------------------------------
+std::vector<Meshlet> BuildMeshlets(
+	unsigned int* indices,
+	size_t indexCount,
+	const Vertex* vertices,
+	size_t vertexCount)
+{
+	std::vector<Meshlet> meshlets;
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return meshlets;
+
+	// Triangles that use each vertex
+	std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		adjacencyOffsets[indices[i] + 1]++;
+	for (size_t v = 0; v < vertexCount; v++)
+		adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+
+	std::vector<unsigned int> adjacency(triangleCount * 3);
+	std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+
+	std::vector<bool> used(triangleCount, false);
+	std::vector<unsigned int> vertexMeshlet(vertexCount, noIndex);
+	std::vector<unsigned int> meshletVertices;
+	std::vector<unsigned int> reordered;
+	reordered.reserve(triangleCount * 3);
+	meshletVertices.reserve(meshletMaxVertices);
+
+	size_t nextSeed = 0;
+	while (reordered.size() < triangleCount * 3)
+	{
+		while (used[nextSeed])
+			nextSeed++;
+
+		unsigned int id = (unsigned int)meshlets.size();
+		Meshlet meshlet = {};
+		meshlet.indexStart = (unsigned int)reordered.size();
+		meshletVertices.clear();
+		XMVECTOR positionSum = XMVectorZero();
+
+		unsigned int triangle = (unsigned int)nextSeed;
+		while (triangle != noIndex)
+		{
+			// Add the triangle and any vertices it brings with it
+			const unsigned int* tri = indices + (size_t)triangle * 3;
+			for (int k = 0; k < 3; k++)
+			{
+				if (vertexMeshlet[tri[k]] != id)
+				{
+					vertexMeshlet[tri[k]] = id;
+					meshletVertices.push_back(tri[k]);
+					positionSum = positionSum + XMLoadFloat3(&vertices[tri[k]].position);
+				}
+				reordered.push_back(tri[k]);
+			}
+			used[triangle] = true;
+			meshlet.indexCount += 3;
+
+			if (meshlet.indexCount / 3 >= meshletMaxTriangles)
+				break;
+
+			// Pick the next one from everything touching the meshlet
+			XMVECTOR centroid = positionSum / (float)meshletVertices.size();
+			unsigned int bestNewVertices = 4;
+			float bestDistanceSq = 0.0f;
+			triangle = noIndex;
+			for (unsigned int v : meshletVertices)
+			{
+				for (unsigned int j = adjacencyOffsets[v]; j < adjacencyOffsets[v + 1]; j++)
+				{
+					unsigned int candidate = adjacency[j];
+					if (used[candidate])
+						continue;
+
+					const unsigned int* c = indices + (size_t)candidate * 3;
+					unsigned int newVertices =
+						(vertexMeshlet[c[0]] != id) +
+						(vertexMeshlet[c[1]] != id) +
+						(vertexMeshlet[c[2]] != id);
+					if (meshletVertices.size() + newVertices > meshletMaxVertices || newVertices > bestNewVertices)
+						continue;
+
+					XMVECTOR triangleCenter =
+						(XMLoadFloat3(&vertices[c[0]].position) +
+						XMLoadFloat3(&vertices[c[1]].position) +
+						XMLoadFloat3(&vertices[c[2]].position)) / 3.0f;
+					float distanceSq = XMVectorGetX(XMVector3LengthSq(triangleCenter - centroid));
+					if (newVertices < bestNewVertices || distanceSq < bestDistanceSq)
+					{
+						bestNewVertices = newVertices;
+						bestDistanceSq = distanceSq;
+						triangle = candidate;
+					}
+				}
+			}
+		}
+
+		meshlet.vertexCount = (unsigned int)meshletVertices.size();
+		ComputeMeshletBounds(meshlet, &reordered[meshlet.indexStart], vertices, meshletVertices);
+		meshlets.push_back(meshlet);
+	}
+
+	std::copy(reordered.begin(), reordered.end(), indices);
+	return meshlets;
+}
+
+// --------------------------------------------------------
+// Everything happens in the mesh's local space, so nothing
+// per-meshlet has to be transformed:
+//
+// - Frustum planes come straight from the rows/columns of
+//   world * view * projection (Gribb & Hartmann), and since
+//   a plane test is exact in any space, non-uniform scale is
+//   handled for free
+// - The camera is moved into local space for the cone test.
+//   A meshlet is back facing if, for every point in its
+//   sphere and every normal in its cone, the camera is behind
+//   that plane.  With d = center - camera, b = the angle from
+//   d to the cone axis and a = the cone's half angle, that
+//   holds when |d| * cos(b + a) >= radius.
+// --------------------------------------------------------
+size_t CullMeshlets(
+	const Meshlet* meshlets,
+	size_t meshletCount,
+	const XMFLOAT4X4& world,
+	const XMFLOAT4X4& view,
+	const XMFLOAT4X4& projection,
+	std::vector<MeshletDrawRange>& visibleRanges)
+{
+	visibleRanges.clear();
+
+	XMMATRIX worldView = XMMatrixMultiply(XMLoadFloat4x4(&world), XMLoadFloat4x4(&view));
+	XMFLOAT4X4 m;
+	XMStoreFloat4x4(&m, XMMatrixMultiply(worldView, XMLoadFloat4x4(&projection)));
+
+	// Left, right, bottom, top, near (D3D's 0 <= z) and far
+	XMFLOAT4 planes[6] = {
+		XMFLOAT4(m._14 + m._11, m._24 + m._21, m._34 + m._31, m._44 + m._41),
+		XMFLOAT4(m._14 - m._11, m._24 - m._21, m._34 - m._31, m._44 - m._41),
+		XMFLOAT4(m._14 + m._12, m._24 + m._22, m._34 + m._32, m._44 + m._42),
+		XMFLOAT4(m._14 - m._12, m._24 - m._22, m._34 - m._32, m._44 - m._42),
+		XMFLOAT4(m._13, m._23, m._33, m._43),
+		XMFLOAT4(m._14 - m._13, m._24 - m._23, m._34 - m._33, m._44 - m._43) };
+	for (XMFLOAT4& plane : planes)
+	{
+		float length = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+		if (length > 0.0f)
+		{
+			plane.x /= length;
+			plane.y /= length;
+			plane.z /= length;
+			plane.w /= length;
+		}
+	}
+
+	// The camera sits at the origin of view space
+	XMVECTOR determinant;
+	XMMATRIX viewToLocal = XMMatrixInverse(&determinant, worldView);
+	XMVECTOR cameraPosition = XMVector3TransformCoord(XMVectorZero(), viewToLocal);
+
+	size_t visibleCount = 0;
+	for (size_t i = 0; i < meshletCount; i++)
+	{
+		const Meshlet& meshlet = meshlets[i];
+		const XMFLOAT3& c = meshlet.center;
+
+		bool visible = true;
+		for (const XMFLOAT4& plane : planes)
+		{
+			if (plane.x * c.x + plane.y * c.y + plane.z * c.z + plane.w < -meshlet.radius)
+			{
+				visible = false;
+				break;
+			}
+		}
+
+		if (visible && meshlet.coneCosAngle > 0.0f)
+		{
+			XMVECTOR toCenter = XMLoadFloat3(&c) - cameraPosition;
+			float distance = XMVectorGetX(XMVector3Length(toCenter));
+			if (distance > meshlet.radius)
+			{
+				float cosB = XMVectorGetX(XMVector3Dot(toCenter, XMLoadFloat3(&meshlet.coneAxis))) / distance;
+				float sinB = sqrtf(std::max(0.0f, 1.0f - cosB * cosB));
+				float cosA = meshlet.coneCosAngle;
+				float sinA = sqrtf(1.0f - cosA * cosA);
+				if (distance * (cosB * cosA - sinB * sinA) >= meshlet.radius)
+					visible = false;
+			}
+		}
+
+		if (!visible)
+			continue;
+
+		// Meshlets are stored back to back, so neighbors that
+		// both survive can be drawn with a single call
+		visibleCount++;
+		if (!visibleRanges.empty() &&
+			visibleRanges.back().indexStart + visibleRanges.back().indexCount == meshlet.indexStart)
+		{
+			visibleRanges.back().indexCount += meshlet.indexCount;
+		}
+		else
+		{
+			MeshletDrawRange range = { meshlet.indexStart, meshlet.indexCount };
+			visibleRanges.push_back(range);
+		}
+	}
+	return visibleCount;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include <DirectXMath.h>
+#include "Vertex.h"
+
+// Cluster size limits (the same ones mesh shader pipelines use)
+const unsigned int meshletMaxVertices = 64;
+const unsigned int meshletMaxTriangles = 124;
+
+// --------------------------------------------------------
+// A small cluster of a mesh's triangles, which are stored
+// contiguously in the index buffer so that any subset of
+// clusters can be drawn with plain DrawIndexed() calls
+// --------------------------------------------------------
+struct Meshlet
+{
+	unsigned int indexStart;
+	unsigned int indexCount;
+	unsigned int vertexCount;		// Unique vertices used by the cluster
+
+	DirectX::XMFLOAT3 center;		// Local-space bounding sphere
+	float radius;
+
+	DirectX::XMFLOAT3 coneAxis;		// Average (outward) facing direction
+	float coneCosAngle;				// Cosine of the widest angle between the axis and
+									// any triangle's normal; 0 or less means no cone
+};
+
+// A range of the index buffer that survived culling
+struct MeshletDrawRange
+{
+	unsigned int indexStart;
+	unsigned int indexCount;
+};
+
+// Splits (and reorders) a range of indices into meshlets
+// - Triangles are regrouped in place, so each meshlet's
+//   indexStart is relative to the start of this range
+// - Clusters grow from the existing triangle order, so a
+//   cache-optimized index buffer stays mostly cache friendly
+std::vector<Meshlet> BuildMeshlets(
+	unsigned int* indices,
+	size_t indexCount,
+	const Vertex* vertices,
+	size_t vertexCount);
+
+// Finds the meshlets that are inside the view frustum and
+// not entirely back facing, merging neighboring survivors
+// into as few draw ranges as possible
+// - Matrices are the same (row-vector) ones sent to shaders
+// - Returns the number of meshlets that survived
+size_t CullMeshlets(
+	const Meshlet* meshlets,
+	size_t meshletCount,
+	const DirectX::XMFLOAT4X4& world,
+	const DirectX::XMFLOAT4X4& view,
+	const DirectX::XMFLOAT4X4& projection,
+	std::vector<MeshletDrawRange>& visibleRanges);
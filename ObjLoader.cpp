@@ -0,0 +1,891 @@
+#include "ObjLoader.h"
+#include "CookedMesh.h"
+#include "MappedFile.h"
+#include "MeshTangents.h"
+
+#include <cfloat>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Based on the original .OBJ loader by Chris Cascioli, which
+// read the file a line at a time with getline() + sscanf_s().
+//
+// This version memory maps the file and walks it in two passes:
+//  1. A quick counting pass so every array is sized exactly once
+//  2. A single tokenizing pass with hand-written number scanners
+//
+// Very large files can also be split into newline-aligned chunks
+// that are counted and parsed on several threads.  Prefix sums of
+// each chunk's counts tell it where its data goes, so the result
+// is identical to the single-threaded parse.
+//
+// The vertices match the original loader bit for bit:
+//  - Floats are correctly rounded, just like sscanf's %f
+//  - Positions, uvs and normals get the same RH -> LH conversion
+//  - Faces use the same (flipped) winding order
+//
+// With welding turned off, the output is exactly what the
+// original loader made: three unique vertices per triangle.
+// With welding on, face corners that reference the same
+// position/uv/normal triplet share a single vertex, so the
+// index buffer actually does some work.
+// --------------------------------------------------------
+
+namespace
+{
+	// Powers of ten that are exactly representable as doubles
+	const double exactPowersOfTen[] = {
+		1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+		1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+		1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+	inline bool IsSpace(char c)
+	{
+		// Note: Newlines are NOT spaces here, since they end records
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	inline bool IsDigit(char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	inline const char* SkipSpaces(const char* p, const char* end)
+	{
+		while (p < end && IsSpace(*p)) p++;
+		return p;
+	}
+
+	inline const char* NextLine(const char* p, const char* end)
+	{
+		const char* newline = (const char*)memchr(p, '\n', end - p);
+		return newline ? newline + 1 : end;
+	}
+
+	// --------------------------------------------------------
+	// Slow but exact fallback: hand the token to the CRT.
+	// Only used for numbers the fast path can't round exactly.
+	// --------------------------------------------------------
+	float ParseFloatSlow(const char* start, const char* end)
+	{
+		char buffer[64];
+		size_t length = end - start;
+		if (length > sizeof(buffer) - 1)
+			length = sizeof(buffer) - 1;
+		memcpy(buffer, start, length);
+		buffer[length] = 0;
+		return strtof(buffer, 0);
+	}
+
+	// --------------------------------------------------------
+	// Scans a float in the same format as sscanf's %f:
+	//   [+-]digits[.digits][(e|E)[+-]digits]
+	//
+	// Up to 19 significant digits are gathered into an integer,
+	// which is then scaled by an exact power of ten in double
+	// precision (Clinger's fast path).  Converting that double
+	// to float is only ambiguous when it lands exactly halfway
+	// between two floats, so those rare cases (and anything
+	// out of range) fall back to strtof().
+	// --------------------------------------------------------
+	bool ParseFloat(const char*& p, const char* end, float& out)
+	{
+		p = SkipSpaces(p, end);
+		const char* start = p;
+
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+		{
+			negative = (*p == '-');
+			p++;
+		}
+
+		uint64_t mantissa = 0;
+		int significantDigits = 0;
+		int exponent = 0;
+		bool anyDigits = false;
+
+		// Integer part
+		while (p < end && IsDigit(*p))
+		{
+			anyDigits = true;
+			if (mantissa != 0 || *p != '0')
+			{
+				if (significantDigits < 19)
+					mantissa = mantissa * 10 + (*p - '0');
+				else
+					exponent++;
+				significantDigits++;
+			}
+			p++;
+		}
+
+		// Fractional part
+		if (p < end && *p == '.')
+		{
+			p++;
+			while (p < end && IsDigit(*p))
+			{
+				anyDigits = true;
+				if (mantissa != 0 || *p != '0')
+				{
+					if (significantDigits < 19)
+					{
+						mantissa = mantissa * 10 + (*p - '0');
+						exponent--;
+					}
+					significantDigits++;
+				}
+				else
+				{
+					exponent--;
+				}
+				p++;
+			}
+		}
+
+		if (!anyDigits)
+		{
+			// Could be "inf" or "nan" - let the CRT decide
+			const char* tokenEnd = p;
+			while (tokenEnd < end && !IsSpace(*tokenEnd) && *tokenEnd != '\n' && *tokenEnd != '/') tokenEnd++;
+			if (tokenEnd == start)
+				return false;
+			out = ParseFloatSlow(start, tokenEnd);
+			p = tokenEnd;
+			return true;
+		}
+
+		// Optional exponent
+		if (p < end && (*p == 'e' || *p == 'E'))
+		{
+			const char* exponentStart = p;
+			p++;
+			bool negativeExponent = false;
+			if (p < end && (*p == '-' || *p == '+'))
+			{
+				negativeExponent = (*p == '-');
+				p++;
+			}
+
+			if (p < end && IsDigit(*p))
+			{
+				int value = 0;
+				while (p < end && IsDigit(*p))
+				{
+					if (value < 10000)
+						value = value * 10 + (*p - '0');
+					p++;
+				}
+				exponent += negativeExponent ? -value : value;
+			}
+			else
+			{
+				// Not actually an exponent, so don't consume it
+				p = exponentStart;
+			}
+		}
+
+		// Too many digits to hold exactly?  Take the slow road.
+		if (significantDigits > 19 || mantissa > (1ull << 53) || exponent < -22 || exponent > 22)
+		{
+			out = ParseFloatSlow(start, p);
+			return true;
+		}
+
+		double value = (double)mantissa;
+		if (exponent < 0)
+			value /= exactPowersOfTen[-exponent];
+		else
+			value *= exactPowersOfTen[exponent];
+
+		if (value != 0.0)
+		{
+			// A float keeps 24 of a double's 53 significant bits, so
+			// the low 29 bits being exactly "half" means a rounding tie
+			uint64_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+			if ((bits & 0x1FFFFFFFull) == 0x10000000ull || value < FLT_MIN || value > FLT_MAX)
+			{
+				out = ParseFloatSlow(start, p);
+				return true;
+			}
+		}
+
+		out = (float)(negative ? -value : value);
+		return true;
+	}
+
+	// Scans an int in the same format as sscanf's %d
+	bool ParseInt(const char*& p, const char* end, int& out)
+	{
+		p = SkipSpaces(p, end);
+
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+		{
+			negative = (*p == '-');
+			p++;
+		}
+
+		if (p >= end || !IsDigit(*p))
+			return false;
+
+		int value = 0;
+		while (p < end && IsDigit(*p))
+		{
+			value = value * 10 + (*p - '0');
+			p++;
+		}
+
+		out = negative ? -value : value;
+		return true;
+	}
+
+	// --------------------------------------------------------
+	// Converts a 1-based (or negative, relative) OBJ index into
+	// a 0-based array index.  Returns -1 if it's out of range.
+	// --------------------------------------------------------
+	inline int ResolveIndex(int objIndex, size_t count)
+	{
+		int index = objIndex > 0 ? objIndex - 1 : (int)count + objIndex;
+		return (objIndex != 0 && index >= 0 && index < (int)count) ? index : -1;
+	}
+
+	// A single "v/vt/vn" corner of a face, already resolved to 0-based
+	// indices.  Missing uvs and normals are stored as -1, unless a UV
+	// has already been read, in which case missing uvs use the first.
+	struct FaceCorner
+	{
+		int position;
+		int uv;
+		int normal;
+	};
+
+	// Reads one "v", "v/vt", "v//vn" or "v/vt/vn" face corner
+	bool ParseCorner(
+		const char*& p,
+		const char* end,
+		size_t positionCount,
+		size_t uvCount,
+		size_t normalCount,
+		FaceCorner& corner)
+	{
+		int value = 0;
+		if (!ParseInt(p, end, value))
+			return false;
+
+		// If there are no UVs for this corner, the original loader
+		// used the file's first UV (or created a single 0,0 UV)
+		corner.position = ResolveIndex(value, positionCount);
+		corner.uv = uvCount > 0 ? 0 : -1;
+		corner.normal = -1;
+		if (corner.position < 0)
+			return false;
+
+		if (p < end && *p == '/')
+		{
+			p++;
+			if (p < end && *p != '/')
+			{
+				if (!ParseInt(p, end, value))
+					return false;
+				corner.uv = ResolveIndex(value, uvCount);
+			}
+
+			if (p < end && *p == '/')
+			{
+				p++;
+				if (!ParseInt(p, end, value))
+					return false;
+				corner.normal = ResolveIndex(value, normalCount);
+			}
+		}
+
+		return true;
+	}
+
+	// --------------------------------------------------------
+	// Builds a final vertex from a face corner, converting it
+	// from the OBJ's right-handed space into DirectX's
+	// left-handed space along the way.
+	//
+	// The model is most likely in a right-handed space,
+	// especially if it came from Maya.  We want to convert
+	// to a left-handed space for DirectX.  This means we
+	// need to:
+	//  - Invert the Z position
+	//  - Invert the normal's Z
+	//  - Flip the winding order (done by the caller)
+	// We also need to flip the UV coordinate since DirectX
+	// defines (0,0) as the top left of the texture, and many
+	// 3D modeling packages use the bottom left as (0,0)
+	// --------------------------------------------------------
+	inline Vertex MakeVertex(
+		const FaceCorner& corner,
+		const XMFLOAT3* positions,
+		const XMFLOAT2* uvs,
+		const XMFLOAT3* normals)
+	{
+		Vertex v = {};
+		v.position = positions[corner.position];
+		v.normal = corner.normal >= 0 ? normals[corner.normal] : XMFLOAT3(0, 0, 0);
+		v.uv = corner.uv >= 0 ? uvs[corner.uv] : XMFLOAT2(0, 0);
+
+		// Flip the UV's since they're probably "upside down"
+		v.uv.y = 1.0f - v.uv.y;
+
+		// Flip Z (LH vs. RH)
+		v.position.z *= -1.0f;
+
+		// Flip normal's Z
+		v.normal.z *= -1.0f;
+
+		return v;
+	}
+
+	// Marks an empty welder slot, or a corner that needs a new vertex
+	const unsigned int newVertex = 0xFFFFFFFF;
+
+	// --------------------------------------------------------
+	// Open-addressing hash table from (position, uv, normal)
+	// index triplets to output vertex indices.  Every slot is
+	// allocated up front, so lookups never allocate - unless
+	// more than maxVertices turn up, in which case the table
+	// doubles instead of letting the load factor climb.
+	// --------------------------------------------------------
+	class VertexWelder
+	{
+	public:
+		VertexWelder(size_t maxVertices)
+		{
+			// Keep the load factor at or below 50%
+			size_t slotCount = 16;
+			while (slotCount < maxVertices * 2)
+				slotCount *= 2;
+
+			slots.assign(slotCount, newVertex);
+			keys.reserve(maxVertices);
+		}
+
+		// Returns the existing vertex index for this corner, or
+		// newVertex if it hasn't been seen (in which case it's
+		// recorded as the next vertex index)
+		unsigned int FindOrAdd(const FaceCorner& corner)
+		{
+			size_t mask = slots.size() - 1;
+			size_t slot = Hash(corner) & mask;
+			while (slots[slot] != newVertex)
+			{
+				const FaceCorner& existing = keys[slots[slot]];
+				if (existing.position == corner.position &&
+					existing.uv == corner.uv &&
+					existing.normal == corner.normal)
+					return slots[slot];
+				slot = (slot + 1) & mask;
+			}
+
+			slots[slot] = (unsigned int)keys.size();
+			keys.push_back(corner);
+			if (keys.size() * 2 > slots.size())
+				Grow();
+			return newVertex;
+		}
+
+	private:
+		static size_t Hash(const FaceCorner& corner)
+		{
+			return ((size_t)corner.position * 73856093u) ^
+				((size_t)corner.uv * 19349663u) ^
+				((size_t)corner.normal * 83492791u);
+		}
+
+		// Re-inserts every key into twice as many slots
+		void Grow()
+		{
+			slots.assign(slots.size() * 2, newVertex);
+			size_t mask = slots.size() - 1;
+			for (size_t i = 0; i < keys.size(); i++)
+			{
+				size_t slot = Hash(keys[i]) & mask;
+				while (slots[slot] != newVertex)
+					slot = (slot + 1) & mask;
+				slots[slot] = (unsigned int)i;
+			}
+		}
+
+		std::vector<unsigned int> slots;
+		std::vector<FaceCorner> keys;
+	};
+
+	// Number of each kind of record in (part of) a file
+	struct ObjCounts
+	{
+		size_t positions;
+		size_t uvs;
+		size_t normals;
+		size_t triangles;
+	};
+
+	// Destination arrays for vertex attributes, sized up front
+	struct ObjAttributes
+	{
+		XMFLOAT3* positions;
+		XMFLOAT2* uvs;
+		XMFLOAT3* normals;
+	};
+
+	// --------------------------------------------------------
+	// Counting pass: figures out exactly how big everything will
+	// be so that nothing reallocates while we're actually parsing
+	// --------------------------------------------------------
+	ObjCounts CountRecords(const char* begin, const char* end)
+	{
+		ObjCounts counts = {};
+		for (const char* line = begin; line < end; line = NextLine(line, end))
+		{
+			const char* p = SkipSpaces(line, end);
+			if (end - p < 2)
+				continue;
+
+			if (p[0] == 'v' && p[1] == 'n') counts.normals++;
+			else if (p[0] == 'v' && p[1] == 't') counts.uvs++;
+			else if (p[0] == 'v' && IsSpace(p[1])) counts.positions++;
+			else if (p[0] == 'f' && IsSpace(p[1]))
+			{
+				// Count the corners on this face
+				size_t corners = 0;
+				bool inToken = false;
+				for (p++; p < end && *p != '\n'; p++)
+				{
+					bool space = IsSpace(*p);
+					if (!space && !inToken) corners++;
+					inToken = !space;
+				}
+				if (corners >= 3)
+					counts.triangles += corners - 2;
+			}
+		}
+		return counts;
+	}
+
+	// --------------------------------------------------------
+	// Tokenizing pass over [begin, end)
+	//
+	// - "start" is how many of each attribute came before this
+	//   range, which is where this range's attributes are written
+	//   and what its face indices are validated against
+	// - Attributes and faces can be parsed separately, so that
+	//   a parallel load can finish every attribute before any
+	//   face (which may reference an earlier range) is resolved
+	// - Every triangle's corners go to addCorner, already in the
+	//   flipped winding order
+	// --------------------------------------------------------
+	template <typename CornerFunc>
+	void ParseRecords(
+		const char* begin,
+		const char* end,
+		ObjCounts start,
+		const ObjAttributes& attributes,
+		bool parseAttributes,
+		bool parseFaces,
+		CornerFunc& addCorner)
+	{
+		size_t positionCount = start.positions;
+		size_t uvCount = start.uvs;
+		size_t normalCount = start.normals;
+
+		for (const char* line = begin; line < end; line = NextLine(line, end))
+		{
+			const char* p = SkipSpaces(line, end);
+			if (end - p < 2)
+				continue;
+
+			// Check the type of line
+			if (p[0] == 'v' && p[1] == 'n')
+			{
+				// Read the 3 numbers directly into an XMFLOAT3
+				if (parseAttributes)
+				{
+					XMFLOAT3 norm(0, 0, 0);
+					p += 2;
+					ParseFloat(p, end, norm.x);
+					ParseFloat(p, end, norm.y);
+					ParseFloat(p, end, norm.z);
+					attributes.normals[normalCount] = norm;
+				}
+				normalCount++;
+			}
+			else if (p[0] == 'v' && p[1] == 't')
+			{
+				// Read the 2 numbers directly into an XMFLOAT2
+				if (parseAttributes)
+				{
+					XMFLOAT2 uv(0, 0);
+					p += 2;
+					ParseFloat(p, end, uv.x);
+					ParseFloat(p, end, uv.y);
+					attributes.uvs[uvCount] = uv;
+				}
+				uvCount++;
+			}
+			else if (p[0] == 'v' && IsSpace(p[1]))
+			{
+				// Read the 3 numbers directly into an XMFLOAT3
+				if (parseAttributes)
+				{
+					XMFLOAT3 pos(0, 0, 0);
+					p += 1;
+					ParseFloat(p, end, pos.x);
+					ParseFloat(p, end, pos.y);
+					ParseFloat(p, end, pos.z);
+					attributes.positions[positionCount] = pos;
+				}
+				positionCount++;
+			}
+			else if (parseFaces && p[0] == 'f' && IsSpace(p[1]))
+			{
+				// Faces are triangulated as a fan around the first
+				// corner, which gives the same two triangles the original
+				// loader made for quads, and also handles larger polygons
+				const char* lineEnd = NextLine(p, end);
+				p += 1;
+
+				FaceCorner first, previous, current;
+				if (!ParseCorner(p, lineEnd, positionCount, uvCount, normalCount, first) ||
+					!ParseCorner(p, lineEnd, positionCount, uvCount, normalCount, previous))
+					continue;
+
+				while (ParseCorner(p, lineEnd, positionCount, uvCount, normalCount, current))
+				{
+					// Add the corners (flipping the winding order)
+					addCorner(first);
+					addCorner(current);
+					addCorner(previous);
+
+					previous = current;
+				}
+			}
+		}
+	}
+
+	// Runs func(0) .. func(count - 1), one std::thread per call
+	// except the last, which runs on the calling thread
+	template <typename Func>
+	void RunOnThreads(unsigned int count, Func func)
+	{
+		std::vector<std::thread> threads;
+		threads.reserve(count);
+		for (unsigned int i = 0; i + 1 < count; i++)
+			threads.emplace_back(func, i);
+
+		func(count - 1);
+
+		for (auto& t : threads)
+			t.join();
+	}
+}
+
+bool LoadObj(const wchar_t* objFile, ObjMeshData& out, bool weldVertices, unsigned int threadCount)
+{
+	MappedFile file(objFile);
+
+	// Check for successful open
+	if (!file.IsOpen())
+		return false;
+
+	// Small files aren't worth spinning up threads for
+	if (threadCount == 0)
+		threadCount = file.GetSize() >= objParallelThreshold ? std::thread::hardware_concurrency() : 1;
+
+	if (threadCount > 1)
+		return ParseObjParallel(file.GetData(), file.GetSize(), out, weldVertices, threadCount);
+
+	return ParseObj(file.GetData(), file.GetSize(), out, weldVertices);
+}
+
+bool ParseObj(const char* data, size_t size, ObjMeshData& out, bool weldVertices)
+{
+	const char* end = data + size;
+	ObjCounts counts = CountRecords(data, end);
+
+	// Variables used while reading the file
+	std::vector<XMFLOAT3> positions(counts.positions);	// Positions from the file
+	std::vector<XMFLOAT3> normals(counts.normals);		// Normals from the file
+	std::vector<XMFLOAT2> uvs(counts.uvs);				// UVs from the file
+	ObjAttributes attributes = { positions.data(), uvs.data(), normals.data() };
+
+	out.vertices.clear();
+	out.indices.clear();
+	out.vertices.reserve(counts.triangles * 3);
+	out.indices.reserve(counts.triangles * 3);
+
+	// Only needed when sharing vertices between faces
+	VertexWelder welder(weldVertices ? counts.triangles * 3 : 0);
+
+	// Adds a single face corner to the output, either as a brand
+	// new vertex or by re-using an identical one from earlier
+	auto addCorner = [&](const FaceCorner& corner)
+	{
+		unsigned int index = weldVertices ? welder.FindOrAdd(corner) : newVertex;
+		if (index == newVertex)
+		{
+			index = (unsigned int)out.vertices.size();
+			out.vertices.push_back(MakeVertex(corner, attributes.positions, attributes.uvs, attributes.normals));
+		}
+		out.indices.push_back(index);
+	};
+
+	// Single tokenizing pass for both attributes and faces
+	ObjCounts start = {};
+	ParseRecords(data, end, start, attributes, true, true, addCorner);
+
+	return !out.vertices.empty();
+}
+
+bool ParseObjParallel(const char* data, size_t size, ObjMeshData& out, bool weldVertices, unsigned int threadCount)
+{
+	if (threadCount == 0)
+		threadCount = std::thread::hardware_concurrency();
+	if (threadCount == 0)
+		threadCount = 1;
+
+	// Split the file into one chunk per thread, nudging each
+	// split point forward so that chunks only ever end on a newline
+	const char* end = data + size;
+	std::vector<const char*> splits(threadCount + 1, end);
+	splits[0] = data;
+	for (unsigned int i = 1; i < threadCount; i++)
+	{
+		const char* split = data + size / threadCount * i;
+		splits[i] = split <= splits[i - 1] ? splits[i - 1] : NextLine(split - 1, end);
+	}
+
+	// 1. Count every chunk's records in parallel
+	std::vector<ObjCounts> chunkCounts(threadCount);
+	RunOnThreads(threadCount, [&](unsigned int i)
+	{
+		chunkCounts[i] = CountRecords(splits[i], splits[i + 1]);
+	});
+
+	// Prefix sums give each chunk the global index of its first
+	// position, uv, normal and face corner
+	std::vector<ObjCounts> chunkStarts(threadCount);
+	ObjCounts totals = {};
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		chunkStarts[i] = totals;
+		totals.positions += chunkCounts[i].positions;
+		totals.uvs += chunkCounts[i].uvs;
+		totals.normals += chunkCounts[i].normals;
+		totals.triangles += chunkCounts[i].triangles;
+	}
+
+	// 2. Parse every attribute straight into its final slot
+	std::vector<XMFLOAT3> positions(totals.positions);
+	std::vector<XMFLOAT3> normals(totals.normals);
+	std::vector<XMFLOAT2> uvs(totals.uvs);
+	ObjAttributes attributes = { positions.data(), uvs.data(), normals.data() };
+
+	RunOnThreads(threadCount, [&](unsigned int i)
+	{
+		auto ignoreCorner = [](const FaceCorner&) {};
+		ParseRecords(splits[i], splits[i + 1], chunkStarts[i], attributes, true, false, ignoreCorner);
+	});
+
+	// 3. Resolve every face corner, now that all the attributes
+	// exist.  Faces that fail to parse may leave a chunk with
+	// fewer corners than were counted, so track how many were used.
+	std::vector<FaceCorner> corners(totals.triangles * 3);
+	std::vector<size_t> chunkCornerCounts(threadCount);
+	RunOnThreads(threadCount, [&](unsigned int i)
+	{
+		FaceCorner* chunkCorners = corners.data() + chunkStarts[i].triangles * 3;
+		size_t count = 0;
+		auto addCorner = [&](const FaceCorner& corner) { chunkCorners[count++] = corner; };
+		ParseRecords(splits[i], splits[i + 1], chunkStarts[i], attributes, false, true, addCorner);
+		chunkCornerCounts[i] = count;
+	});
+
+	// 4. Build the vertices and indices in file order
+	out.vertices.clear();
+	out.indices.clear();
+	if (weldVertices)
+	{
+		// Which corners get merged depends on the order they're seen
+		// in, so welding stays serial to exactly match ParseObj()
+		VertexWelder welder(totals.triangles * 3);
+		out.vertices.reserve(totals.triangles * 3);
+		out.indices.reserve(totals.triangles * 3);
+		for (unsigned int i = 0; i < threadCount; i++)
+		{
+			const FaceCorner* chunkCorners = corners.data() + chunkStarts[i].triangles * 3;
+			for (size_t c = 0; c < chunkCornerCounts[i]; c++)
+			{
+				unsigned int index = welder.FindOrAdd(chunkCorners[c]);
+				if (index == newVertex)
+				{
+					index = (unsigned int)out.vertices.size();
+					out.vertices.push_back(MakeVertex(chunkCorners[c], attributes.positions, attributes.uvs, attributes.normals));
+				}
+				out.indices.push_back(index);
+			}
+		}
+	}
+	else
+	{
+		// Every corner is its own vertex, so chunks can be
+		// converted in parallel once they know where they start
+		std::vector<size_t> outputStarts(threadCount);
+		size_t total = 0;
+		for (unsigned int i = 0; i < threadCount; i++)
+		{
+			outputStarts[i] = total;
+			total += chunkCornerCounts[i];
+		}
+
+		out.vertices.resize(total);
+		out.indices.resize(total);
+		RunOnThreads(threadCount, [&](unsigned int i)
+		{
+			const FaceCorner* chunkCorners = corners.data() + chunkStarts[i].triangles * 3;
+			for (size_t c = 0; c < chunkCornerCounts[i]; c++)
+			{
+				size_t index = outputStarts[i] + c;
+				out.vertices[index] = MakeVertex(chunkCorners[c], attributes.positions, attributes.uvs, attributes.normals);
+				out.indices[index] = (unsigned int)index;
+			}
+		});
+	}
+
+	return !out.vertices.empty();
+}
+
+// --------------------------------------------------------
+// The same two passes as ParseObj(), but the tokenizing pass
+// hands each finished chunk of vertices and indices to the
+// writer instead of keeping them
+//
+// What stays in memory:
+//  - The positions, uvs and normals, since any face can use
+//    any of them
+//  - With welding, the welder's table and a tangent sum for
+//    each output vertex, since any later face can share one
+//  - One chunk each of vertices and indices
+//
+// Tangents are summed per triangle as the faces go by, then
+// written into the vertices on a second trip through the
+// writer's file.  Without welding, each vertex belongs to one
+// triangle, so its tangent is finished straight away.
+// --------------------------------------------------------
+bool StreamObj(const char* data, size_t size, CookedMeshWriter& writer, MeshBounds& bounds, bool weldVertices)
+{
+	const char* end = data + size;
+	ObjCounts counts = CountRecords(data, end);
+
+	std::vector<XMFLOAT3> positions(counts.positions);
+	std::vector<XMFLOAT3> normals(counts.normals);
+	std::vector<XMFLOAT2> uvs(counts.uvs);
+	ObjAttributes attributes = { positions.data(), uvs.data(), normals.data() };
+
+	// Most scans have about one vertex per position, and the
+	// welder grows if there turn out to be more
+	VertexWelder welder(weldVertices ? counts.positions : 0);
+	std::vector<XMFLOAT3> tangentSums;
+	if (weldVertices)
+		tangentSums.reserve(counts.positions);
+
+	std::vector<Vertex> vertexChunk;
+	std::vector<unsigned int> indexChunk;
+	vertexChunk.reserve(objStreamChunkSize);
+	indexChunk.reserve(objStreamChunkSize);
+
+	unsigned long long vertexCount = 0;
+	bool written = writer.IsOpen();
+
+	// The current triangle's corners, until all three are in
+	unsigned int triangle[3];
+	XMFLOAT3 trianglePositions[3];
+	XMFLOAT2 triangleUvs[3];
+	int corners = 0;
+
+	auto addCorner = [&](const FaceCorner& corner)
+	{
+		unsigned int index = weldVertices ? welder.FindOrAdd(corner) : newVertex;
+		Vertex vertex = MakeVertex(corner, attributes.positions, attributes.uvs, attributes.normals);
+		if (index == newVertex)
+		{
+			index = (unsigned int)vertexCount++;
+			vertexChunk.push_back(vertex);
+			if (weldVertices)
+				tangentSums.push_back(XMFLOAT3(0, 0, 0));
+		}
+		indexChunk.push_back(index);
+
+		triangle[corners] = index;
+		trianglePositions[corners] = vertex.position;
+		triangleUvs[corners] = vertex.uv;
+		if (++corners < 3)
+			return;
+		corners = 0;
+
+		XMFLOAT3 tangent = GetTriangleTangent(trianglePositions, triangleUvs);
+		if (weldVertices)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				XMFLOAT3& sum = tangentSums[triangle[k]];
+				sum.x += tangent.x;
+				sum.y += tangent.y;
+				sum.z += tangent.z;
+			}
+		}
+		else
+		{
+			// Unwelded, the triangle's vertices are the last three
+			for (size_t k = vertexChunk.size() - 3; k < vertexChunk.size(); k++)
+				FinishTangent(vertexChunk[k], tangent);
+		}
+
+		// Chunks only ever end on a whole triangle
+		if (vertexChunk.size() >= objStreamChunkSize)
+		{
+			written = writer.WriteVertices(&vertexChunk[0], vertexChunk.size()) && written;
+			vertexChunk.clear();
+		}
+		if (indexChunk.size() >= objStreamChunkSize)
+		{
+			written = writer.WriteIndices(&indexChunk[0], indexChunk.size()) && written;
+			indexChunk.clear();
+		}
+	};
+
+	ObjCounts start = {};
+	ParseRecords(data, end, start, attributes, true, true, addCorner);
+
+	if (!vertexChunk.empty())
+		written = writer.WriteVertices(&vertexChunk[0], vertexChunk.size()) && written;
+	if (!indexChunk.empty())
+		written = writer.WriteIndices(&indexChunk[0], indexChunk.size()) && written;
+
+	if (weldVertices && written && vertexCount > 0)
+	{
+		written = writer.UpdateVertices([&](Vertex* vertices, size_t firstVertex, size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+				FinishTangent(vertices[i], tangentSums[firstVertex + i]);
+		});
+	}
+
+	// Bounds of every position, in the same LH space as the vertices
+	for (XMFLOAT3& position : positions)
+		position.z *= -1.0f;
+	bounds = ComputeBounds(positions.data(), positions.size());
+
+	return written && vertexCount > 0;
+}
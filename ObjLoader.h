@@ -0,0 +1,52 @@
+#pragma once
+#include <vector>
+#include "Vertex.h"
+
+class CookedMeshWriter;
+struct MeshBounds;
+
+// --------------------------------------------------------
+// Final, GPU-ready output of the OBJ loader
+//
+// - "vertices" can go directly into a vertex buffer
+// - "indices" can go directly into an index buffer
+// --------------------------------------------------------
+struct ObjMeshData
+{
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+};
+
+// Files at least this big are parsed on multiple threads by LoadObj()
+const size_t objParallelThreshold = 4 * 1024 * 1024;
+
+// Memory maps the file and parses it in place
+// - weldVertices: share vertices between faces when their
+//   position, uv and normal indices all match
+// - threadCount: 0 picks automatically based on the file size
+bool LoadObj(const wchar_t* objFile, ObjMeshData& out, bool weldVertices = true, unsigned int threadCount = 0);
+
+// Parses OBJ text that is already in memory (need not be null terminated)
+bool ParseObj(const char* data, size_t size, ObjMeshData& out, bool weldVertices = true);
+
+// Same as ParseObj(), with identical output, but splits the text
+// into newline-aligned chunks that are parsed on separate threads
+// - threadCount: 0 uses every hardware thread
+bool ParseObjParallel(const char* data, size_t size, ObjMeshData& out, bool weldVertices = true, unsigned int threadCount = 0);
+
+// StreamObj() hands its output to the writer this many vertices
+// (and this many indices) at a time
+const size_t objStreamChunkSize = 64 * 1024;
+
+// --------------------------------------------------------
+// Converts an OBJ straight into a cooked mesh without ever
+// holding the whole mesh, for scans too big to load at once
+//
+// - Memory use follows the file's position, uv and normal
+//   counts (and the welded vertex count), never its face count
+// - The vertices and indices match ParseObj()'s, with tangents
+//   from the same math as GenerateTangents()
+// - bounds holds every position in the file, used or not
+// - Call writer.Finish() afterwards if this succeeds
+// --------------------------------------------------------
+bool StreamObj(const char* data, size_t size, CookedMeshWriter& writer, MeshBounds& bounds, bool weldVertices = true);
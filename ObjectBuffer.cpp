@@ -0,0 +1,137 @@
+#include "ObjectBuffer.h"
+
+ObjectBuffer::ObjectBuffer(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	unsigned int initialCapacity)
+	:
+	device(device),
+	context(context),
+	capacity(0),
+	uploadAll(false),
+	uploadBytes(0),
+	uploadCount(0)
+{
+	Grow(initialCapacity > 0 ? initialCapacity : 1);
+}
+
+unsigned int ObjectBuffer::Add(std::shared_ptr<Transform> transform)
+{
+	unsigned int index = (unsigned int)transforms.size();
+	if (index == capacity)
+		Grow(capacity * 2);
+
+	transforms.push_back(transform);
+
+	// Anything but its current version, so the next Update() sends it
+	versions.push_back(transform->GetVersion() - 1);
+	return index;
+}
+
+// --------------------------------------------------------
+// Changed entries are gathered into runs of neighbors, and
+// each run goes up with one UpdateSubresource() when an
+// unchanged entry (or the end) interrupts it
+// - Only changed entries ask their Transform for matrices,
+//   so unchanged inverse transposes are never even built
+// --------------------------------------------------------
+unsigned int ObjectBuffer::Update()
+{
+	uploadBytes = 0;
+	uploadCount = 0;
+
+	unsigned int runStart = 0;
+	auto flush = [&]()
+	{
+		if (run.empty())
+			return;
+
+		unsigned int bytes = (unsigned int)(run.size() * sizeof(ObjectData));
+		D3D11_BOX box = {};
+		box.left = runStart * sizeof(ObjectData);
+		box.right = box.left + bytes;
+		box.top = 0;
+		box.bottom = 1;
+		box.front = 0;
+		box.back = 1;
+		context->UpdateSubresource(buffer.Get(), 0, &box, &run[0], 0, 0);
+
+		uploadBytes += bytes;
+		uploadCount += (unsigned int)run.size();
+		run.clear();
+	};
+
+	for (unsigned int i = 0; i < transforms.size(); i++)
+	{
+		unsigned int version = transforms[i]->GetVersion();
+		if (!uploadAll && version == versions[i])
+		{
+			flush();
+			continue;
+		}
+
+		if (run.empty())
+			runStart = i;
+
+		ObjectData data;
+		data.world = transforms[i]->GetWorldMatrix();
+		data.worldInverseTranspose = transforms[i]->GetWorldInverseTransposeMatrix();
+		run.push_back(data);
+		versions[i] = version;
+	}
+	flush();
+
+	uploadAll = false;
+	return uploadBytes;
+}
+
+void ObjectBuffer::Bind()
+{
+	context->VSSetShaderResources(objectBufferRegister, 1, srv.GetAddressOf());
+}
+
+unsigned int ObjectBuffer::GetCount()
+{
+	return (unsigned int)transforms.size();
+}
+
+unsigned int ObjectBuffer::GetUploadBytes()
+{
+	return uploadBytes;
+}
+
+unsigned int ObjectBuffer::GetUploadCount()
+{
+	return uploadCount;
+}
+
+// --------------------------------------------------------
+// A default usage buffer, so entries can be replaced a few
+// at a time with UpdateSubresource()
+// - The old contents aren't copied over; every entry is sent
+//   again by the next Update() instead
+// --------------------------------------------------------
+void ObjectBuffer::Grow(unsigned int newCapacity)
+{
+	D3D11_BUFFER_DESC desc = {};
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.ByteWidth = newCapacity * sizeof(ObjectData);
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	desc.CPUAccessFlags = 0;
+	desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	desc.StructureByteStride = sizeof(ObjectData);
+
+	buffer.Reset();
+	srv.Reset();
+	device->CreateBuffer(&desc, 0, buffer.GetAddressOf());
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+	srvDesc.Buffer.FirstElement = 0;
+	srvDesc.Buffer.NumElements = newCapacity;
+	device->CreateShaderResourceView(buffer.Get(), &srvDesc, srv.GetAddressOf());
+
+	capacity = newCapacity;
+	uploadAll = true;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include <wrl/client.h>
+#include "Transform.h"
+
+// Vertex shader register the buffer is bound to - see ObjectData.hlsli
+const unsigned int objectBufferRegister = 0;
+
+// --------------------------------------------------------
+// One object's entry in the buffer
+// - This must match ObjectData in ObjectData.hlsli
+// --------------------------------------------------------
+struct ObjectData
+{
+	DirectX::XMFLOAT4X4 world;
+	DirectX::XMFLOAT4X4 worldInverseTranspose;
+};
+
+// --------------------------------------------------------
+// Every object's matrices in one structured buffer that stays
+// on the GPU between frames, so only the objects that moved
+// are sent again
+//
+// - Each object remembers the version of its Transform that
+//   was last uploaded (see Transform::GetVersion()), and
+//   Update() sends only the entries whose version changed
+// - Neighboring changed entries go up in one call
+// - Shaders find their object with the index Add() returned
+// - The buffer doubles in size when it fills up, which sends
+//   every entry again
+// --------------------------------------------------------
+class ObjectBuffer
+{
+public:
+	ObjectBuffer(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		unsigned int initialCapacity = 64);
+
+	// Returns the object's index in the buffer; it's uploaded by
+	// the next Update()
+	unsigned int Add(std::shared_ptr<Transform> transform);
+
+	// Uploads every entry whose transform changed since it was
+	// last uploaded, and returns the number of bytes sent
+	unsigned int Update();
+
+	// Binds the buffer to objectBufferRegister in the vertex
+	// shader stage
+	void Bind();
+
+	unsigned int GetCount();
+
+	// What the last Update() sent
+	unsigned int GetUploadBytes();
+	unsigned int GetUploadCount();
+
+private:
+	void Grow(unsigned int newCapacity);
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+	unsigned int capacity;
+	bool uploadAll;
+
+	std::vector<std::shared_ptr<Transform>> transforms;
+	std::vector<unsigned int> versions;	// Last uploaded
+	std::vector<ObjectData> run;		// Changed entries waiting to go up together
+
+	unsigned int uploadBytes;
+	unsigned int uploadCount;
+};
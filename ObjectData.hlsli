@@ -0,0 +1,17 @@
+#ifndef __GGP_OBJECT_DATA__ // Each .hlsli file needs a unique identifier!
+#define __GGP_OBJECT_DATA__
+
+// One object's matrices
+// - This must match ObjectData in ObjectBuffer.h
+struct ObjectData
+{
+    matrix world;
+    matrix worldInvTranspose;
+};
+
+// Every object's matrices, kept on the GPU between frames and only
+// patched where something moved - see ObjectBuffer.h
+// - The register must match objectBufferRegister
+StructuredBuffer<ObjectData> objects : register(t0);
+
+#endif
@@ -1,6 +1,7 @@
 
 #include <Windows.h>
 #include <codecvt>
+#include <cwctype>
 #include <locale>
 
 #include "PathHelpers.h"
@@ -97,4 +98,24 @@ std::wstring NarrowToWide(const std::string& str)
 {
 	std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
 	return converter.from_bytes(str);
+}
+
+
+// ----------------------------------------------------
+//  Turns any spelling of a path into a single one, so
+//  it can be used to tell whether two paths are the
+//  same file:
+//  - Made absolute, with "." and ".." resolved
+//  - Forward slashes become back slashes
+//  - Lower case, as Windows paths ignore case
+// ----------------------------------------------------
+std::wstring NormalizePath(const std::wstring& path)
+{
+	wchar_t fullPath[1024] = {};
+	DWORD length = GetFullPathNameW(path.c_str(), 1024, fullPath, 0);
+
+	std::wstring normalized = (length > 0 && length < 1024) ? fullPath : path;
+	for (wchar_t& c : normalized)
+		c = c == L'/' ? L'\\' : towlower(c);
+	return normalized;
 }
\ No newline at end of file
@@ -8,4 +8,7 @@ std::string GetExePath();
 std::string FixPath(const std::string& relativeFilePath);
 std::wstring FixPath(const std::wstring& relativeFilePath);
 std::string WideToNarrow(const std::wstring& str);
-std::wstring NarrowToWide(const std::string& str);
\ No newline at end of file
+std::wstring NarrowToWide(const std::string& str);
+
+// A single spelling for any path to the same file, for use as a key
+std::wstring NormalizePath(const std::wstring& path);
\ No newline at end of file
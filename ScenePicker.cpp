@@ -0,0 +1,130 @@
+#include "ScenePicker.h"
+
+#include <cfloat>
+
+using namespace DirectX;
+
+ScenePicker::ScenePicker()
+	:
+	depth(0)
+{
+}
+
+void ScenePicker::Build(const std::vector<std::shared_ptr<GameEntity>>& sceneEntities)
+{
+	entities = sceneEntities;
+	meshes.resize(entities.size());
+	versions.resize(entities.size());
+	boxes.resize(entities.size());
+	worldToLocal.resize(entities.size());
+
+	for (unsigned int e = 0; e < entities.size(); e++)
+	{
+		meshes[e] = entities[e]->GetMesh().get();
+		UpdateEntity(e);
+	}
+
+	depth = BuildBvh(boxes, sceneMaxLeafEntities, nodes, order);
+}
+
+unsigned int ScenePicker::Refit()
+{
+	unsigned int moved = 0;
+	for (unsigned int e = 0; e < entities.size(); e++)
+	{
+		if (entities[e]->GetTransform()->GetVersion() != versions[e])
+		{
+			UpdateEntity(e);
+			moved++;
+		}
+	}
+
+	if (moved > 0)
+		RefitBvh(nodes, boxes, order);
+	return moved;
+}
+
+// --------------------------------------------------------
+// An entity that can't be moved into local space gets a box
+// with min > max, which no ray ever hits
+// --------------------------------------------------------
+void ScenePicker::UpdateEntity(unsigned int e)
+{
+	std::shared_ptr<Transform> transform = entities[e]->GetTransform();
+	versions[e] = transform->GetVersion();
+
+	XMFLOAT4X4 world = transform->GetWorldMatrix();
+	XMVECTOR determinant;
+	XMMATRIX inverse = XMMatrixInverse(&determinant, XMLoadFloat4x4(&world));
+	XMStoreFloat4x4(&worldToLocal[e], inverse);
+
+	if (XMVectorGetX(determinant) == 0.0f)
+	{
+		boxes[e].min = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+		boxes[e].max = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		return;
+	}
+
+	MeshBounds bounds = entities[e]->GetWorldBounds();
+	boxes[e].min = bounds.aabbMin;
+	boxes[e].max = bounds.aabbMax;
+}
+
+// --------------------------------------------------------
+// Moving a ray by an affine matrix keeps every point at the
+// same distance along it (in units of its direction), so a
+// local-space hit's distance is also the world-space one and
+// the closest distance carries between entities unchanged
+// --------------------------------------------------------
+bool ScenePicker::Raycast(const XMFLOAT3& origin, const XMFLOAT3& direction, float maxDistance, PickHit& hit)
+{
+	XMVECTOR worldOrigin = XMLoadFloat3(&origin);
+	XMVECTOR worldDirection = XMLoadFloat3(&direction);
+
+	auto testLeaf = [&](unsigned int first, unsigned int count, float& closest)
+	{
+		bool found = false;
+		for (unsigned int k = first; k < first + count; k++)
+		{
+			unsigned int e = order[k];
+			XMMATRIX inverse = XMLoadFloat4x4(&worldToLocal[e]);
+			XMFLOAT3 localOrigin;
+			XMFLOAT3 localDirection;
+			XMStoreFloat3(&localOrigin, XMVector3TransformCoord(worldOrigin, inverse));
+			XMStoreFloat3(&localDirection, XMVector3TransformNormal(worldDirection, inverse));
+
+			RayHit meshHit;
+			if (meshes[e]->Raycast(localOrigin, localDirection, closest, meshHit))
+			{
+				closest = meshHit.distance;
+				hit.entity = (int)e;
+				hit.distance = meshHit.distance;
+				hit.triangle = meshHit.triangle;
+				found = true;
+			}
+		}
+		return found;
+	};
+
+	float closest = maxDistance;
+	if (!TraverseBvh<false>(nodes, origin, direction, closest, testLeaf))
+		return false;
+
+	XMStoreFloat3(&hit.position, worldOrigin + worldDirection * hit.distance);
+	return true;
+}
+
+unsigned int ScenePicker::GetEntityCount()
+{
+	return (unsigned int)entities.size();
+}
+
+unsigned int ScenePicker::GetNodeCount()
+{
+	return (unsigned int)nodes.size();
+}
+
+unsigned int ScenePicker::GetDepth()
+{
+	return depth;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <DirectXMath.h>
+#include "Bvh.h"
+#include "GameEntity.h"
+
+// Most entities a single leaf of the scene's BVH holds - kept
+// small, since testing an entity means a whole mesh raycast
+const unsigned int sceneMaxLeafEntities = 2;
+
+// --------------------------------------------------------
+// The closest entity a pick ray hit
+// --------------------------------------------------------
+struct PickHit
+{
+	int entity;					// Index in the list given to Build()
+	float distance;				// Along the world-space ray
+	unsigned int triangle;		// Which of the mesh's triangles
+	DirectX::XMFLOAT3 position;	// World-space hit point
+};
+
+// --------------------------------------------------------
+// Ray queries against a whole scene, for mouse picking
+//
+// - A top-level BVH over every entity's world bounds finds
+//   the entities a ray might hit, nearest first
+// - Each of those is refined by moving the ray into the
+//   entity's local space and casting it against its mesh's
+//   own BVH (see Mesh::Raycast), so the mesh never has to be
+//   transformed
+// - Refit() follows entities as they move; Build() again
+//   after adding or removing entities, or once they've moved
+//   far enough that the refit tree is slow to query
+// - Entities whose meshes were loaded without a BVH, or that
+//   are scaled to nothing, can't be picked
+// --------------------------------------------------------
+class ScenePicker
+{
+public:
+	ScenePicker();
+
+	void Build(const std::vector<std::shared_ptr<GameEntity>>& sceneEntities);
+
+	// Catches up with transforms that changed since the last
+	// Build() or Refit(), returning how many entities moved
+	// - Only checks version numbers when nothing moved
+	unsigned int Refit();
+
+	// Finds the closest entity hit nearer than maxDistance (in
+	// units of the direction's length)
+	bool Raycast(
+		const DirectX::XMFLOAT3& origin,
+		const DirectX::XMFLOAT3& direction,
+		float maxDistance,
+		PickHit& hit);
+
+	unsigned int GetEntityCount();
+	unsigned int GetNodeCount();
+	unsigned int GetDepth();
+
+private:
+	// Re-reads one entity's bounds and world matrix
+	void UpdateEntity(unsigned int e);
+
+	std::vector<std::shared_ptr<GameEntity>> entities;
+	std::vector<Mesh*> meshes;
+	std::vector<unsigned int> versions;
+	std::vector<BvhBox> boxes;
+	std::vector<DirectX::XMFLOAT4X4> worldToLocal;
+
+	std::vector<BvhNode> nodes;
+	std::vector<unsigned int> order;
+	unsigned int depth;
+};
@@ -1,14 +1,20 @@
 #include "Include.hlsli"
+#include "ObjectData.hlsli"
 
 // Constant Buffer for external (C++) data
 cbuffer externalData : register(b0)
 {
-    matrix world;
     matrix view;
     matrix projection;
-    
+    uint objectIndex; // This object's entry in objects
+#ifdef COMPACT_VERTICES
+    float3 positionOffset;
+    float3 positionScale;
+#endif
 };
 
+// Only the position is read, so this works with a mesh's full vertex
+// stream or its position-only stream (see Mesh::DrawDepthOnly())
 struct VertexShaderInput
 {
 	// Data type
@@ -16,10 +22,11 @@ struct VertexShaderInput
 	//  |   Name          Semantic
 	//  |    |                |
 	//  v    v                v
+#ifdef COMPACT_VERTICES
+    float4 position : POSITION; // UNORM: 0-1 within the mesh's box
+#else
     float3 localPosition : POSITION; // XYZ position
-    float3 normal : NORMAL;
-    float3 tangent : TANGENT;
-    float2 uv : UV;
+#endif
 };
 
 // --------------------------------------------------------
@@ -27,6 +34,11 @@ struct VertexShaderInput
 // --------------------------------------------------------
 float4 main(VertexShaderInput input) : SV_POSITION
 {
-    matrix wvp = mul(projection, mul(view, world));
-    return mul(wvp, float4(input.localPosition, 1.0f));
+#ifdef COMPACT_VERTICES
+    float3 localPosition = positionOffset + input.position.xyz * positionScale;
+#else
+    float3 localPosition = input.localPosition;
+#endif
+    matrix wvp = mul(projection, mul(view, objects[objectIndex].world));
+    return mul(wvp, float4(localPosition, 1.0f));
 }
\ No newline at end of file
@@ -3,196 +3,185 @@
 
 using namespace DirectX;
 
-Transform::Transform() {
-	position = XMFLOAT3(0.0f, 0.0f, 0.0f);
-	rotation = XMFLOAT3(0.0f, 0.0f, 0.0f);
-	scale = XMFLOAT3(1.0f, 1.0f, 1.0f);
-	matrixChanged = false;
-
-	//local transform variables
-	up = XMFLOAT3(0.0, 1.0, 0.0);
-	right = XMFLOAT3(1.0, 0.0, 0.0);
-	forward = XMFLOAT3(0.0, 0.0, 1.0);
-	vectorsChanged = false;
-
-	XMStoreFloat4x4(&world, XMMatrixIdentity());
-	XMStoreFloat4x4(&worldInverseTranspose, XMMatrixIdentity());
+Transform::Transform()
+	: Transform(TransformSystem::GetInstance())
+{
 }
 
-Transform::~Transform() {
-
+Transform::Transform(TransformSystem& system) {
+	this->system = &system;
+	slot = system.Create();
 }
 
-//UPDATER FUNCTIONS ===========================================
-
-void Transform::UpdateMatrices() {
-	//do stuff (update matrix using values)
-	if (matrixChanged) {
-		XMMATRIX translationMatrix = XMMatrixTranslation(position.x, position.y, position.z);
-		XMMATRIX scaleMatrix = XMMatrixScaling(scale.x, scale.y, scale.z);
-		XMMATRIX rotationMatrix = XMMatrixRotationRollPitchYaw(rotation.x, rotation.y, rotation.z);
-
-		XMMATRIX worldXM = scaleMatrix * rotationMatrix * translationMatrix;
-
-		XMStoreFloat4x4(&world, worldXM);
-		XMStoreFloat4x4(&worldInverseTranspose, XMMatrixInverse(0, XMMatrixTranspose(worldXM)));
+//the slot moves with it, and the moved-from transform no longer owns one
+Transform::Transform(Transform&& other) {
+	system = other.system;
+	slot = other.slot;
+	other.system = nullptr;
+}
 
-		matrixChanged = false;
+void Transform::CopyFrom(const Transform& other) {
+	if (this != &other) {
+		system->Copy(slot, *other.system, other.slot);
 	}
 }
 
-void Transform::UpdateVectors()
+Transform::~Transform() {
+	if (system)
+		system->Destroy(slot);
+}
+
+//HELPER FUNCTIONS ===========================================
+
+namespace
 {
-	if (vectorsChanged) {
-		XMVECTOR rotationQuat = XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&rotation)); //get rotation matrix
-		XMStoreFloat3(&right, XMVector3Rotate(XMVECTOR({ 1, 0, 0 }), rotationQuat)); //apply rotation to all vectors starting from zero 
-		XMStoreFloat3(&up, XMVector3Rotate(XMVECTOR({ 0,1,0 }), rotationQuat));
-		XMStoreFloat3(&forward, XMVector3Rotate(XMVECTOR({ 0,0,1 }), rotationQuat));
+	//rotates a local-space vector by the transform's stored quaternion (no trig needed)
+	XMVECTOR RotateLocal(XMFLOAT4 rotation, XMVECTOR local)
+	{
+		return XMVector3Rotate(local, XMLoadFloat4(&rotation));
 	}
-
-	vectorsChanged = false; //we are clean
 }
 
 //MAIN TRANSFORM OPERATION FUNCTIONS ===========================================
 
 //TRANSLATION
 void Transform::MoveAbsolute(float x, float y, float z) {
-	UpdateMatrices();
+	XMFLOAT3 position = GetPosition();
 	SetPosition(position.x + x, position.y + y, position.z + z);
 }
 
 void Transform::MoveAbsolute(DirectX::XMFLOAT3 offset) {
-	UpdateMatrices();
-	SetPosition(position.x + offset.x, position.y + offset.y, position.z + offset.z);
+	MoveAbsolute(offset.x, offset.y, offset.z);
 }
 
 void Transform::MoveRelative(float x, float y, float z)
 {
-	XMVECTOR movement = { x, y, z, 0.0f };
-	XMVECTOR rotationQuat = XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&rotation));
-
-	XMVECTOR newDirection = XMVector3Rotate(movement, rotationQuat);
-	movement = XMLoadFloat3(&position) + newDirection;
-	XMStoreFloat3(&position, movement);
+	MoveRelative(XMFLOAT3(x, y, z));
 }
 
 void Transform::MoveRelative(DirectX::XMFLOAT3 offset)
 {
-	XMVECTOR movement = XMLoadFloat3(&offset);
-	XMVECTOR rotationQuat = XMQuaternionRotationRollPitchYawFromVector(XMLoadFloat3(&rotation));
-
-	XMVECTOR newDirection = XMVector3Rotate(movement, rotationQuat);
-	movement = XMLoadFloat3(&position) + newDirection;
-	XMStoreFloat3(&position, movement);
+	XMFLOAT3 position = GetPosition();
+	XMVECTOR newDirection = RotateLocal(GetRotation(), XMLoadFloat3(&offset));
+	XMStoreFloat3(&position, XMLoadFloat3(&position) + newDirection);
+	SetPosition(position);
 }
 
 //ROTATION
 void Transform::Rotate(float pitch, float yaw, float roll) {
-	UpdateMatrices();
+	XMFLOAT3 rotation = GetPitchYawRoll();
 	SetRotation(rotation.x + pitch, rotation.y + yaw, rotation.z + roll);
-	UpdateVectors();
 }
 void Transform::Rotate(DirectX::XMFLOAT3 rotation) {
-	UpdateMatrices();
-	SetRotation(this->rotation.x + rotation.x, this->rotation.y + rotation.y, this->rotation.z + rotation.z);
-	UpdateVectors();
+	Rotate(rotation.x, rotation.y, rotation.z);
 }
 
 //SCALE
 void Transform::Scale(float x, float y, float z) {
-	UpdateMatrices();
+	XMFLOAT3 scale = GetScale();
 	SetScale(scale.x * x, scale.y * y, scale.z * z);
 }
 void Transform::Scale(DirectX::XMFLOAT3 scale) {
-	UpdateMatrices();
-	SetScale(this->scale.x * scale.x, this->scale.y * scale.y, this->scale.z * scale.z);
+	Scale(scale.x, scale.y, scale.z);
 }
 
 
 //SETTER FUNCTIONS ===========================================
 
-//Setters for all of these we will be setting the boolean matrixChanged to true. 
-//This will let us know that we need to remake the world matrix
+//Setters for all of these mark the slot dirty in the system, so its world
+//matrix is remade by the next TransformSystem::UpdateMatrices()
 void Transform::SetPosition(float x, float y, float z) {
-	this->position.x = x;
-	this->position.y = y;
-	this->position.z = z;
-
-	matrixChanged = true;
+	system->SetPosition(slot, XMFLOAT3(x, y, z));
 }
 void Transform::SetPosition(DirectX::XMFLOAT3 position) {
-	this->position = position;
-
-	matrixChanged = true;
+	system->SetPosition(slot, position);
 }
 void Transform::SetRotation(float pitch, float yaw, float roll) {
-	this->rotation.x = pitch;
-	this->rotation.y = yaw;
-	this->rotation.z = roll;
-
-	matrixChanged = true;
-	vectorsChanged = true;
+	system->SetPitchYawRoll(slot, XMFLOAT3(pitch, yaw, roll));
 }
 void Transform::SetRotation(DirectX::XMFLOAT3 rotation) {
-	this->rotation = rotation;
-
-	matrixChanged = true;
-	vectorsChanged = true;
+	system->SetPitchYawRoll(slot, rotation);
+}
+void Transform::SetRotation(DirectX::XMFLOAT4 quaternion) {
+	system->SetRotation(slot, quaternion);
 }
 void Transform::SetScale(float x, float y, float z) {
-	this->scale.x = x;
-	this->scale.y = y;
-	this->scale.z = z;
-
-	matrixChanged = true;
+	system->SetScale(slot, XMFLOAT3(x, y, z));
 }
 void Transform::SetScale(DirectX::XMFLOAT3 scale) {
-	this->scale = scale;
-
-	matrixChanged = true;
+	system->SetScale(slot, scale);
 }
 
 //GETTER FUNCTIONS ===========================================
 
-//Getters for all of these will just return the position, if the matrix is called for 
-//it is checked if the matrix was previously changed, if so, then the world matrix is updated.
+//Getters for all of these will just return the value, if the matrix is called for 
+//while the slot is dirty, the system rebuilds it on the spot.
 DirectX::XMFLOAT3 Transform::GetPosition() {
-	return position;
+	return system->GetPosition(slot);
 }
 
 DirectX::XMFLOAT3 Transform::GetPitchYawRoll() {
-	return rotation;
+	return system->GetPitchYawRoll(slot);
+}
+
+DirectX::XMFLOAT4 Transform::GetRotation() {
+	return system->GetRotation(slot);
 }
 
 DirectX::XMFLOAT3 Transform::GetScale() {
-	return scale;
+	return system->GetScale(slot);
 }
 
 DirectX::XMFLOAT4X4 Transform::GetWorldMatrix() {
-	UpdateMatrices();
-	return world;
+	return system->GetWorldMatrix(slot);
+}
+
+unsigned int Transform::GetVersion() {
+	return system->GetVersion(slot);
+}
+
+unsigned char Transform::GetClass() {
+	return system->GetClass(slot);
 }
 
 DirectX::XMFLOAT3 Transform::GetRight()
 {
-	UpdateVectors();
+	XMFLOAT3 right;
+	XMStoreFloat3(&right, RotateLocal(GetRotation(), XMVectorSet(1, 0, 0, 0)));
 	return right;
 }
 
 DirectX::XMFLOAT3 Transform::GetForward()
 {
-	UpdateVectors();
+	XMFLOAT3 forward;
+	XMStoreFloat3(&forward, RotateLocal(GetRotation(), XMVectorSet(0, 0, 1, 0)));
 	return forward;
 }
 
 DirectX::XMFLOAT3 Transform::GetUp()
 {
-	UpdateVectors();
+	XMFLOAT3 up;
+	XMStoreFloat3(&up, RotateLocal(GetRotation(), XMVectorSet(0, 1, 0, 0)));
 	return up;
 }
 
 DirectX::XMFLOAT4X4 Transform::GetWorldInverseTransposeMatrix() {
+	return system->GetWorldInverseTransposeMatrix(slot);
+}
+
+bool Transform::SetParent(Transform* parent) {
+	return system->SetParent(slot, parent ? parent->slot : transformNoParent);
+}
+
+DirectX::XMFLOAT3 Transform::GetWorldPosition() {
+	const XMFLOAT4X4& world = system->GetWorldMatrix(slot);
+	return XMFLOAT3(world._41, world._42, world._43);
+}
+
+TransformSystem* Transform::GetSystem() {
+	return system;
+}
 
-	UpdateMatrices();
-	return worldInverseTranspose;
+unsigned int Transform::GetSlot() {
+	return slot;
 }
@@ -1,10 +1,22 @@
 #pragma once
 #include <DirectXMath.h>
+#include "TransformSystem.h"
 
+//A handle to one slot of a TransformSystem, which holds the actual values and
+//matrices. Transforms can't be copied, since every copy would make (and later
+//destroy) a slot of its own; pass them by reference, or use CopyFrom() to give one
+//another's values. Moving one hands its slot over (the old one is left empty)
 class Transform
 {
 public:
 	Transform();
+	Transform(TransformSystem& system);
+	Transform(Transform&& other);
+	Transform(const Transform& other) = delete;
+	Transform& operator=(const Transform& other) = delete;
+
+	//Takes the other transform's position, rotation and scale (not its parent)
+	void CopyFrom(const Transform& other);
 
 	~Transform();
 
@@ -18,41 +30,51 @@ public:
 	void Scale(float x, float y, float z);
 	void Scale(DirectX::XMFLOAT3 scale);
 
-	//Setters for all of these we will be setting the boolean matrixChanged to true. 
-	//This will let us know that we need to remake the world matrix
+	//Setters for all of these mark the slot dirty in the system, so its world
+	//matrix is remade by the next TransformSystem::UpdateMatrices()
 	void SetPosition(float x, float y, float z);
 	void SetPosition(DirectX::XMFLOAT3 position);
 	void SetRotation(float pitch, float yaw, float roll);
 	void SetRotation(DirectX::XMFLOAT3 rotation);
+	void SetRotation(DirectX::XMFLOAT4 quaternion);
 	void SetScale(float x, float y, float z);
 	void SetScale(DirectX::XMFLOAT3 scale);
 
-	//Getters for all of these will just return the position, if the matrix is called for 
-	//it is checked if the matrix was previously changed, if so, then the world matrix is updated.
+	//Getters for all of these will just return the value, if the matrix is called for 
+	//while the slot is dirty, the system rebuilds it on the spot. Rotations are kept as
+	//quaternions; pitch/yaw/roll reads back as it was set (or is worked out from the
+	//quaternion, if that's how it was set)
 	DirectX::XMFLOAT3 GetPosition();
 	DirectX::XMFLOAT3 GetPitchYawRoll();
+	DirectX::XMFLOAT4 GetRotation();	//quaternion
 	DirectX::XMFLOAT3 GetScale();
 	DirectX::XMFLOAT4X4 GetWorldMatrix();
-	DirectX::XMFLOAT4X4 GetWorldInverseTransposeMatrix();
+	DirectX::XMFLOAT4X4 GetWorldInverseTransposeMatrix();	//built on first ask after a change
 	DirectX::XMFLOAT3 GetRight();
 	DirectX::XMFLOAT3 GetUp();
 	DirectX::XMFLOAT3 GetForward();
 
+	//Goes up every time the world matrix changes (including when a parent moves),
+	//so anything derived from it (like world-space bounds) can tell when it's out of date
+	unsigned int GetVersion();
+
+	//transformRigid, transformUniformScale, transformAxisScale or transformGeneral
+	//(see TransformSystem.h), which decides how much the inverse transpose costs
+	unsigned char GetClass();
+
+	//Position, rotation and scale are relative to the parent, so this transform
+	//(and its children) follow it around. Pass nullptr to detach. The parent has
+	//to live in the same TransformSystem, and can't be one of this transform's
+	//children; returns false if it is
+	bool SetParent(Transform* parent);
+
+	//Where the transform ends up once its parents are applied
+	DirectX::XMFLOAT3 GetWorldPosition();
+
+	TransformSystem* GetSystem();
+	unsigned int GetSlot();
+
 private:
-	DirectX::XMFLOAT3 position;
-	DirectX::XMFLOAT3 rotation;
-	DirectX::XMFLOAT3 scale;
-	DirectX::XMFLOAT4X4 world;
-	DirectX::XMFLOAT4X4 worldInverseTranspose;
-	bool matrixChanged;
-
-	//local vectors
-	DirectX::XMFLOAT3 forward;
-	DirectX::XMFLOAT3 right;
-	DirectX::XMFLOAT3 up;
-	bool vectorsChanged;
-
-	void UpdateMatrices();
-	void UpdateVectors();//updates fwd,right,up
+	TransformSystem* system;
+	unsigned int slot;
 };
-
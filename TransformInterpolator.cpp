@@ -0,0 +1,143 @@
+#include "TransformInterpolator.h"
+
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+	TransformState GetState(Transform& transform)
+	{
+		TransformState state;
+		state.position = transform.GetPosition();
+		state.rotation = transform.GetRotation();
+		state.pitchYawRoll = transform.GetPitchYawRoll();
+		state.scale = transform.GetScale();
+		return state;
+	}
+
+	// Nothing but floats, so no padding to trip over
+	template<typename T>
+	bool Same(const T& a, const T& b)
+	{
+		return memcmp(&a, &b, sizeof(T)) == 0;
+	}
+}
+
+void TransformInterpolator::Add(std::shared_ptr<Transform> transform)
+{
+	Entry entry;
+	entry.transform = transform;
+	entry.current = GetState(*transform);
+	entry.previous = entry.current;
+	entry.version = transform->GetVersion();
+	entry.blended = false;
+	entries.push_back(entry);
+}
+
+void TransformInterpolator::BeginTick()
+{
+	for (Entry& entry : entries)
+	{
+		Snap(entry);
+		entry.previous = entry.current;
+	}
+}
+
+void TransformInterpolator::EndTick()
+{
+	for (Entry& entry : entries)
+	{
+		if (entry.transform->GetVersion() == entry.version)
+			continue;
+
+		entry.current = GetState(*entry.transform);
+		entry.version = entry.transform->GetVersion();
+	}
+}
+
+// --------------------------------------------------------
+// Positions and scales blend in a straight line, and
+// rotations along the shortest arc between them
+// --------------------------------------------------------
+void TransformInterpolator::Blend(float amount)
+{
+	blendedCount = 0;
+	for (Entry& entry : entries)
+	{
+		Snap(entry);
+		if (Same(entry.previous, entry.current))
+			continue;
+
+		Transform& transform = *entry.transform;
+		if (!Same(entry.previous.position, entry.current.position))
+		{
+			XMFLOAT3 position;
+			XMStoreFloat3(&position, XMVectorLerp(
+				XMLoadFloat3(&entry.previous.position),
+				XMLoadFloat3(&entry.current.position),
+				amount));
+			transform.SetPosition(position);
+		}
+		if (!Same(entry.previous.rotation, entry.current.rotation))
+		{
+			XMFLOAT4 rotation;
+			XMStoreFloat4(&rotation, XMQuaternionSlerp(
+				XMLoadFloat4(&entry.previous.rotation),
+				XMLoadFloat4(&entry.current.rotation),
+				amount));
+			transform.SetRotation(rotation);
+		}
+		if (!Same(entry.previous.scale, entry.current.scale))
+		{
+			XMFLOAT3 scale;
+			XMStoreFloat3(&scale, XMVectorLerp(
+				XMLoadFloat3(&entry.previous.scale),
+				XMLoadFloat3(&entry.current.scale),
+				amount));
+			transform.SetScale(scale);
+		}
+
+		entry.blended = true;
+		blendedCount++;
+	}
+}
+
+void TransformInterpolator::Restore()
+{
+	for (Entry& entry : entries)
+	{
+		if (!entry.blended)
+			continue;
+
+		// Only what Blend() wrote; a rotation goes back through its
+		// pitch/yaw/roll so GetPitchYawRoll() still returns the
+		// angles the tick left (a quaternion can't say which of the
+		// equivalent angles those were)
+		Transform& transform = *entry.transform;
+		if (!Same(entry.previous.position, entry.current.position))
+			transform.SetPosition(entry.current.position);
+		if (!Same(entry.previous.rotation, entry.current.rotation))
+			transform.SetRotation(entry.current.pitchYawRoll);
+		if (!Same(entry.previous.scale, entry.current.scale))
+			transform.SetScale(entry.current.scale);
+
+		entry.version = entry.transform->GetVersion();
+		entry.blended = false;
+	}
+}
+
+unsigned int TransformInterpolator::GetBlendedCount()
+{
+	return blendedCount;
+}
+
+void TransformInterpolator::Snap(Entry& entry)
+{
+	if (entry.blended || entry.transform->GetVersion() == entry.version)
+		return;
+
+	entry.current = GetState(*entry.transform);
+	entry.previous = entry.current;
+	entry.version = entry.transform->GetVersion();
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <DirectXMath.h>
+#include "Transform.h"
+
+// --------------------------------------------------------
+// A transform's local values at one moment
+// --------------------------------------------------------
+struct TransformState
+{
+	DirectX::XMFLOAT3 position;
+	DirectX::XMFLOAT4 rotation;	// Quaternion
+	DirectX::XMFLOAT3 pitchYawRoll;	// The same rotation, as GetPitchYawRoll() gave it
+	DirectX::XMFLOAT3 scale;
+};
+
+// --------------------------------------------------------
+// Smooths transforms moved by fixed timestep ticks, by
+// drawing them between their last two ticks
+//
+// - Each transform keeps its state from the last tick and the
+//   one before it
+// - Blend() moves the transforms part of the way from the
+//   older state to the newer one just before drawing, and
+//   Restore() puts them back afterwards, so ticks (and
+//   anything else) always see the newest state
+// - A transform moved outside of a tick (like from the UI)
+//   jumps straight there rather than sliding; that's noticed
+//   from its version (see Transform::GetVersion())
+// - Transforms that didn't move in the last tick aren't
+//   touched, so they don't look changed to anything watching
+//   their versions; the ones that did only have the parts
+//   that moved (position, rotation or scale) written
+// --------------------------------------------------------
+class TransformInterpolator
+{
+public:
+	void Add(std::shared_ptr<Transform> transform);
+
+	// Call before and after each tick changes the transforms
+	void BeginTick();
+	void EndTick();
+
+	// 0 draws the older state and 1 the newer one
+	void Blend(float amount);
+	void Restore();
+
+	// Transforms the last Blend() moved
+	unsigned int GetBlendedCount();
+
+private:
+	struct Entry
+	{
+		std::shared_ptr<Transform> transform;
+		TransformState previous;
+		TransformState current;
+		unsigned int version;	// Of the transform when it was last in "current"
+		bool blended;
+	};
+
+	// Makes both states the transform's own if something outside
+	// of a tick moved it
+	void Snap(Entry& entry);
+
+	std::vector<Entry> entries;
+	unsigned int blendedCount = 0;
+};
@@ -0,0 +1,650 @@
+#include "TransformSystem.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+TransformSystem* TransformSystem::instance;
+
+namespace
+{
+	// Slots are added a whole bitset word at a time
+	const unsigned int slotsPerWord = 64;
+
+	// Marks destroyed slots until Compact() frees them
+	const unsigned int destroyedParent = 0xFFFFFFFE;
+
+	// One value per lane, in a single load when the slots are
+	// next to each other
+	inline XMVECTOR LoadFour(const std::vector<float>& values, const unsigned int slots[4], bool contiguous)
+	{
+		if (contiguous)
+			return XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&values[slots[0]]));
+		return XMVectorSet(values[slots[0]], values[slots[1]], values[slots[2]], values[slots[3]]);
+	}
+
+	inline void StoreRow(XMFLOAT4X4& matrix, unsigned int row, FXMVECTOR value)
+	{
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(matrix.m[row]), value);
+	}
+
+	// --------------------------------------------------------
+	// The angles XMQuaternionRotationRollPitchYaw would need to
+	// make this rotation, read off its matrix:
+	//   row 2 = (cos(p) sin(y), -sin(p), cos(p) cos(y))
+	//   column 1 = (sin(r) cos(p), cos(r) cos(p), -sin(p))
+	// Looking straight up or down leaves only yaw + roll (or
+	// their difference) known, so roll is taken as zero there
+	// --------------------------------------------------------
+	XMFLOAT3 QuaternionToPitchYawRoll(const XMFLOAT4& q)
+	{
+		XMFLOAT4X4 m;
+		XMStoreFloat4x4(&m, XMMatrixRotationQuaternion(XMLoadFloat4(&q)));
+
+		float sinPitch = -m._32;
+		if (sinPitch > 0.99999f || sinPitch < -0.99999f)
+		{
+			float pitch = sinPitch > 0.0f ? XM_PIDIV2 : -XM_PIDIV2;
+			return XMFLOAT3(pitch, atan2f(-m._13, m._11), 0.0f);
+		}
+
+		return XMFLOAT3(asinf(sinPitch), atan2f(m._31, m._33), atan2f(m._12, m._22));
+	}
+
+	unsigned char ScaleClass(const XMFLOAT3& scale)
+	{
+		if (scale.x != scale.y || scale.y != scale.z)
+			return transformAxisScale;
+		return scale.x == 1.0f ? transformRigid : transformUniformScale;
+	}
+
+	inline bool TestBit(const std::vector<uint64_t>& bits, unsigned int bit)
+	{
+		return (bits[bit / slotsPerWord] >> (bit % slotsPerWord)) & 1;
+	}
+
+	inline void ClearBit(std::vector<uint64_t>& bits, unsigned int bit)
+	{
+		bits[bit / slotsPerWord] &= ~(1ull << (bit % slotsPerWord));
+	}
+
+	// Sets "count" bits starting at "first", a word at a time
+	void SetBits(std::vector<uint64_t>& bits, unsigned int first, unsigned int count)
+	{
+		while (count > 0)
+		{
+			unsigned int shift = first % slotsPerWord;
+			unsigned int run = slotsPerWord - shift < count ? slotsPerWord - shift : count;
+			uint64_t mask = run == slotsPerWord ? ~0ull : ((1ull << run) - 1) << shift;
+			bits[first / slotsPerWord] |= mask;
+			first += run;
+			count -= run;
+		}
+	}
+
+	inline unsigned int CountBits(uint64_t bits)
+	{
+		unsigned int count = 0;
+		for (; bits != 0; bits &= bits - 1)
+			count++;
+		return count;
+	}
+}
+
+TransformSystem::TransformSystem()
+	:
+	count(0),
+	destroyedCount(0)
+{
+}
+
+unsigned int TransformSystem::Create()
+{
+	if (freeSlots.empty())
+	{
+		unsigned int oldSize = (unsigned int)versions.size();
+		unsigned int newSize = oldSize + slotsPerWord;
+
+		XMFLOAT4X4 identity;
+		XMStoreFloat4x4(&identity, XMMatrixIdentity());
+
+		positionX.resize(newSize, 0.0f);
+		positionY.resize(newSize, 0.0f);
+		positionZ.resize(newSize, 0.0f);
+		rotationX.resize(newSize, 0.0f);
+		rotationY.resize(newSize, 0.0f);
+		rotationZ.resize(newSize, 0.0f);
+		rotationW.resize(newSize, 1.0f);
+		scaleX.resize(newSize, 1.0f);
+		scaleY.resize(newSize, 1.0f);
+		scaleZ.resize(newSize, 1.0f);
+		world.resize(newSize, identity);
+		worldInverseTranspose.resize(newSize, identity);
+		versions.resize(newSize, 0);
+		pitchYawRoll.resize(newSize, XMFLOAT3(0.0f, 0.0f, 0.0f));
+		pitchYawRollStale.resize(newSize, 0);
+		localClasses.resize(newSize, transformRigid);
+		classes.resize(newSize, transformRigid);
+		inverseStale.resize(newSize, 0);
+		parents.resize(newSize, transformNoParent);
+		subtreeSizes.resize(newSize, 1);
+		orderPositions.resize(newSize, 0);
+		dirty.push_back(0);
+
+		// Lowest slots get handed out first
+		for (unsigned int slot = newSize; slot > oldSize; slot--)
+			freeSlots.push_back(slot - 1);
+	}
+
+	unsigned int slot = freeSlots.back();
+	freeSlots.pop_back();
+	count++;
+
+	positionX[slot] = positionY[slot] = positionZ[slot] = 0.0f;
+	rotationX[slot] = rotationY[slot] = rotationZ[slot] = 0.0f;
+	rotationW[slot] = 1.0f;
+	pitchYawRoll[slot] = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	pitchYawRollStale[slot] = 0;
+	localClasses[slot] = transformRigid;
+	classes[slot] = transformRigid;
+	inverseStale[slot] = 0;
+	scaleX[slot] = scaleY[slot] = scaleZ[slot] = 1.0f;
+	XMStoreFloat4x4(&world[slot], XMMatrixIdentity());
+	XMStoreFloat4x4(&worldInverseTranspose[slot], XMMatrixIdentity());
+	versions[slot] = 1;
+
+	// A new root goes at the end of the order, which is always
+	// past every subtree
+	parents[slot] = transformNoParent;
+	subtreeSizes[slot] = 1;
+	orderPositions[slot] = (unsigned int)order.size();
+	order.push_back(slot);
+	return slot;
+}
+
+// --------------------------------------------------------
+// The children are already inside the parent's part of the
+// order, so handing them up doesn't move anything; the slot
+// itself stays in the order (as part of its ancestors'
+// subtrees) until Compact() takes it out
+// --------------------------------------------------------
+void TransformSystem::Destroy(unsigned int slot)
+{
+	unsigned int first = orderPositions[slot];
+	unsigned int parent = parents[slot];
+	for (unsigned int p = first + 1; p < first + subtreeSizes[slot]; p++)
+	{
+		unsigned int child = order[p];
+		if (parents[child] == slot)
+		{
+			parents[child] = parent;
+			MarkDirty(child);
+		}
+	}
+
+	parents[slot] = destroyedParent;
+	count--;
+	destroyedCount++;
+}
+
+// --------------------------------------------------------
+// Walks the bitset a word at a time, so stretches of the order
+// where nothing moved cost one test per 64 slots
+//
+// - Dirty slots are collected four at a time in hierarchy
+//   order, so every group fills all of its lanes wherever the
+//   slots are; the last group is padded with repeats of its
+//   first slot
+// - A group can hold a parent and its child: UpdateGroup()
+//   brings its slots into world space one after another, so
+//   the parent is done first
+// --------------------------------------------------------
+unsigned int TransformSystem::UpdateMatrices()
+{
+	if (destroyedCount > 0)
+		Compact();
+
+	unsigned int updated = 0;
+	unsigned int pending[4];
+	unsigned int pendingCount = 0;
+	size_t wordCount = (order.size() + slotsPerWord - 1) / slotsPerWord;
+	for (size_t w = 0; w < wordCount; w++)
+	{
+		uint64_t bits = dirty[w];
+		if (bits == 0)
+			continue;
+
+		unsigned int first = (unsigned int)w * slotsPerWord;
+		for (unsigned int lane = 0; lane < slotsPerWord; lane += 4)
+		{
+			unsigned int laneMask = (unsigned int)(bits >> lane) & 0xF;
+			for (unsigned int i = 0; laneMask != 0; i++, laneMask >>= 1)
+			{
+				if ((laneMask & 1) == 0)
+					continue;
+
+				pending[pendingCount++] = order[first + lane + i];
+				if (pendingCount == 4)
+				{
+					UpdateGroup(pending, 4);
+					pendingCount = 0;
+				}
+			}
+		}
+
+		updated += CountBits(bits);
+		dirty[w] = 0;
+	}
+
+	if (pendingCount > 0)
+	{
+		for (unsigned int i = pendingCount; i < 4; i++)
+			pending[i] = pending[0];
+		UpdateGroup(pending, pendingCount);
+	}
+	return updated;
+}
+
+// --------------------------------------------------------
+// Four slots at once, one per SIMD lane, with every matrix
+// element in its own vector until the very end
+//
+// - The rotation matrix comes straight from the quaternion,
+//   with nothing but multiplies and adds
+// - world = scale * rotation * translation, so its rows are
+//   the rotation's rows times their scales, then the position
+// - Each matrix row is then gathered from its four element
+//   vectors with one 4x4 transpose, giving that row for each
+//   of the four slots
+// - Slots with a parent are then multiplied by its world
+//   matrix, and every slot's class is worked out from its own
+//   scale and its parent's class
+// - Inverse transposes are left for whoever asks for them (see
+//   UpdateInverseTranspose())
+// --------------------------------------------------------
+void TransformSystem::UpdateGroup(const unsigned int slots[4], unsigned int composeCount)
+{
+	bool contiguous =
+		slots[1] == slots[0] + 1 &&
+		slots[2] == slots[0] + 2 &&
+		slots[3] == slots[0] + 3;
+
+	// XMMatrixRotationQuaternion, four at a time
+	XMVECTOR qx = LoadFour(rotationX, slots, contiguous);
+	XMVECTOR qy = LoadFour(rotationY, slots, contiguous);
+	XMVECTOR qz = LoadFour(rotationZ, slots, contiguous);
+	XMVECTOR qw = LoadFour(rotationW, slots, contiguous);
+	XMVECTOR x2 = qx + qx;
+	XMVECTOR y2 = qy + qy;
+	XMVECTOR z2 = qz + qz;
+	XMVECTOR xx = qx * x2;
+	XMVECTOR yy = qy * y2;
+	XMVECTOR zz = qz * z2;
+	XMVECTOR xy = qx * y2;
+	XMVECTOR xz = qx * z2;
+	XMVECTOR yz = qy * z2;
+	XMVECTOR wx = qw * x2;
+	XMVECTOR wy = qw * y2;
+	XMVECTOR wz = qw * z2;
+	XMVECTOR one = XMVectorSplatOne();
+
+	XMVECTOR r00 = one - (yy + zz);
+	XMVECTOR r01 = xy + wz;
+	XMVECTOR r02 = xz - wy;
+	XMVECTOR r10 = xy - wz;
+	XMVECTOR r11 = one - (xx + zz);
+	XMVECTOR r12 = yz + wx;
+	XMVECTOR r20 = xz + wy;
+	XMVECTOR r21 = yz - wx;
+	XMVECTOR r22 = one - (xx + yy);
+
+	XMVECTOR x = LoadFour(positionX, slots, contiguous);
+	XMVECTOR y = LoadFour(positionY, slots, contiguous);
+	XMVECTOR z = LoadFour(positionZ, slots, contiguous);
+	XMVECTOR sx = LoadFour(scaleX, slots, contiguous);
+	XMVECTOR sy = LoadFour(scaleY, slots, contiguous);
+	XMVECTOR sz = LoadFour(scaleZ, slots, contiguous);
+	XMVECTOR zero = XMVectorZero();
+
+	XMMATRIX worldRows[4] =
+	{
+		XMMatrixTranspose(XMMATRIX(r00 * sx, r01 * sx, r02 * sx, zero)),
+		XMMatrixTranspose(XMMATRIX(r10 * sy, r11 * sy, r12 * sy, zero)),
+		XMMatrixTranspose(XMMATRIX(r20 * sz, r21 * sz, r22 * sz, zero)),
+		XMMatrixTranspose(XMMATRIX(x, y, z, one)),
+	};
+
+	for (unsigned int lane = 0; lane < 4; lane++)
+	{
+		XMFLOAT4X4& w = world[slots[lane]];
+		for (unsigned int row = 0; row < 4; row++)
+			StoreRow(w, row, worldRows[row].r[lane]);
+	}
+
+	for (unsigned int lane = 0; lane < composeCount; lane++)
+	{
+		unsigned int slot = slots[lane];
+		unsigned int parent = parents[slot];
+		unsigned char worldClass = localClasses[slot];
+		if (parent != transformNoParent)
+		{
+			XMStoreFloat4x4(&world[slot],
+				XMLoadFloat4x4(&world[slot]) * XMLoadFloat4x4(&world[parent]));
+
+			// A rotation under a non-uniform scale skews
+			unsigned char parentClass = classes[parent];
+			worldClass = parentClass >= transformAxisScale ?
+				transformGeneral :
+				std::max(worldClass, parentClass);
+		}
+
+		classes[slot] = worldClass;
+		inverseStale[slot] = 1;
+	}
+}
+
+// --------------------------------------------------------
+// Only as much work as the slot's class needs
+//
+// - Unless the class is general, the rows of the world
+//   matrix's upper 3x3 are at right angles to each other, so
+//   its inverse is its transpose with each row divided by its
+//   squared length, and the inverse transpose is just the rows
+//   divided by their squared lengths
+// - Those lengths are all 1 for rigid slots and all the same
+//   for uniformly scaled ones
+// - The last column is minus each row dotted with the position
+//   (divided the same way), which is the inverse's translation
+// - General slots get a full XMMatrixInverse()
+// --------------------------------------------------------
+void TransformSystem::UpdateInverseTranspose(unsigned int slot)
+{
+	XMMATRIX w = XMLoadFloat4x4(&world[slot]);
+	XMMATRIX inverseTranspose;
+	if (classes[slot] == transformGeneral)
+	{
+		inverseTranspose = XMMatrixTranspose(XMMatrixInverse(nullptr, w));
+	}
+	else
+	{
+		XMVECTOR scales[3];
+		if (classes[slot] == transformRigid)
+		{
+			scales[0] = scales[1] = scales[2] = XMVectorSplatOne();
+		}
+		else if (classes[slot] == transformUniformScale)
+		{
+			scales[0] = scales[1] = scales[2] = XMVectorReciprocal(XMVector3LengthSq(w.r[0]));
+		}
+		else
+		{
+			for (int i = 0; i < 3; i++)
+				scales[i] = XMVectorReciprocal(XMVector3LengthSq(w.r[i]));
+		}
+
+		for (int i = 0; i < 3; i++)
+		{
+			XMVECTOR row = w.r[i] * scales[i];
+			inverseTranspose.r[i] = XMVectorSetW(row, -XMVectorGetX(XMVector3Dot(row, w.r[3])));
+		}
+		inverseTranspose.r[3] = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+
+	XMStoreFloat4x4(&worldInverseTranspose[slot], inverseTranspose);
+	inverseStale[slot] = 0;
+}
+
+// --------------------------------------------------------
+// Keeps the order of everything left, which keeps parents
+// before children, then recounts subtree sizes from the back
+// (every child is counted before its parent is reached)
+// --------------------------------------------------------
+void TransformSystem::Compact()
+{
+	unsigned int write = 0;
+	for (unsigned int read = 0; read < order.size(); read++)
+	{
+		unsigned int slot = order[read];
+		bool wasDirty = TestBit(dirty, read);
+		ClearBit(dirty, read);
+		if (parents[slot] == destroyedParent)
+		{
+			parents[slot] = transformNoParent;
+			freeSlots.push_back(slot);
+			continue;
+		}
+
+		order[write] = slot;
+		orderPositions[slot] = write;
+		subtreeSizes[slot] = 1;
+		if (wasDirty)
+			SetBits(dirty, write, 1);
+		write++;
+	}
+	order.resize(write);
+
+	for (size_t p = order.size(); p > 0; p--)
+	{
+		unsigned int slot = order[p - 1];
+		if (parents[slot] != transformNoParent)
+			subtreeSizes[parents[slot]] += subtreeSizes[slot];
+	}
+	destroyedCount = 0;
+}
+
+// --------------------------------------------------------
+// The subtree is cut out of the order and put back right after
+// the new parent's own subtree, as its last child, by rotating
+// the stretch of the order between the two places (the dirty
+// bits rotate with it)
+// --------------------------------------------------------
+bool TransformSystem::SetParent(unsigned int slot, unsigned int parent)
+{
+	if (parent == parents[slot])
+		return true;
+	for (unsigned int p = parent; p != transformNoParent; p = parents[p])
+	{
+		if (p == slot)
+			return false;
+	}
+
+	unsigned int first = orderPositions[slot];
+	unsigned int size = subtreeSizes[slot];
+	unsigned int target = parent == transformNoParent ?
+		(unsigned int)order.size() :
+		orderPositions[parent] + subtreeSizes[parent];
+
+	for (unsigned int p = parents[slot]; p != transformNoParent; p = parents[p])
+		subtreeSizes[p] -= size;
+	for (unsigned int p = parent; p != transformNoParent; p = parents[p])
+		subtreeSizes[p] += size;
+	parents[slot] = parent;
+
+	// Everything from rangeStart to rangeEnd moves, and the
+	// subtree's first slot ends up at middle
+	unsigned int rangeStart = target > first ? first : target;
+	unsigned int rangeEnd = target > first ? target : first + size;
+	unsigned int middle = target > first ? first + size : first;
+
+	std::vector<char> bits(rangeEnd - rangeStart);
+	for (unsigned int p = rangeStart; p < rangeEnd; p++)
+		bits[p - rangeStart] = TestBit(dirty, p);
+	std::rotate(bits.begin(), bits.begin() + (middle - rangeStart), bits.end());
+	std::rotate(order.begin() + rangeStart, order.begin() + middle, order.begin() + rangeEnd);
+
+	for (unsigned int p = rangeStart; p < rangeEnd; p++)
+	{
+		orderPositions[order[p]] = p;
+		ClearBit(dirty, p);
+		if (bits[p - rangeStart])
+			SetBits(dirty, p, 1);
+	}
+
+	MarkDirty(slot);
+	return true;
+}
+
+unsigned int TransformSystem::GetParent(unsigned int slot)
+{
+	return parents[slot];
+}
+
+bool TransformSystem::IsDirty(unsigned int slot)
+{
+	return TestBit(dirty, orderPositions[slot]);
+}
+
+// --------------------------------------------------------
+// Versions go up for the whole subtree, since every world
+// matrix in it is about to change
+// --------------------------------------------------------
+void TransformSystem::MarkDirty(unsigned int slot)
+{
+	versions[slot]++;
+
+	unsigned int first = orderPositions[slot];
+	if (TestBit(dirty, first))
+		return;
+
+	unsigned int size = subtreeSizes[slot];
+	SetBits(dirty, first, size);
+	for (unsigned int p = first + 1; p < first + size; p++)
+		versions[order[p]]++;
+}
+
+// --------------------------------------------------------
+// Any dirty ancestors sit in an unbroken chain right above the
+// slot, since a clean slot never has a dirty parent
+// --------------------------------------------------------
+void TransformSystem::UpdateSlot(unsigned int slot)
+{
+	ancestors.clear();
+	ancestors.push_back(slot);
+	for (unsigned int p = parents[slot]; p != transformNoParent && IsDirty(p); p = parents[p])
+		ancestors.push_back(p);
+
+	for (size_t i = ancestors.size(); i > 0; i--)
+	{
+		unsigned int dirtySlot = ancestors[i - 1];
+		unsigned int group[4] = { dirtySlot, dirtySlot, dirtySlot, dirtySlot };
+		UpdateGroup(group, 1);
+		ClearBit(dirty, orderPositions[dirtySlot]);
+	}
+}
+
+XMFLOAT3 TransformSystem::GetPosition(unsigned int slot)
+{
+	return XMFLOAT3(positionX[slot], positionY[slot], positionZ[slot]);
+}
+
+XMFLOAT3 TransformSystem::GetPitchYawRoll(unsigned int slot)
+{
+	if (pitchYawRollStale[slot])
+	{
+		pitchYawRoll[slot] = QuaternionToPitchYawRoll(GetRotation(slot));
+		pitchYawRollStale[slot] = 0;
+	}
+	return pitchYawRoll[slot];
+}
+
+XMFLOAT4 TransformSystem::GetRotation(unsigned int slot)
+{
+	return XMFLOAT4(rotationX[slot], rotationY[slot], rotationZ[slot], rotationW[slot]);
+}
+
+XMFLOAT3 TransformSystem::GetScale(unsigned int slot)
+{
+	return XMFLOAT3(scaleX[slot], scaleY[slot], scaleZ[slot]);
+}
+
+void TransformSystem::SetPosition(unsigned int slot, XMFLOAT3 position)
+{
+	positionX[slot] = position.x;
+	positionY[slot] = position.y;
+	positionZ[slot] = position.z;
+	MarkDirty(slot);
+}
+
+void TransformSystem::SetPitchYawRoll(unsigned int slot, XMFLOAT3 rotation)
+{
+	XMFLOAT4 quaternion;
+	XMStoreFloat4(&quaternion, XMQuaternionRotationRollPitchYaw(rotation.x, rotation.y, rotation.z));
+	StoreRotation(slot, quaternion);
+	pitchYawRoll[slot] = rotation;
+	pitchYawRollStale[slot] = 0;
+	MarkDirty(slot);
+}
+
+void TransformSystem::SetRotation(unsigned int slot, XMFLOAT4 quaternion)
+{
+	XMStoreFloat4(&quaternion, XMQuaternionNormalize(XMLoadFloat4(&quaternion)));
+	StoreRotation(slot, quaternion);
+	pitchYawRollStale[slot] = 1;
+	MarkDirty(slot);
+}
+
+void TransformSystem::SetScale(unsigned int slot, XMFLOAT3 scale)
+{
+	scaleX[slot] = scale.x;
+	scaleY[slot] = scale.y;
+	scaleZ[slot] = scale.z;
+	localClasses[slot] = ScaleClass(scale);
+	MarkDirty(slot);
+}
+
+void TransformSystem::Copy(unsigned int slot, TransformSystem& source, unsigned int sourceSlot)
+{
+	positionX[slot] = source.positionX[sourceSlot];
+	positionY[slot] = source.positionY[sourceSlot];
+	positionZ[slot] = source.positionZ[sourceSlot];
+	StoreRotation(slot, source.GetRotation(sourceSlot));
+	pitchYawRoll[slot] = source.pitchYawRoll[sourceSlot];
+	pitchYawRollStale[slot] = source.pitchYawRollStale[sourceSlot];
+	scaleX[slot] = source.scaleX[sourceSlot];
+	scaleY[slot] = source.scaleY[sourceSlot];
+	scaleZ[slot] = source.scaleZ[sourceSlot];
+	localClasses[slot] = source.localClasses[sourceSlot];
+	MarkDirty(slot);
+}
+
+void TransformSystem::StoreRotation(unsigned int slot, XMFLOAT4 quaternion)
+{
+	rotationX[slot] = quaternion.x;
+	rotationY[slot] = quaternion.y;
+	rotationZ[slot] = quaternion.z;
+	rotationW[slot] = quaternion.w;
+}
+
+const XMFLOAT4X4& TransformSystem::GetWorldMatrix(unsigned int slot)
+{
+	if (IsDirty(slot))
+		UpdateSlot(slot);
+	return world[slot];
+}
+
+const XMFLOAT4X4& TransformSystem::GetWorldInverseTransposeMatrix(unsigned int slot)
+{
+	if (IsDirty(slot))
+		UpdateSlot(slot);
+	if (inverseStale[slot])
+		UpdateInverseTranspose(slot);
+	return worldInverseTranspose[slot];
+}
+
+unsigned char TransformSystem::GetClass(unsigned int slot)
+{
+	if (IsDirty(slot))
+		UpdateSlot(slot);
+	return classes[slot];
+}
+
+unsigned int TransformSystem::GetVersion(unsigned int slot)
+{
+	return versions[slot];
+}
+
+unsigned int TransformSystem::GetCount()
+{
+	return count;
+}
@@ -0,0 +1,182 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+
+// Parent of a transform that isn't attached to anything
+const unsigned int transformNoParent = 0xFFFFFFFF;
+
+// What a world matrix is made of, from cheapest to invert to
+// most expensive
+const unsigned char transformRigid = 0;			// Rotation and position only
+const unsigned char transformUniformScale = 1;	// The same scale on every axis
+const unsigned char transformAxisScale = 2;		// Its own scale differs per axis
+const unsigned char transformGeneral = 3;		// Skewed by a non-uniform scale above it
+
+// --------------------------------------------------------
+// Storage for every Transform's position, rotation and scale,
+// and for the matrices built from them
+//
+// - Each component lives in its own contiguous array (every
+//   position x, then every position y, ...), so four slots in
+//   a row load as one SIMD vector per component, and matrices
+//   are built four slots at a time, one per SIMD lane
+// - Rotations are stored as unit quaternions, so building a
+//   matrix needs no trig at all; pitch/yaw/roll is converted
+//   once when it's set, and kept so it reads back as it was
+//   set (or converted back from the quaternion when asked for,
+//   if the rotation was set as a quaternion)
+// - Inverse transposes (for normals) are only built when asked
+//   for, once per change, and only as expensively as the
+//   slot's class needs (see the transform classes above)
+// - Transforms are handles to slots in here (see Transform.h);
+//   asking for a dirty slot's matrices rebuilds just that slot
+//   (and its dirty ancestors), so nothing reads stale matrices
+//   between batches
+//
+// Hierarchy:
+// - A slot's position, rotation and scale are relative to its
+//   parent, so world = local * parent's world
+// - Slots are kept in a flat order where every parent comes
+//   before its children and every subtree is contiguous, so a
+//   single front-to-back sweep always finds a parent's world
+//   matrix ready before its children need it
+// - The dirty bitset follows that order, and changing a slot
+//   marks its whole subtree (one contiguous run of bits), and
+//   nothing else; a slot that's already dirty has a dirty
+//   subtree already, so marking it again costs nothing
+// - UpdateMatrices() rebuilds every dirty slot in that sweep,
+//   skipping clean stretches 64 slots at a time
+// - SetParent() moves a subtree within the order, which costs
+//   up to one pass over it; attach things once rather than
+//   every frame
+// - Destroyed slots stay in the order until the next
+//   UpdateMatrices() compacts it, and are only reused after
+// --------------------------------------------------------
+class TransformSystem
+{
+public:
+	// The system every Transform lives in unless told otherwise
+	static TransformSystem& GetInstance()
+	{
+		if (!instance)
+		{
+			instance = new TransformSystem();
+		}
+
+		return *instance;
+	}
+
+	TransformSystem();
+	TransformSystem(TransformSystem const&) = delete;
+	void operator=(TransformSystem const&) = delete;
+
+	// Returns the slot of a new identity transform, with no parent
+	unsigned int Create();
+
+	// The slot's children are handed to its own parent, keeping
+	// their local values
+	void Destroy(unsigned int slot);
+
+	// Rebuilds the matrices of every dirty slot, returning how
+	// many there were
+	unsigned int UpdateMatrices();
+
+	// Attaches the slot (and everything under it) to a parent,
+	// or detaches it with transformNoParent
+	// - Returns false, changing nothing, if the parent is the
+	//   slot itself or one of its descendants
+	// - The slot keeps its local values, so it moves with the
+	//   parent from here on rather than staying where it was
+	bool SetParent(unsigned int slot, unsigned int parent);
+	unsigned int GetParent(unsigned int slot);
+
+	DirectX::XMFLOAT3 GetPosition(unsigned int slot);
+	DirectX::XMFLOAT3 GetPitchYawRoll(unsigned int slot);
+	DirectX::XMFLOAT4 GetRotation(unsigned int slot);
+	DirectX::XMFLOAT3 GetScale(unsigned int slot);
+	void SetPosition(unsigned int slot, DirectX::XMFLOAT3 position);
+	void SetPitchYawRoll(unsigned int slot, DirectX::XMFLOAT3 rotation);
+	void SetRotation(unsigned int slot, DirectX::XMFLOAT4 quaternion);	// Normalized here
+	void SetScale(unsigned int slot, DirectX::XMFLOAT3 scale);
+
+	// Gives the slot another slot's position, rotation and scale
+	// (the other slot can be in another system)
+	void Copy(unsigned int slot, TransformSystem& source, unsigned int sourceSlot);
+
+	const DirectX::XMFLOAT4X4& GetWorldMatrix(unsigned int slot);
+	const DirectX::XMFLOAT4X4& GetWorldInverseTransposeMatrix(unsigned int slot);
+
+	// One of the transform classes above, for the world matrix
+	unsigned char GetClass(unsigned int slot);
+
+	// Goes up whenever the slot's world matrix changes, including
+	// when one of its ancestors moves
+	unsigned int GetVersion(unsigned int slot);
+
+	// Transforms currently alive
+	unsigned int GetCount();
+
+private:
+	static TransformSystem* instance;
+
+	bool IsDirty(unsigned int slot);
+	void MarkDirty(unsigned int slot);
+
+	// Rebuilds the dirty slot's matrices right away, after those
+	// of any dirty ancestors
+	void UpdateSlot(unsigned int slot);
+
+	// Builds the matrices of four slots at once (repeats allowed),
+	// then brings the first composeCount of them into world space
+	// - Slots must be in hierarchy order, with their parents'
+	//   matrices already up to date
+	void UpdateGroup(const unsigned int slots[4], unsigned int composeCount);
+
+	void StoreRotation(unsigned int slot, DirectX::XMFLOAT4 quaternion);
+	void UpdateInverseTranspose(unsigned int slot);
+
+	// Drops destroyed slots from the order and frees them
+	void Compact();
+
+	std::vector<float> positionX;
+	std::vector<float> positionY;
+	std::vector<float> positionZ;
+	std::vector<float> rotationX;
+	std::vector<float> rotationY;
+	std::vector<float> rotationZ;
+	std::vector<float> rotationW;
+	std::vector<float> scaleX;
+	std::vector<float> scaleY;
+	std::vector<float> scaleZ;
+
+	std::vector<DirectX::XMFLOAT4X4> world;
+	std::vector<DirectX::XMFLOAT4X4> worldInverseTranspose;
+	std::vector<unsigned int> versions;
+
+	// Only read and written outside the matrix sweep, so not split up
+	std::vector<DirectX::XMFLOAT3> pitchYawRoll;
+	std::vector<unsigned char> pitchYawRollStale;
+
+	// Classes of each slot's own scale and of its world matrix
+	std::vector<unsigned char> localClasses;
+	std::vector<unsigned char> classes;
+	std::vector<unsigned char> inverseStale;
+
+	// Per slot
+	std::vector<unsigned int> parents;
+	std::vector<unsigned int> subtreeSizes;	// Including the slot itself
+	std::vector<unsigned int> orderPositions;
+
+	// Every slot in use (or destroyed since the last Compact()),
+	// parents before children
+	std::vector<unsigned int> order;
+
+	// One bit per position in the order
+	std::vector<uint64_t> dirty;
+
+	std::vector<unsigned int> freeSlots;
+	std::vector<unsigned int> ancestors;
+	unsigned int count;
+	unsigned int destroyedCount;
+};
@@ -1,14 +1,21 @@
 #include "Include.hlsli"
+#include "ObjectData.hlsli"
+#ifdef COMPACT_VERTICES
+#include "CompactVertex.hlsli"
+#endif
 
 //Constant buffer
 cbuffer ExternalData : register(b0)
 {
-	matrix world;
     matrix view;
 	matrix projection;
-    matrix worldInvTranspose;
     matrix lightView;
     matrix lightProjection;
+    uint objectIndex; // This object's entry in objects
+#ifdef COMPACT_VERTICES
+    float3 positionOffset;
+    float3 positionScale;
+#endif
 }
 
 // Struct representing a single vertex worth of data
@@ -56,8 +63,16 @@ struct VertexToPixel
 // - Output is a single struct of data to pass down the pipeline
 // - Named "main" because that's the default the shader compiler looks for
 // --------------------------------------------------------
+#ifdef COMPACT_VERTICES
+VertexToPixel main( CompactVertexInput compactInput )
+{
+	VertexShaderInput input;
+	DecodeCompactVertex(compactInput, positionOffset, positionScale,
+		input.localPosition, input.normal, input.tangent, input.uv);
+#else
 VertexToPixel main( VertexShaderInput input )
 {
+#endif
 	// Set up output struct
 	VertexToPixel output;
 
@@ -70,6 +85,7 @@ VertexToPixel main( VertexShaderInput input )
 	//   which we're leaving at 1.0 for now (this is more useful when dealing with 
 	//   a perspective projection matrix, which we'll get to in the future).
 	//output.screenPosition = float4(input.localPosition + offset, 1.0f);
+	matrix world = objects[objectIndex].world;
 	matrix wvp = mul(projection, mul(view, world));
 	output.screenPosition = mul(wvp, float4(input.localPosition, 1.0f));
 
@@ -77,7 +93,7 @@ VertexToPixel main( VertexShaderInput input )
 	// - The values will be interpolated per-pixel by the rasterizer
 	// - We don't need to alter it here, but we do need to send it to the pixel shader
     output.uv = input.uv;
-    output.normal = mul((float3x3) worldInvTranspose, input.normal); // Perfect!
+    output.normal = mul((float3x3) objects[objectIndex].worldInvTranspose, input.normal); // Perfect!
     output.worldPosition = mul(world, float4(input.localPosition, 1)).xyz;
     output.tangent = mul((float3x3) world, input.tangent);
     